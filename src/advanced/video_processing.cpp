@@ -1,6 +1,14 @@
 #include "video_processing.hpp"
+#include "core/resize.hpp"
+#include "core/stitch_rig.hpp"
+#include <condition_variable>
+#include <deque>
+#include <exception> // For std::exception_ptr
+#include <fstream>   // For probing the rig calibration file
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 
 bool process_video_grayscale(const std::string& input_video_path, const std::string& output_video_path) {
     // 1. Open the input video file
@@ -123,4 +131,295 @@ bool process_video_bg_subtract_mog2(const std::string& input_video_path,
     writer.release();
 
     return true;
-} 
\ No newline at end of file
+}
+
+bool process_video_resize(const std::string& input_video_path,
+                          const std::string& output_video_path,
+                          double factor,
+                          int interpolation)
+{
+    // 1. Open the input video file
+    cv::VideoCapture cap(input_video_path);
+    if (!cap.isOpened()) {
+        throw std::runtime_error("Error: Could not open input video file: " + input_video_path);
+    }
+
+    // 2. Get video properties and the output resolution
+    int frame_width = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH));
+    int frame_height = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT));
+    double fps = cap.get(cv::CAP_PROP_FPS);
+    int fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+    cv::Size out_size = scaled_size(cv::Size(frame_width, frame_height), factor);
+
+    // 3. Create the output video writer
+    cv::VideoWriter writer(output_video_path, fourcc, fps, out_size, true);
+    if (!writer.isOpened()) {
+        cap.release();
+        throw std::runtime_error("Error: Could not create output video file: " + output_video_path);
+    }
+
+    std::cout << "Processing video: " << input_video_path << std::endl;
+    std::cout << "  Resolution: " << frame_width << "x" << frame_height
+              << " -> " << out_size.width << "x" << out_size.height << std::endl;
+    std::cout << "Saving resized video to: " << output_video_path << std::endl;
+
+    // 4. Process frame by frame; plan and pyramid levels are built on the first frame and reused
+    cv::Mat frame;
+    cv::Mat resized_frame;
+    ResizeWorkspace workspace;
+    int frame_count = 0;
+    while (true) {
+        cap >> frame;
+        if (frame.empty()) {
+            break;
+        }
+
+        resize_image(frame, resized_frame, workspace, out_size.width, out_size.height, interpolation);
+
+        writer.write(resized_frame);
+
+        frame_count++;
+        if (frame_count % 100 == 0) {
+            std::cout << "Processed " << frame_count << " frames..." << std::endl;
+        }
+    }
+
+    std::cout << "Finished processing " << frame_count << " frames." << std::endl;
+
+    // 5. Release resources
+    cap.release();
+    writer.release();
+
+    return true;
+}
+
+static const size_t kStitchQueueDepth = 4; // Frames buffered between pipeline stages, per queue
+
+/**
+ * @brief Bounded queue between two stages of the video stitching pipeline.
+ *
+ * close() ends the stream: pop() drains what is left and then returns false, and
+ * push() returns false so that a producer stops when its consumer has given up.
+ */
+class FrameQueue {
+public:
+    bool push(cv::Mat frame) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return frames_.size() < kStitchQueueDepth || closed_; });
+        if (closed_) {
+            return false;
+        }
+        frames_.push_back(std::move(frame));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool pop(cv::Mat& frame) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return !frames_.empty() || closed_; });
+        if (frames_.empty()) {
+            return false;
+        }
+        frame = std::move(frames_.front());
+        frames_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<cv::Mat> frames_;
+    bool closed_ = false;
+};
+
+bool process_video_stitch(const std::vector<std::string>& input_video_paths,
+                          const std::string& output_video_path,
+                          int calibration_frames,
+                          const StitchOptions& options,
+                          const std::string& rig_path)
+{
+    if (input_video_paths.size() < 2) {
+        throw std::invalid_argument("Video stitching requires at least two input videos.");
+    }
+    if (calibration_frames <= 0) {
+        throw std::invalid_argument("Video stitching needs at least one calibration frame set.");
+    }
+
+    // 1. Open every input video
+    const size_t stream_count = input_video_paths.size();
+    std::vector<cv::VideoCapture> captures(stream_count);
+    for (size_t i = 0; i < stream_count; ++i) {
+        if (!captures[i].open(input_video_paths[i])) {
+            throw std::runtime_error("Error: Could not open input video file: " + input_video_paths[i]);
+        }
+    }
+    double fps = captures[0].get(cv::CAP_PROP_FPS);
+    if (!(fps > 0)) { // Also rejects NaN; some containers report no frame rate
+        throw std::runtime_error("Error: Could not read the frame rate of input video file: " + input_video_paths[0]);
+    }
+    int fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+
+    std::cout << "Stitching " << stream_count << " videos at " << fps << " FPS into: " << output_video_path << std::endl;
+
+    // 2. Decoder threads, one per stream
+    std::vector<FrameQueue> decoded(stream_count);
+    std::vector<std::thread> decoders;
+    std::vector<std::exception_ptr> decoder_errors(stream_count);
+    for (size_t i = 0; i < stream_count; ++i) {
+        decoders.emplace_back([&, i] {
+            try {
+                cv::Mat frame;
+                while (captures[i].read(frame) && !frame.empty()) {
+                    if (!decoded[i].push(frame.clone())) {
+                        break; // Compositing stopped
+                    }
+                }
+            } catch (...) {
+                decoder_errors[i] = std::current_exception(); // Rethrown after the join
+            }
+            decoded[i].close();
+        });
+    }
+
+    FrameQueue encoded;
+    std::thread encoder;
+    std::exception_ptr encoder_error;
+    cv::VideoWriter writer;
+    int frame_count = 0;
+    double compose_seconds = 0;
+    bool registered = true;
+    const int64 start = cv::getTickCount();
+    try {
+        // Frame sets are read in lockstep; the first stream to end ends the video
+        auto next_set = [&](std::vector<cv::Mat>& frames) {
+            frames.resize(stream_count);
+            for (size_t i = 0; i < stream_count; ++i) {
+                if (!decoded[i].pop(frames[i])) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // 3. Calibrate the rig, or load a saved calibration
+        StitchRig rig;
+        std::vector<std::vector<cv::Mat>> pending; // Calibration sets, composited afterwards
+        if (!rig_path.empty() && std::ifstream(rig_path).good()) {
+            rig.load(rig_path);
+        } else {
+            std::vector<cv::Mat> frames;
+            while (static_cast<int>(pending.size()) < calibration_frames && next_set(frames)) {
+                pending.push_back(frames);
+                StitchRig candidate;
+                std::cout << "Calibrating rig on frame set " << pending.size() << "..." << std::endl;
+                if (candidate.calibrate(frames, options) == cv::Stitcher::OK
+                    && candidate.camera_count() > rig.camera_count()) {
+                    rig = std::move(candidate);
+                    if (rig.camera_count() == stream_count) {
+                        break; // Every camera registered
+                    }
+                }
+            }
+            if (rig.calibrated() && !rig_path.empty()) {
+                rig.save(rig_path);
+            }
+        }
+        registered = rig.calibrated();
+
+        if (registered) {
+            // 4. Encoder thread, fed with composited panoramas
+            writer.open(output_video_path, fourcc, fps, rig.panorama_size(), true);
+            if (!writer.isOpened()) {
+                throw std::runtime_error("Error: Could not create output video file: " + output_video_path);
+            }
+            encoder = std::thread([&] {
+                try {
+                    cv::Mat pano;
+                    while (encoded.pop(pano)) {
+                        writer.write(pano);
+                    }
+                } catch (...) {
+                    encoder_error = std::current_exception();
+                    encoded.close();
+                }
+            });
+
+            // 5. Composite the calibration sets, then the rest of the streams
+            auto compose_set = [&](const std::vector<cv::Mat>& frames) {
+                const int64 compose_start = cv::getTickCount();
+                cv::Mat pano;
+                cv::Mat pano_mask;
+                rig.compose(frames, pano, pano_mask);
+                compose_seconds += (cv::getTickCount() - compose_start) / cv::getTickFrequency();
+                frame_count++;
+                if (frame_count % 100 == 0) {
+                    std::cout << "Processed " << frame_count << " frames..." << std::endl;
+                }
+                return encoded.push(pano);
+            };
+            bool encoding = true;
+            for (size_t i = 0; i < pending.size() && encoding; ++i) {
+                encoding = compose_set(pending[i]);
+            }
+            pending.clear();
+            std::vector<cv::Mat> frames;
+            while (encoding && next_set(frames)) {
+                encoding = compose_set(frames);
+            }
+        } else {
+            std::cerr << "Error: None of the first " << pending.size() << " frame sets could be registered." << std::endl;
+        }
+    } catch (...) {
+        for (FrameQueue& queue : decoded) {
+            queue.close();
+        }
+        encoded.close();
+        for (std::thread& decoder : decoders) {
+            decoder.join();
+        }
+        if (encoder.joinable()) {
+            encoder.join();
+        }
+        throw;
+    }
+
+    // 6. Drain the pipeline and release resources
+    for (FrameQueue& queue : decoded) {
+        queue.close();
+    }
+    encoded.close();
+    for (std::thread& decoder : decoders) {
+        decoder.join();
+    }
+    if (encoder.joinable()) {
+        encoder.join();
+    }
+    for (const std::exception_ptr& decoder_error : decoder_errors) {
+        if (decoder_error) {
+            std::rethrow_exception(decoder_error);
+        }
+    }
+    if (encoder_error) {
+        std::rethrow_exception(encoder_error);
+    }
+    for (cv::VideoCapture& capture : captures) {
+        capture.release();
+    }
+    writer.release();
+
+    const double seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+    std::cout << "Finished stitching " << frame_count << " frames in " << seconds << " s ("
+              << (seconds > 0 ? frame_count / seconds : 0.0) << " FPS, compositing "
+              << (frame_count > 0 ? compose_seconds * 1000.0 / frame_count : 0.0) << " ms per frame)." << std::endl;
+
+    return registered;
+}
@@ -2,9 +2,11 @@
 #define AI_SLOP_VIDEO_PROCESSING_HPP
 
 #include <string>
+#include <vector>
 #include <opencv2/core.hpp>
 #include <opencv2/videoio.hpp> // For cv::VideoCapture, cv::VideoWriter
 #include <opencv2/imgproc.hpp> // For cv::cvtColor etc.
+#include "core/stitching.hpp"  // For StitchOptions
 
 /**
  * @brief Processes an input video file, applies a grayscale filter to each frame,
@@ -37,6 +39,59 @@ bool process_video_bg_subtract_mog2(const std::string& input_video_path,
                                      double var_threshold = 16, // Default threshold
                                      bool detect_shadows = true); // Default detect shadows
 
+/**
+ * @brief Resizes every frame of a video by a given factor.
+ *
+ * Frames go through the target-size resize_image() with one ResizeWorkspace for the
+ * whole stream, so reductions below half size use the 2x pyramid like an image resize,
+ * and the ResizePlan and pyramid levels are built on the first frame and reused.
+ *
+ * @param input_video_path Path to the input video file.
+ * @param output_video_path Path where the resized video will be saved.
+ * @param factor The scaling factor. Must be positive.
+ * @param interpolation The interpolation method to use (default: cv::INTER_LINEAR).
+ * @return bool True if processing was successful, false otherwise.
+ * @throws std::invalid_argument if factor is not positive.
+ * @throws std::runtime_error if the input video cannot be opened or the output video cannot be created.
+ */
+bool process_video_resize(const std::string& input_video_path,
+                          const std::string& output_video_path,
+                          double factor,
+                          int interpolation = cv::INTER_LINEAR);
+
+/**
+ * @brief Stitches synchronized videos from a fixed camera rig into a panoramic video.
+ *
+ * The rig is calibrated once (see StitchRig): the first frame sets are tried in turn
+ * until one registers every camera, otherwise the set that registered the most
+ * cameras is kept. Every frame set, the calibration sets included, is then composited
+ * with the precomputed warp maps and fixed seams.
+ *
+ * Decoding, compositing and encoding run as a pipeline: one decoder thread per input
+ * stream, compositing on the calling thread (itself parallel per camera and per row
+ * band), and one encoder thread, connected by short bounded queues. The streams are
+ * read in lockstep, one frame of each per set; the output ends with the shortest stream.
+ *
+ * @param input_video_paths Paths of the input videos, one per camera, in rig order.
+ * @param output_video_path Path where the panoramic video will be saved.
+ * @param calibration_frames Number of leading frame sets tried for calibration.
+ * @param options Stage resolutions and pair selection for the calibration.
+ * @param rig_path Optional rig calibration file: loaded if it exists (no calibration
+ *                 is run), written after calibration otherwise.
+ * @return bool True if processing was successful, false if no frame set could be
+ *         registered.
+ * @throws std::invalid_argument if fewer than two videos are given or calibration_frames is not positive.
+ * @throws std::runtime_error if an input video cannot be opened or reports no frame rate, or the output
+ *         video cannot be created.
+ * @throws cv::Exception (or another exception) raised while decoding a stream; it ends the video at
+ *         that frame set and is rethrown once the pipeline has stopped.
+ */
+bool process_video_stitch(const std::vector<std::string>& input_video_paths,
+                          const std::string& output_video_path,
+                          int calibration_frames = 10,
+                          const StitchOptions& options = StitchOptions(),
+                          const std::string& rig_path = std::string());
+
 // Add other video processing functions here later (e.g., applying different filters, stabilization, etc.)
 
 #endif // AI_SLOP_VIDEO_PROCESSING_HPP 
\ No newline at end of file
@@ -5,9 +5,13 @@
 #include <vector>
 #include <optional> // Used for optional arguments
 #include <iostream> // For error messages
+#include <sstream>  // For splitting list-valued options
+#include <utility>  // For std::pair
+#include <algorithm> // For std::find
 
 // Include the cxxopts header
 #include "cxxopts.hpp"
+#include "core/pnm_stream.hpp" // For is_pnm_path
 
 // Forward declaration from OpenCV (to avoid including heavy headers here if possible)
 // However, for simplicity in this header, direct inclusion might be okay,
@@ -25,10 +29,51 @@ struct ParsedArguments {
 
     // Operation-specific parameters (using std::optional for clarity)
     std::optional<int> kernel_size;         // For dilate/erode
+    std::optional<int> iterations;          // For dilate/erode and compound morphology
+    std::optional<std::string> morph_shape; // Structuring element shape (rect, cross, ellipse)
     std::optional<double> resize_factor;    // For resize
+    std::optional<int> resize_width;        // Target width for resize (instead of a factor)
+    std::optional<int> resize_height;       // Target height for resize (instead of a factor)
+    std::optional<std::string> resize_mode; // How a target size treats aspect ratio (exact, fit, fill)
+    bool resize_stream = false;             // Stream a PGM/PPM resize strip by strip instead of loading it
+    std::optional<int> resize_benchmark;    // Repeat count for timing the bilinear kernel against cv::resize
+    std::optional<int> morphology_benchmark; // Repeat count for timing rectangular dilate/erode against OpenCV
     std::optional<int> brightness_value;    // For brightness adjustment
+    std::optional<double> contrast_gain;    // For adjust: contrast gain around mid-gray
+    std::optional<double> gamma_value;      // For adjust: gamma correction
+    std::optional<std::vector<double>> levels; // For adjust: in_black,in_white[,out_black,out_white]
+    bool invert = false;                    // For adjust: invert intensities
+    std::optional<double> threshold_value;  // For adjust: binary threshold applied last
     std::optional<double> canny_threshold1; // For Canny edge detection
     std::optional<double> canny_threshold2; // For Canny edge detection
+    std::optional<int> canny_blur;          // Gaussian pre-blur size for Canny (0, 3 or 5)
+    bool canny_tiled = false;               // Band-parallel suppression and hysteresis for Canny
+    std::optional<std::string> canny_auto;  // Automatic Canny thresholds (median, otsu) instead of -t1/-t2
+    std::optional<std::vector<std::pair<double, double>>> canny_sweep; // Canny threshold pairs sharing one gradient pass
+    std::optional<std::string> edge_format; // Canny output: png (dense image), points or contours (binary edge list)
+    bool edge_subpixel = false;             // Subpixel coordinates in a Canny edge list
+
+    std::optional<std::string> feature_cache_dir; // Directory of the stitching feature cache
+    std::optional<std::string> stitch_preset;     // Stitching speed preset (fast, balanced, quality)
+    std::optional<double> registration_resol;     // Stitching registration resolution in megapixels
+    std::optional<double> seam_resol;             // Stitching seam estimation resolution in megapixels
+    std::optional<double> compositing_resol;      // Stitching compositing resolution in megapixels (-1 = original)
+    std::optional<std::string> stitch_session;    // Directory of an incremental stitching session
+    int stitch_tile_size = 256;                   // DeepZoom tile size for .dzi stitch output
+    std::string stitch_tile_format = "png";       // DeepZoom tile format (png or jpg)
+    int stitch_memory_budget_mb = 2048;           // Source image budget for .dzi stitch output
+    int stitch_match_range = 0;                   // Match each stitch input with the next N inputs only (0 = all pairs)
+    std::optional<std::string> stitch_gps_file;   // GPS positions of the stitch inputs (path, latitude, longitude)
+    double stitch_gps_radius_m = 100.0;           // Match stitch inputs taken within this many metres
+    bool stitch_indexed_matching = false;         // One FLANN/LSH index per stitch input instead of one per pair
+    bool stitch_match_benchmark = false;          // Time pair matching for 10..500 inputs instead of stitching
+    std::optional<std::string> stitch_rig;        // Calibration file of a fixed camera rig
+    int stitch_calibration_frames = 10;           // Leading frame sets tried to calibrate video-stitch
+    std::optional<std::string> seam_finder;       // Stitching seam finder (none, voronoi, dp, graphcut)
+    std::optional<std::string> exposure;          // Stitching exposure compensator (none, gain, blocks, channels)
+    std::optional<std::string> blender;           // Stitching blender (feather, multiband)
+    std::optional<int> blend_bands;               // Bands of the multi-band blender
+    bool strip_blending = true;                   // Blend vertical strips of the panorama in parallel
 
     // --- Advanced Feature Args ---
     std::optional<std::string> cascade_file; // Path to Haar cascade XML for face detection
@@ -59,15 +104,54 @@ inline ParsedArguments parse_arguments(int argc, char** argv) {
 
         options.add_options()
             ("h,help", "Display this help message")
-            ("op,operation", "The operation to perform (dilate, erode, resize, brightness, stitch, canny, video-gray, detect-faces, bg-subtract, detect-objects, inpaint)", cxxopts::value<std::string>())
-            ("i,input", "Input image/video file path(s). Multiple allowed for stitch.", cxxopts::value<std::vector<std::string>>())
-            ("o,output", "Output image/video file path", cxxopts::value<std::string>())
+            ("op,operation", "The operation to perform (dilate, erode, open, close, gradient, tophat, blackhat, resize, brightness, adjust, stitch, canny, video-gray, video-resize, video-stitch, detect-faces, bg-subtract, detect-objects, inpaint)", cxxopts::value<std::string>())
+            ("i,input", "Input image/video file path(s). Multiple allowed for stitch, video-stitch and resize.", cxxopts::value<std::vector<std::string>>())
+            ("o,output", "Output image/video file path (output directory for multi-image resize)", cxxopts::value<std::string>())
             // Core operation-specific options
-            ("k,kernel_size", "Kernel size for dilation/erosion (positive odd integer)", cxxopts::value<int>()->default_value("3"))
-            ("f,factor", "Resize factor (e.g., 1.5 for 150%, 0.5 for 50%)", cxxopts::value<double>())
+            ("k,kernel_size", "Kernel size for dilation/erosion and compound morphology (positive odd integer)", cxxopts::value<int>()->default_value("3"))
+            ("iterations", "Number of iterations for dilation/erosion and compound morphology (positive integer)", cxxopts::value<int>()->default_value("1"))
+            ("shape", "Structuring element shape for morphology (rect, cross, ellipse)", cxxopts::value<std::string>()->default_value("rect"))
+            ("f,factor", "Resize factor (e.g., 1.5 for 150%, 0.5 for 50%); 8-bit bilinear resizes use a table-driven kernel with the same output as cv::resize, factors below 0.5 a 2x pyramid first", cxxopts::value<double>())
+            ("width", "Target width in pixels for resize (use with --height instead of --factor)", cxxopts::value<int>())
+            ("height", "Target height in pixels for resize (use with --width instead of --factor)", cxxopts::value<int>())
+            ("fit", "How resize matches --width/--height: exact, fit (keep aspect, inside box) or fill (keep aspect, crop)", cxxopts::value<std::string>()->default_value("exact"))
+            ("benchmark", "Time N runs of resize (bilinear kernel vs cv::resize, megapixels/s) or dilate/erode (engine vs OpenCV at k = 3..201, ms)", cxxopts::value<int>())
+            ("stream", "Resize a binary PGM/PPM file strip by strip without loading it into memory (output is PGM/PPM)")
             ("b,brightness", "Value to add/subtract for brightness adjustment (-255 to 255)", cxxopts::value<int>()->default_value("0"))
+            ("tiled", "Run Canny suppression and hysteresis band-parallel (same edges as the single-threaded path)")
+            ("canny-auto", "Choose Canny thresholds from the gradient histogram instead of -t1/-t2: median or otsu", cxxopts::value<std::string>())
+            ("sweep", "Run Canny for several threshold pairs t1:t2,t1:t2,... sharing one gradient pass (-o pattern with {t1}/{t2})", cxxopts::value<std::string>())
+            ("contrast", "Contrast gain around mid-gray (for adjust; 1.0 = unchanged)", cxxopts::value<double>())
+            ("gamma", "Gamma correction (for adjust; >1 brightens mid-tones)", cxxopts::value<double>())
+            ("levels", "Input/output levels as in_black,in_white[,out_black,out_white] (for adjust)", cxxopts::value<std::string>())
+            ("invert", "Invert intensities (for adjust)")
+            ("threshold", "Binary threshold applied after the other adjustments (for adjust)", cxxopts::value<double>())
             ("t1,threshold1", "First threshold for the Canny edge detector hysteresis procedure", cxxopts::value<double>()->default_value("100.0"))
             ("t2,threshold2", "Second threshold for the Canny edge detector hysteresis procedure", cxxopts::value<double>()->default_value("200.0"))
+            ("blur", "Gaussian pre-blur size before Canny edge detection: 0 (none), 3 or 5", cxxopts::value<int>()->default_value("0"))
+            ("edge-format", "Canny output format: png (edge image), points or contours (binary edge list written to -o)", cxxopts::value<std::string>()->default_value("png"))
+            ("subpixel", "Write subpixel edge positions in a Canny edge list (points or contours)")
+            ("feature-cache", "Existing directory for cached stitching features; re-stitching the same images skips detection", cxxopts::value<std::string>())
+            ("preset", "Stitching speed preset: fast (preview), balanced (default) or quality", cxxopts::value<std::string>())
+            ("registration-resol", "Stitching registration resolution in megapixels (-1 = original)", cxxopts::value<double>())
+            ("seam-resol", "Stitching seam estimation resolution in megapixels (-1 = original)", cxxopts::value<double>())
+            ("compositing-resol", "Stitching compositing resolution in megapixels (-1 = original)", cxxopts::value<double>())
+            ("session", "Existing directory of an incremental stitching session; stitch adds the inputs to it", cxxopts::value<std::string>())
+            ("tile-size", "Tile size of a DeepZoom stitch output (-o pano.dzi)", cxxopts::value<int>()->default_value("256"))
+            ("tile-format", "Tile format of a DeepZoom stitch output: png or jpg", cxxopts::value<std::string>()->default_value("png"))
+            ("memory-budget", "Memory budget in MB for source images while compositing a DeepZoom stitch output", cxxopts::value<int>()->default_value("2048"))
+            ("match-range", "Stitching: match each image with the next N inputs only (ordered captures; 0 = all pairs)", cxxopts::value<int>()->default_value("0"))
+            ("gps", "Stitching: text file of 'image latitude longitude' lines; images taken within --gps-radius are matched", cxxopts::value<std::string>())
+            ("gps-radius", "Stitching: distance in metres under which GPS-tagged images are matched", cxxopts::value<double>()->default_value("100"))
+            ("lsh", "Stitching: match through one FLANN index per image (LSH for ORB) built once, not one per pair")
+            ("rig", "Stitching: calibration file of a fixed camera rig; created from the inputs if missing, then only compositing runs", cxxopts::value<std::string>())
+            ("seam-finder", "Stitching seam finder: none, voronoi, dp or graphcut (overrides the preset)", cxxopts::value<std::string>())
+            ("exposure", "Stitching exposure compensator: none, gain, blocks or channels (overrides the preset)", cxxopts::value<std::string>())
+            ("blender", "Stitching blender: feather or multiband (overrides the preset)", cxxopts::value<std::string>())
+            ("blend-bands", "Number of bands of the multiband stitching blender (overrides the preset)", cxxopts::value<int>())
+            ("single-blend", "Stitching: blend the whole panorama with one blender instead of parallel strips (same output)")
+            ("calibration-frames", "video-stitch: number of leading frame sets tried to calibrate the rig", cxxopts::value<int>()->default_value("10"))
+            ("match-benchmark", "Stitching: time pair matching over the first 10..500 inputs (all pairs, range, range + --lsh) instead of stitching")
             // Advanced operation-specific options
             ("c,cascade", "Path to the cascade classifier XML file (for detect-faces)", cxxopts::value<std::string>())
             // YOLO Object Detection options
@@ -119,19 +203,50 @@ inline ParsedArguments parse_arguments(int argc, char** argv) {
         args.canny_threshold1 = result["threshold1"].as<double>(); // Always parse, default exists
         args.canny_threshold2 = result["threshold2"].as<double>(); // Always parse, default exists
 
-        // Dilate/Erode specific
-        if (args.operation == "dilate" || args.operation == "erode") {
+        // Dilate/Erode and compound morphology specific
+        if (args.operation == "dilate" || args.operation == "erode"
+            || args.operation == "open" || args.operation == "close" || args.operation == "gradient"
+            || args.operation == "tophat" || args.operation == "blackhat") {
             args.kernel_size = result["kernel_size"].as<int>();
             // Basic validation for kernel size
             if (args.kernel_size.value() <= 0 || args.kernel_size.value() % 2 == 0) {
                 throw std::runtime_error("Kernel size (--kernel_size or -k) must be a positive odd integer.");
             }
+            args.iterations = result["iterations"].as<int>();
+            if (args.iterations.value() <= 0) {
+                throw std::runtime_error("Iteration count (--iterations) must be a positive integer.");
+            }
+            args.morph_shape = result["shape"].as<std::string>();
+            if (args.morph_shape.value() != "rect" && args.morph_shape.value() != "cross"
+                && args.morph_shape.value() != "ellipse") {
+                throw std::runtime_error("Structuring element shape (--shape) must be 'rect', 'cross' or 'ellipse'.");
+            }
         }
 
         // Resize specific
-        if (args.operation == "resize") {
+        if (args.operation == "resize" && !result.count("factor")
+            && (result.count("width") || result.count("height"))) {
+            // Target-size resize (single image only)
+            if (!result.count("width") || !result.count("height")) {
+                throw std::runtime_error("Target-size resize requires both --width and --height.");
+            }
+            if (args.input_files.size() != 1) {
+                throw std::runtime_error("Target-size resize supports a single input image; use --factor for batches.");
+            }
+            args.resize_width = result["width"].as<int>();
+            args.resize_height = result["height"].as<int>();
+            if (args.resize_width.value() <= 0 || args.resize_height.value() <= 0) {
+                throw std::runtime_error("Target size (--width, --height) must be positive.");
+            }
+            args.resize_mode = result["fit"].as<std::string>();
+            if (args.resize_mode.value() != "exact" && args.resize_mode.value() != "fit"
+                && args.resize_mode.value() != "fill") {
+                throw std::runtime_error("Resize mode (--fit) must be 'exact', 'fit' or 'fill'.");
+            }
+        }
+        else if (args.operation == "resize" || args.operation == "video-resize") {
             if (!result.count("factor")) {
-                 throw std::runtime_error("Resize factor (--factor or -f) is required for resize operation.");
+                 throw std::runtime_error("Resize factor (--factor or -f) or target size (--width, --height) is required for resize operation.");
             }
             args.resize_factor = result["factor"].as<double>();
              if (args.resize_factor.value() <= 0) {
@@ -139,6 +254,36 @@ inline ParsedArguments parse_arguments(int argc, char** argv) {
             }
         }
 
+        // Streaming resize: a single PNM file in and out, exact size only
+        if (result.count("stream")) {
+            if (args.operation != "resize") {
+                throw std::runtime_error("--stream is only supported by the resize operation.");
+            }
+            if (args.input_files.size() != 1) {
+                throw std::runtime_error("Streaming resize requires exactly one input file.");
+            }
+            if (args.resize_mode.value_or("exact") != "exact") {
+                throw std::runtime_error("Streaming resize supports only --fit exact.");
+            }
+            if (!is_pnm_path(args.input_files[0]) || !is_pnm_path(args.output_file)) {
+                throw std::runtime_error("Streaming resize reads and writes only .pgm, .ppm or .pnm files.");
+            }
+            args.resize_stream = true;
+        }
+
+        // Benchmarks: single in-memory image only
+        if (result.count("benchmark")) {
+            const bool morphology = args.operation == "dilate" || args.operation == "erode";
+            if ((!morphology && (args.operation != "resize" || args.resize_stream)) || args.input_files.size() != 1) {
+                throw std::runtime_error("--benchmark is only supported by dilate, erode and single-image, in-memory resize.");
+            }
+            const int repeats = result["benchmark"].as<int>();
+            if (repeats <= 0) {
+                throw std::runtime_error("Benchmark repeat count (--benchmark) must be positive.");
+            }
+            (morphology ? args.morphology_benchmark : args.resize_benchmark) = repeats;
+        }
+
         // Brightness specific
         if (args.operation == "brightness") {
              // Use default if not provided, but capture it
@@ -149,6 +294,40 @@ inline ParsedArguments parse_arguments(int argc, char** argv) {
              // }
         }
 
+        // Fused point operations: brightness, contrast, levels, gamma, invert, threshold (in that order)
+        if (args.operation == "adjust") {
+            args.brightness_value = result["brightness"].as<int>();
+            if (result.count("contrast")) {
+                args.contrast_gain = result["contrast"].as<double>();
+            }
+            if (result.count("gamma")) {
+                args.gamma_value = result["gamma"].as<double>();
+                if (args.gamma_value.value() <= 0) {
+                    throw std::runtime_error("Gamma (--gamma) must be positive.");
+                }
+            }
+            if (result.count("levels")) {
+                std::vector<double> values;
+                std::stringstream list(result["levels"].as<std::string>());
+                std::string item;
+                while (std::getline(list, item, ',')) {
+                    try {
+                        values.push_back(std::stod(item));
+                    } catch (const std::exception&) {
+                        throw std::runtime_error("Levels (--levels) must be comma-separated numbers.");
+                    }
+                }
+                if ((values.size() != 2 && values.size() != 4) || values[1] <= values[0]) {
+                    throw std::runtime_error("Levels (--levels) must be in_black,in_white[,out_black,out_white] with in_white > in_black.");
+                }
+                args.levels = values;
+            }
+            args.invert = result.count("invert") > 0;
+            if (result.count("threshold")) {
+                args.threshold_value = result["threshold"].as<double>();
+            }
+        }
+
         // Canny specific
         if (args.operation == "canny") {
             args.canny_threshold1 = result["threshold1"].as<double>();
@@ -160,17 +339,157 @@ inline ParsedArguments parse_arguments(int argc, char** argv) {
                  // OpenCV documentation often suggests threshold2 > threshold1
                  std::cerr << "Warning: threshold1 is greater than threshold2 for Canny detector." << std::endl;
              }
+            args.canny_blur = result["blur"].as<int>();
+            if (args.canny_blur.value() != 0 && args.canny_blur.value() != 3 && args.canny_blur.value() != 5) {
+                throw std::runtime_error("Canny blur size (--blur) must be 0, 3 or 5.");
+            }
+            args.canny_tiled = result.count("tiled") > 0;
+            if (result.count("canny-auto")) {
+                args.canny_auto = result["canny-auto"].as<std::string>();
+                if (args.canny_auto.value() != "median" && args.canny_auto.value() != "otsu") {
+                    throw std::runtime_error("Automatic Canny thresholds (--canny-auto) must be 'median' or 'otsu'.");
+                }
+            }
+            if (result.count("sweep")) {
+                std::vector<std::pair<double, double>> pairs;
+                std::stringstream list(result["sweep"].as<std::string>());
+                std::string item;
+                while (std::getline(list, item, ',')) {
+                    const size_t colon = item.find(':');
+                    try {
+                        if (colon == std::string::npos) {
+                            throw std::invalid_argument(item);
+                        }
+                        pairs.emplace_back(std::stod(item.substr(0, colon)), std::stod(item.substr(colon + 1)));
+                    } catch (const std::exception&) {
+                        throw std::runtime_error("Canny sweep (--sweep) must be a comma-separated list of t1:t2 pairs.");
+                    }
+                    if (pairs.back().first < 0 || pairs.back().second < 0) {
+                        throw std::runtime_error("Canny thresholds must be non-negative.");
+                    }
+                }
+                if (pairs.empty()) {
+                    throw std::runtime_error("Canny sweep (--sweep) needs at least one t1:t2 pair.");
+                }
+                if (args.output_file.find("{t1}") == std::string::npos && args.output_file.find("{t2}") == std::string::npos) {
+                    throw std::runtime_error("Canny sweep output (-o) must contain {t1} and/or {t2} placeholders.");
+                }
+                if (args.canny_auto.has_value()) {
+                    throw std::runtime_error("Canny sweep (--sweep) and automatic thresholds (--canny-auto) cannot be combined.");
+                }
+                args.canny_sweep = pairs;
+            }
+            args.edge_format = result["edge-format"].as<std::string>();
+            if (args.edge_format.value() != "png" && args.edge_format.value() != "points"
+                && args.edge_format.value() != "contours") {
+                throw std::runtime_error("Canny edge format (--edge-format) must be 'png', 'points' or 'contours'.");
+            }
+            args.edge_subpixel = result.count("subpixel") > 0;
+            if (args.edge_format.value() != "png" && (args.canny_sweep.has_value() || args.canny_auto.has_value())) {
+                throw std::runtime_error("Edge list output (--edge-format) cannot be combined with --sweep or --canny-auto.");
+            }
+            if (args.edge_subpixel && args.edge_format.value() == "png") {
+                throw std::runtime_error("Subpixel positions (--subpixel) require --edge-format points or contours.");
+            }
         }
 
         // Stitch specific validation
-        if (args.operation == "stitch" && args.input_files.size() < 2) {
+        if (args.operation == "stitch" && result.count("session")) {
+            args.stitch_session = result["session"].as<std::string>();
+            if (args.input_files.empty()) {
+                throw std::runtime_error("Stitch operation with --session requires at least one input image.");
+            }
+        } else if (args.operation == "stitch" && args.input_files.size() < 2) {
             throw std::runtime_error("Stitch operation requires at least two input images.");
+        } else if (args.operation == "video-stitch" && args.input_files.size() < 2) {
+            throw std::runtime_error("Video stitch operation requires at least two input videos, one per camera.");
+        }
+        if (args.operation == "stitch" || args.operation == "video-stitch") {
+            if (result.count("feature-cache")) {
+                args.feature_cache_dir = result["feature-cache"].as<std::string>();
+            }
+            if (result.count("preset")) {
+                args.stitch_preset = result["preset"].as<std::string>();
+                if (args.stitch_preset.value() != "fast" && args.stitch_preset.value() != "balanced"
+                    && args.stitch_preset.value() != "quality") {
+                    throw std::runtime_error("Stitching preset (--preset) must be 'fast', 'balanced' or 'quality'.");
+                }
+            }
+            args.stitch_tile_size = result["tile-size"].as<int>();
+            args.stitch_tile_format = result["tile-format"].as<std::string>();
+            args.stitch_memory_budget_mb = result["memory-budget"].as<int>();
+            if (args.stitch_tile_size <= 0 || args.stitch_memory_budget_mb <= 0) {
+                throw std::runtime_error("Tile size (--tile-size) and memory budget (--memory-budget) must be positive.");
+            }
+            if (args.stitch_tile_format != "png" && args.stitch_tile_format != "jpg") {
+                throw std::runtime_error("Tile format (--tile-format) must be 'png' or 'jpg'.");
+            }
+            args.stitch_match_range = result["match-range"].as<int>();
+            args.stitch_gps_radius_m = result["gps-radius"].as<double>();
+            if (args.stitch_match_range < 0 || args.stitch_gps_radius_m <= 0) {
+                throw std::runtime_error("Match range (--match-range) must not be negative and GPS radius (--gps-radius) must be positive.");
+            }
+            if (result.count("gps")) {
+                args.stitch_gps_file = result["gps"].as<std::string>();
+            }
+            args.stitch_indexed_matching = result.count("lsh") > 0;
+            args.stitch_match_benchmark = result.count("match-benchmark") > 0;
+            if (args.stitch_match_benchmark && (args.stitch_session.has_value() || args.operation == "video-stitch")) {
+                throw std::runtime_error("--match-benchmark cannot be combined with a stitching session (--session) or video-stitch.");
+            }
+            auto parse_choice = [&](const char* option, const std::vector<std::string>& allowed,
+                                    std::optional<std::string>& field) {
+                if (result.count(option)) {
+                    field = result[option].as<std::string>();
+                    if (std::find(allowed.begin(), allowed.end(), field.value()) == allowed.end()) {
+                        throw std::runtime_error("Unknown value '" + field.value() + "' for --" + option + ".");
+                    }
+                }
+            };
+            parse_choice("seam-finder", {"none", "voronoi", "dp", "graphcut"}, args.seam_finder);
+            parse_choice("exposure", {"none", "gain", "blocks", "channels"}, args.exposure);
+            parse_choice("blender", {"feather", "multiband"}, args.blender);
+            args.strip_blending = result.count("single-blend") == 0;
+            if (result.count("blend-bands")) {
+                args.blend_bands = result["blend-bands"].as<int>();
+                if (args.blend_bands.value() < 1) {
+                    throw std::runtime_error("Blend bands (--blend-bands) must be at least 1.");
+                }
+            }
+            args.stitch_calibration_frames = result["calibration-frames"].as<int>();
+            if (args.stitch_calibration_frames <= 0) {
+                throw std::runtime_error("Calibration frames (--calibration-frames) must be positive.");
+            }
+            const std::string& out = args.output_file;
+            if (args.stitch_session.has_value() && out.size() > 4 && out.compare(out.size() - 4, 4, ".dzi") == 0) {
+                throw std::runtime_error("A stitching session (--session) cannot write a DeepZoom (.dzi) output.");
+            }
+            if (result.count("rig")) {
+                args.stitch_rig = result["rig"].as<std::string>();
+                if (args.stitch_session.has_value() || args.stitch_match_benchmark
+                    || (out.size() > 4 && out.compare(out.size() - 4, 4, ".dzi") == 0)) {
+                    throw std::runtime_error("A stitching rig (--rig) cannot be combined with --session, --match-benchmark or a .dzi output.");
+                }
+            }
+            const std::pair<const char*, std::optional<double>*> resolutions[] = {
+                {"registration-resol", &args.registration_resol},
+                {"seam-resol", &args.seam_resol},
+                {"compositing-resol", &args.compositing_resol}};
+            for (const auto& resolution : resolutions) {
+                if (result.count(resolution.first)) {
+                    *resolution.second = result[resolution.first].as<double>();
+                    if (resolution.second->value() == 0) {
+                        throw std::runtime_error(std::string("Stitching resolution (--") + resolution.first
+                                                 + ") must be positive megapixels or -1 for the original resolution.");
+                    }
+                }
+            }
         }
 
         // Video specific validation (expects exactly one input)
-        if ((args.operation == "video-gray" || args.operation == "bg-subtract") 
+        if ((args.operation == "video-gray" || args.operation == "video-resize" || args.operation == "bg-subtract")
              && args.input_files.size() != 1) {
-            throw std::runtime_error("Video operations (video-gray, bg-subtract) require exactly one input video file.");
+            throw std::runtime_error("Video operations (video-gray, video-resize, bg-subtract) require exactly one input video file.");
         }
 
         // Face Detection specific
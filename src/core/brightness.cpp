@@ -1,21 +1,213 @@
 #include "brightness.hpp"
+#include "parallel.hpp"
+#include <opencv2/core/hal/intrin.hpp> // Universal intrinsics for the saturating add
 #include <stdexcept> // For std::invalid_argument
+#include <algorithm>
+#include <cmath>
+#include <string>
 
-cv::Mat adjust_brightness(const cv::Mat& input_image, int value) {
+/**
+ * @brief Saturating add of value to every element of an 8-bit image, row by row.
+ *        dst must already have the size and type of src, and may be src itself.
+ */
+static void add_saturate_8u(const cv::Mat& src, cv::Mat& dst, int value) {
+    const int width = src.cols * src.channels();
+    const bool darken = value < 0;
+    const uchar amount = static_cast<uchar>(darken ? std::min(255, -std::max(value, -255)) : std::min(255, value));
+
+    parallel_for_ref(cv::Range(0, src.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uchar* s = src.ptr<uchar>(y);
+            uchar* d = dst.ptr<uchar>(y);
+            int x = 0;
+#if CV_SIMD
+            // + and - saturate on v_uint8, like cv::add on CV_8U
+            const cv::v_uint8 step = cv::vx_setall_u8(amount);
+            const int lanes = cv::v_uint8::nlanes;
+            for (; x <= width - lanes; x += lanes) {
+                const cv::v_uint8 pixels = cv::vx_load(s + x);
+                cv::v_store(d + x, darken ? pixels - step : pixels + step);
+            }
+#endif
+            for (; x < width; ++x) {
+                d[x] = cv::saturate_cast<uchar>(darken ? s[x] - amount : s[x] + amount);
+            }
+        }
+    });
+}
+
+void adjust_brightness(const cv::Mat& input_image, cv::Mat& output_image, int value) {
     if (input_image.empty()) {
         throw std::invalid_argument("Input image for brightness adjustment is empty.");
     }
 
-    // Create an output image of the same size and type as the input
-    cv::Mat adjusted_image;
+    if (input_image.depth() == CV_8U) {
+        // Own kernel for the common case: same result as cv::add, but no scalar
+        // conversion buffers, so a reused destination means no allocation at all
+        output_image.create(input_image.size(), input_image.type());
+        add_saturate_8u(input_image, output_image, value);
+        return;
+    }
 
     // Add the scalar value to the input image.
     // OpenCV's add function handles saturation automatically for standard types like CV_8U.
     // It ensures pixel values stay within the valid range [0, 255].
-    cv::add(input_image, cv::Scalar(value, value, value, value), adjusted_image);
+    // output_image is reused when it already has the right size and type, and may be
+    // input_image itself (cv::add works in place).
+    cv::add(input_image, cv::Scalar(value, value, value, value), output_image);
     // Note: The Scalar constructor takes up to 4 values (B, G, R, Alpha).
     // If the input image has fewer channels, the extra scalar values are ignored.
     // Using the same value for all channels provides uniform brightness adjustment.
+}
+
+cv::Mat adjust_brightness(const cv::Mat& input_image, int value) {
+    cv::Mat adjusted_image;
+    adjust_brightness(input_image, adjusted_image, value);
+    return adjusted_image;
+}
+
+// --- PointOpPipeline ---
+
+PointOpPipeline::PointOpPipeline()
+{
+    for (auto& table : tables_) {
+        for (int v = 0; v < 256; ++v) {
+            table[v] = v;
+        }
+    }
+    rebuild_luts();
+}
+
+void PointOpPipeline::rebuild_luts()
+{
+    // One ready-made table per channel count, so apply() never builds one per frame
+    for (int channels = 1; channels <= 4; ++channels) {
+        bool shared = true;
+        for (int c = 1; c < channels; ++c) {
+            shared = shared && tables_[c] == tables_[0];
+        }
+
+        const int lut_channels = shared ? 1 : channels;
+        // Fresh buffer: copies of a pipeline share their tables until they diverge
+        cv::Mat table(1, 256, CV_MAKETYPE(CV_8U, lut_channels));
+        uchar* out = table.ptr<uchar>(0);
+        for (int v = 0; v < 256; ++v) {
+            for (int c = 0; c < lut_channels; ++c) {
+                out[v * lut_channels + c] = static_cast<uchar>(std::lround(tables_[c][v]));
+            }
+        }
+        luts_[channels - 1] = table;
+    }
+}
+
+PointOpPipeline& PointOpPipeline::compose(int channel, const std::function<double(double)>& op)
+{
+    if (channel < -1 || channel > 3) {
+        throw std::invalid_argument("Point operation channel must be -1 (all) or 0-3, received: " + std::to_string(channel));
+    }
+    for (int c = 0; c < 4; ++c) {
+        if (channel != -1 && channel != c) {
+            continue;
+        }
+        for (double& value : tables_[c]) {
+            // Clamp after every step, as a chain of saturating 8-bit passes would
+            value = std::min(255.0, std::max(0.0, op(value)));
+        }
+    }
+    ++ops_;
+    rebuild_luts();
+    return *this;
+}
 
+PointOpPipeline& PointOpPipeline::brightness(double value, int channel)
+{
+    return compose(channel, [value](double v) { return v + value; });
+}
+
+PointOpPipeline& PointOpPipeline::contrast(double gain, double pivot, int channel)
+{
+    return compose(channel, [gain, pivot](double v) { return (v - pivot) * gain + pivot; });
+}
+
+PointOpPipeline& PointOpPipeline::gamma(double gamma, int channel)
+{
+    if (gamma <= 0) {
+        throw std::invalid_argument("Gamma must be positive, received: " + std::to_string(gamma));
+    }
+    const double exponent = 1.0 / gamma;
+    return compose(channel, [exponent](double v) { return 255.0 * std::pow(v / 255.0, exponent); });
+}
+
+PointOpPipeline& PointOpPipeline::levels(double in_black, double in_white, double out_black, double out_white,
+                                         int channel)
+{
+    if (in_white <= in_black) {
+        throw std::invalid_argument("Levels input white point must be above the black point.");
+    }
+    const double scale = (out_white - out_black) / (in_white - in_black);
+    return compose(channel, [=](double v) {
+        return out_black + (std::min(in_white, std::max(in_black, v)) - in_black) * scale;
+    });
+}
+
+PointOpPipeline& PointOpPipeline::invert(int channel)
+{
+    return compose(channel, [](double v) { return 255.0 - v; });
+}
+
+PointOpPipeline& PointOpPipeline::threshold(double thresh, double max_value, int channel)
+{
+    return compose(channel, [thresh, max_value](double v) { return v > thresh ? max_value : 0.0; });
+}
+
+cv::Mat PointOpPipeline::lut(int channels) const
+{
+    if (channels < 1 || channels > 4) {
+        throw std::invalid_argument("Point operations support 1-4 channels, received: " + std::to_string(channels));
+    }
+    return luts_[channels - 1];
+}
+
+void PointOpPipeline::apply(const cv::Mat& input_image, cv::Mat& output_image) const
+{
+    if (input_image.empty()) {
+        throw std::invalid_argument("Input image for point operations is empty.");
+    }
+    if (input_image.depth() != CV_8U) {
+        throw std::invalid_argument("Point operations require an 8-bit image.");
+    }
+
+    // One parallel lookup pass whatever the length of the chain. Unlike cv::LUT it keeps
+    // no per-call state on the heap, and it can run in place.
+    const cv::Mat table = lut(input_image.channels());
+    const uchar* entries = table.ptr<uchar>();
+    const int table_channels = table.channels();
+    const int width = input_image.cols * input_image.channels();
+    output_image.create(input_image.size(), input_image.type());
+
+    parallel_for_ref(cv::Range(0, input_image.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uchar* s = input_image.ptr<uchar>(y);
+            uchar* d = output_image.ptr<uchar>(y);
+            if (table_channels == 1) {
+                for (int x = 0; x < width; ++x) {
+                    d[x] = entries[s[x]];
+                }
+            } else {
+                // Interleaved per-channel tables: entry v of channel c is at v * channels + c
+                for (int x = 0; x < width; x += table_channels) {
+                    for (int c = 0; c < table_channels; ++c) {
+                        d[x + c] = entries[s[x + c] * table_channels + c];
+                    }
+                }
+            }
+        }
+    });
+}
+
+cv::Mat PointOpPipeline::apply(const cv::Mat& input_image) const
+{
+    cv::Mat adjusted_image;
+    apply(input_image, adjusted_image);
     return adjusted_image;
-} 
\ No newline at end of file
+}
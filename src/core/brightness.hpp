@@ -2,6 +2,8 @@
 #define AI_SLOP_BRIGHTNESS_HPP
 
 #include <opencv2/core.hpp> // For cv::Mat
+#include <array>
+#include <functional>
 
 /**
  * @brief Adjusts the brightness of an input image.
@@ -17,4 +19,96 @@
  */
 cv::Mat adjust_brightness(const cv::Mat& input_image, int value);
 
-#endif // AI_SLOP_BRIGHTNESS_HPP 
\ No newline at end of file
+/**
+ * @brief Adjusts brightness into a caller-owned destination.
+ *
+ * output_image is only (re)allocated when its size or type differs from the input,
+ * and may be input_image itself (in-place adjustment). 8-bit images run on a
+ * saturating SIMD add that needs no scratch memory, so with a reused destination
+ * they do not allocate (apart from the job record OpenCV's thread pool allocates per
+ * dispatch when more than one thread is used); other depths go through cv::add.
+ *
+ * @throws std::invalid_argument if the input image is empty.
+ */
+void adjust_brightness(const cv::Mat& input_image, cv::Mat& output_image, int value);
+
+/**
+ * @brief A chain of per-pixel intensity operations fused into one lookup table.
+ *
+ * Each added operation is composed into a 256-entry table per channel (kept in
+ * floating point and clamped to [0, 255] after every step, like a chain of saturating
+ * 8-bit passes but without the intermediate rounding). apply() then maps the image
+ * through the final table in one parallel lookup pass (the same mapping as cv::LUT),
+ * so a chain of any length costs a single read and write per pixel.
+ *
+ * Every operation takes an optional channel index; -1 (the default) applies it to all
+ * channels. Operations are applied in the order they are added.
+ */
+class PointOpPipeline {
+public:
+    PointOpPipeline();
+
+    /** @brief Adds value to every intensity. */
+    PointOpPipeline& brightness(double value, int channel = -1);
+
+    /** @brief Scales intensities around a pivot: (v - pivot) * gain + pivot. */
+    PointOpPipeline& contrast(double gain, double pivot = 128.0, int channel = -1);
+
+    /**
+     * @brief Applies gamma correction: 255 * (v / 255)^(1 / gamma).
+     * @throws std::invalid_argument if gamma is not positive.
+     */
+    PointOpPipeline& gamma(double gamma, int channel = -1);
+
+    /**
+     * @brief Remaps [in_black, in_white] linearly onto [out_black, out_white], clamping outside.
+     * @throws std::invalid_argument if in_white <= in_black.
+     */
+    PointOpPipeline& levels(double in_black, double in_white, double out_black = 0.0, double out_white = 255.0,
+                            int channel = -1);
+
+    /** @brief Replaces v with 255 - v. */
+    PointOpPipeline& invert(int channel = -1);
+
+    /** @brief Binary threshold: max_value where v > thresh, 0 elsewhere. */
+    PointOpPipeline& threshold(double thresh, double max_value = 255.0, int channel = -1);
+
+    /**
+     * @brief Returns the fused table: 1x256 CV_8UC1 when all channels share one table,
+     *        otherwise 1x256 with one channel per table (cv::LUT's per-channel form).
+     */
+    cv::Mat lut(int channels) const;
+
+    /**
+     * @brief Maps an 8-bit image through the fused table in one pass.
+     *
+     * @param input_image The source image (CV_8U, 1-4 channels).
+     * @return cv::Mat The adjusted image.
+     * @throws std::invalid_argument if the input is empty or not 8-bit with 1-4 channels.
+     */
+    cv::Mat apply(const cv::Mat& input_image) const;
+
+    /**
+     * @brief Maps an 8-bit image into a caller-owned destination (may be input_image itself).
+     *
+     * The fused tables are prebuilt when operations are added, so with a reused
+     * destination this performs no allocation (apart from the job record OpenCV's
+     * thread pool allocates per dispatch when more than one thread is used).
+     *
+     * @throws std::invalid_argument if the input is empty or not 8-bit with 1-4 channels.
+     */
+    void apply(const cv::Mat& input_image, cv::Mat& output_image) const;
+
+    /** @brief True if no operation has been added. */
+    bool empty() const { return ops_ == 0; }
+
+private:
+    PointOpPipeline& compose(int channel, const std::function<double(double)>& op);
+    void rebuild_luts();
+
+    std::array<std::array<double, 256>, 4> tables_; // Current value of every input level, per channel
+    std::array<cv::Mat, 4> luts_;                   // Fused 8-bit tables for 1-4 channel images
+    int ops_ = 0;
+};
+
+#endif // AI_SLOP_BRIGHTNESS_HPP
\ No newline at end of file
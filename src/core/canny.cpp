@@ -1,11 +1,478 @@
 #include "canny.hpp"
-#include <stdexcept> // For std::invalid_argument
+#include <stdexcept> // For std::invalid_argument, std::runtime_error
+#include <algorithm> // For std::max, std::min, std::fill
+#include <cmath>     // For std::sqrt
+#include <cstdlib>   // For std::abs
+#include <fstream>
+#include <mutex>
+#include <sstream>   // For std::ostringstream
+#include <string>
+#include <utility>   // For std::swap
+#include <vector>
 
-cv::Mat detect_edges_canny(const cv::Mat& input_image,
-                           double threshold1,
-                           double threshold2,
-                           int aperture_size,
-                           bool l2_gradient) 
+// --- Fused front end ---
+//
+// The grayscale conversion, the optional Gaussian pre-blur and the 3x3 Sobel pass
+// run together over bands of output rows. Each band converts and blurs only the rows
+// it needs (the band plus a halo of 1 + blur radius rows) into small per-thread
+// buffers and computes dx/dy from them while they are still cache resident, so the
+// full-size gray and blurred images of a cvtColor -> GaussianBlur -> Canny chain
+// never exist.
+
+static const int kGradientBandRows = 32;
+
+// BGR -> gray weights (0.114, 0.587, 0.299) in Q14 fixed point, as cv::cvtColor uses for 8-bit data
+static const int kGrayShift = 14;
+static const int kGrayB = 1868;
+static const int kGrayG = 9617;
+static const int kGrayR = 4899;
+
+// Binomial Gaussian kernels (what cv::GaussianBlur uses for sigma = 0) for blur sizes 3 and 5
+static const int kBlur3[] = {1, 2, 1};
+static const int kBlur5[] = {1, 4, 6, 4, 1};
+
+// Automatic thresholds: [median * (1 - sigma), median * (1 + sigma)], or [ratio * otsu, otsu]
+static const double kCannyMedianSigma = 0.33;
+static const double kCannyOtsuLowRatio = 0.5;
+
+static inline int clamp_index(int i, int n) {
+    return i < 0 ? 0 : (i >= n ? n - 1 : i);
+}
+
+static void validate_blur_size(int blur_size) {
+    if (blur_size != 0 && blur_size != 3 && blur_size != 5) {
+        throw std::invalid_argument("Canny blur size must be 0 (none), 3 or 5, received: " + std::to_string(blur_size));
+    }
+}
+
+/**
+ * @brief Converts one row of interleaved BGR(A) pixels to gray.
+ */
+static void convert_gray_row(const uchar* src, uchar* dst, int width, int cn) {
+    const int round = 1 << (kGrayShift - 1);
+    for (int x = 0; x < width; ++x, src += cn) {
+        dst[x] = static_cast<uchar>((src[0] * kGrayB + src[1] * kGrayG + src[2] * kGrayR + round) >> kGrayShift);
+    }
+}
+
+/**
+ * @brief Blurs one row with a separable binomial kernel (replicated borders).
+ *
+ * @param rows The 2 * radius + 1 gray rows centred on the output row.
+ * @param kernel Binomial weights, 2 * radius + 1 entries summing to 2^(shift / 2).
+ * @param sums Scratch for the vertical pass, width entries.
+ */
+static void blur_row(const uchar* const* rows, const int* kernel, int radius, int shift,
+                     int* sums, uchar* dst, int width) {
+    const int taps = 2 * radius + 1;
+    for (int x = 0; x < width; ++x) {
+        int s = 0;
+        for (int k = 0; k < taps; ++k) {
+            s += kernel[k] * rows[k][x];
+        }
+        sums[x] = s;
+    }
+
+    const int round = 1 << (shift - 1);
+    const int inner0 = std::min(radius, width);
+    const int inner1 = std::max(inner0, width - radius);
+    for (int x = 0; x < inner0; ++x) {
+        int s = 0;
+        for (int k = 0; k < taps; ++k) {
+            s += kernel[k] * sums[clamp_index(x + k - radius, width)];
+        }
+        dst[x] = static_cast<uchar>((s + round) >> shift);
+    }
+    for (int x = inner0; x < inner1; ++x) {
+        const int* p = sums + x - radius;
+        int s = 0;
+        for (int k = 0; k < taps; ++k) {
+            s += kernel[k] * p[k];
+        }
+        dst[x] = static_cast<uchar>((s + round) >> shift);
+    }
+    for (int x = inner1; x < width; ++x) {
+        int s = 0;
+        for (int k = 0; k < taps; ++k) {
+            s += kernel[k] * sums[clamp_index(x + k - radius, width)];
+        }
+        dst[x] = static_cast<uchar>((s + round) >> shift);
+    }
+}
+
+/**
+ * @brief 3x3 Sobel derivatives of the middle row p1 (replicated borders).
+ */
+static void sobel_row(const uchar* p0, const uchar* p1, const uchar* p2, short* dx, short* dy, int width) {
+    auto at = [&](int x) {
+        const int l = clamp_index(x - 1, width);
+        const int r = clamp_index(x + 1, width);
+        dx[x] = static_cast<short>((p0[r] - p0[l]) + 2 * (p1[r] - p1[l]) + (p2[r] - p2[l]));
+        dy[x] = static_cast<short>((p2[l] + 2 * p2[x] + p2[r]) - (p0[l] + 2 * p0[x] + p0[r]));
+    };
+    if (width == 0) {
+        return;
+    }
+    at(0);
+    for (int x = 1; x < width - 1; ++x) {
+        dx[x] = static_cast<short>((p0[x + 1] - p0[x - 1]) + 2 * (p1[x + 1] - p1[x - 1]) + (p2[x + 1] - p2[x - 1]));
+        dy[x] = static_cast<short>((p2[x - 1] + 2 * p2[x] + p2[x + 1]) - (p0[x - 1] + 2 * p0[x] + p0[x + 1]));
+    }
+    if (width > 1) {
+        at(width - 1);
+    }
+}
+
+void compute_canny_gradients(const cv::Mat& input_image, cv::Mat& dx, cv::Mat& dy, int blur_size,
+                             std::vector<int>* l1_histogram)
+{
+    if (input_image.empty()) {
+        throw std::invalid_argument("Input image for Canny gradients is empty.");
+    }
+    const int cn = input_image.channels();
+    if (input_image.depth() != CV_8U || (cn != 1 && cn != 3 && cn != 4)) {
+        throw std::invalid_argument("Canny gradients require an 8-bit image with 1, 3 or 4 channels.");
+    }
+    validate_blur_size(blur_size);
+
+    const int rows = input_image.rows;
+    const int width = input_image.cols;
+    const int radius = blur_size / 2;
+    const int* kernel = blur_size == 5 ? kBlur5 : kBlur3;
+    const int shift = blur_size == 5 ? 8 : 4;
+    const int bands = (rows + kGradientBandRows - 1) / kGradientBandRows;
+
+    dx.create(input_image.size(), CV_16SC1);
+    dy.create(input_image.size(), CV_16SC1);
+    if (l1_histogram) {
+        l1_histogram->assign(kCannyHistogramBins, 0);
+    }
+    std::mutex histogram_mutex;
+
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+        // Per-thread band buffers, reused for every band
+        const size_t max_rows = kGradientBandRows + 2 + 2 * radius;
+        std::vector<uchar> gray_buffer(cn == 1 ? 0 : max_rows * width);
+        std::vector<uchar> blur_buffer(radius == 0 ? 0 : (kGradientBandRows + 2) * static_cast<size_t>(width));
+        std::vector<int> sums(width);
+        std::vector<const uchar*> gray_rows(max_rows);
+        std::vector<const uchar*> blur_rows(kGradientBandRows + 2);
+        std::vector<const uchar*> taps(2 * radius + 1);
+        std::vector<int> histogram(l1_histogram ? kCannyHistogramBins : 0);
+
+        for (int band = range.start; band < range.end; ++band) {
+            const int y0 = band * kGradientBandRows;
+            const int y1 = std::min(rows, y0 + kGradientBandRows);
+            // Sobel needs (blurred) rows y0 - 1 .. y1, the blur needs radius more on each side
+            const int b0 = std::max(0, y0 - 1);
+            const int b1 = std::min(rows, y1 + 1);
+            const int g0 = std::max(0, b0 - radius);
+            const int g1 = std::min(rows, b1 + radius);
+
+            for (int y = g0; y < g1; ++y) {
+                if (cn == 1) {
+                    gray_rows[y - g0] = input_image.ptr<uchar>(y);
+                } else {
+                    uchar* row = gray_buffer.data() + static_cast<size_t>(y - g0) * width;
+                    convert_gray_row(input_image.ptr<uchar>(y), row, width, cn);
+                    gray_rows[y - g0] = row;
+                }
+            }
+
+            for (int y = b0; y < b1; ++y) {
+                if (radius == 0) {
+                    blur_rows[y - b0] = gray_rows[y - g0];
+                    continue;
+                }
+                for (int k = 0; k <= 2 * radius; ++k) {
+                    taps[k] = gray_rows[clamp_index(y + k - radius, rows) - g0];
+                }
+                uchar* row = blur_buffer.data() + static_cast<size_t>(y - b0) * width;
+                blur_row(taps.data(), kernel, radius, shift, sums.data(), row, width);
+                blur_rows[y - b0] = row;
+            }
+
+            for (int y = y0; y < y1; ++y) {
+                short* dx_row = dx.ptr<short>(y);
+                short* dy_row = dy.ptr<short>(y);
+                sobel_row(blur_rows[clamp_index(y - 1, rows) - b0],
+                          blur_rows[y - b0],
+                          blur_rows[clamp_index(y + 1, rows) - b0],
+                          dx_row, dy_row, width);
+                if (l1_histogram) {
+                    // Counted while the gradient row is still in cache
+                    for (int x = 0; x < width; ++x) {
+                        ++histogram[std::abs(static_cast<int>(dx_row[x])) + std::abs(static_cast<int>(dy_row[x]))];
+                    }
+                }
+            }
+        }
+
+        if (l1_histogram) {
+            std::lock_guard<std::mutex> lock(histogram_mutex);
+            for (int i = 0; i < kCannyHistogramBins; ++i) {
+                (*l1_histogram)[i] += histogram[i];
+            }
+        }
+    });
+}
+
+// --- Non-maximum suppression and hysteresis ---
+//
+// The same algorithm as cv::Canny: integer L1 (or squared L2) magnitudes, direction
+// quantised with tan(22.5 deg) in Q15, and 8-connected hysteresis from pixels above
+// the high threshold. The edge map is split into bands of rows. Suppression of a band
+// needs the magnitudes of one row above and below it (recomputed by the band) and is
+// independent of the other bands. Hysteresis first grows edges inside each band in
+// parallel, then repeatedly hands over the weak pixels that touch a strong pixel across
+// a band border and grows them inside their band, until no border changes. Because
+// hysteresis keeps exactly the weak pixels connected to a strong one, the result does
+// not depend on the band layout and is identical to a single band.
+
+// Edge map codes used during detection
+static const uchar kNotEdge = 0;
+static const uchar kWeakEdge = 1;
+static const uchar kStrongEdge = 2;
+
+// tan(22.5 deg) in Q15
+static const int kTan22 = 13573;
+
+struct CannyThresholds {
+    int low;
+    int high;
+};
+
+/**
+ * @brief Converts user thresholds to the integer magnitude thresholds cv::Canny uses.
+ */
+static CannyThresholds integer_thresholds(double threshold1, double threshold2, bool l2_gradient) {
+    if (threshold1 > threshold2) {
+        std::swap(threshold1, threshold2);
+    }
+    if (l2_gradient) {
+        // Magnitudes are squared, so the thresholds are too
+        threshold1 = std::min(32767.0, threshold1);
+        threshold2 = std::min(32767.0, threshold2);
+        threshold1 *= threshold1;
+        threshold2 *= threshold2;
+    }
+    return {cvFloor(threshold1), cvFloor(threshold2)};
+}
+
+/**
+ * @brief Computes one row of gradient magnitudes (|dx| + |dy|, or dx^2 + dy^2 for L2).
+ */
+static void magnitude_row(const short* dx, const short* dy, int* mag, int width, bool l2_gradient) {
+    if (l2_gradient) {
+        for (int x = 0; x < width; ++x) {
+            mag[x] = static_cast<int>(dx[x]) * dx[x] + static_cast<int>(dy[x]) * dy[x];
+        }
+    } else {
+        for (int x = 0; x < width; ++x) {
+            mag[x] = std::abs(static_cast<int>(dx[x])) + std::abs(static_cast<int>(dy[x]));
+        }
+    }
+}
+
+/**
+ * @brief Non-maximum suppression of the rows [y0, y1).
+ *
+ * Writes classify(m) to out for each pixel whose magnitude m is above low and a local
+ * maximum along the gradient direction, and classify(0) for all other pixels. Whether a
+ * pixel is a local maximum does not depend on the thresholds.
+ *
+ * @param out Output rows of type T (same size as dx).
+ * @param mag_rows Scratch for three magnitude rows of width + 2 entries each.
+ */
+template <typename T, typename Classify>
+static void suppress_band(const cv::Mat& dx, const cv::Mat& dy, cv::Mat& out, int y0, int y1,
+                          int low, bool l2_gradient, std::vector<int>& mag_rows, Classify classify) {
+    const int width = dx.cols;
+    const size_t stride = static_cast<size_t>(width) + 2;
+    mag_rows.assign(3 * stride, 0); // Padding columns (and rows outside the image) stay zero
+
+    // Row y of the magnitudes lives in slot (y + 3) % 3; the pointers skip the padding column
+    auto mag_slot = [&](int y) { return mag_rows.data() + ((y + 3) % 3) * stride + 1; };
+    auto load_row = [&](int y) {
+        int* row = mag_slot(y);
+        if (y < 0 || y >= dx.rows) {
+            std::fill(row, row + width, 0);
+        } else {
+            magnitude_row(dx.ptr<short>(y), dy.ptr<short>(y), row, width, l2_gradient);
+        }
+    };
+    load_row(y0 - 1);
+    load_row(y0);
+
+    for (int y = y0; y < y1; ++y) {
+        load_row(y + 1);
+        const int* mag_p = mag_slot(y - 1);
+        const int* mag_a = mag_slot(y);
+        const int* mag_n = mag_slot(y + 1);
+        const short* dx_row = dx.ptr<short>(y);
+        const short* dy_row = dy.ptr<short>(y);
+        T* out_row = out.ptr<T>(y);
+
+        for (int x = 0; x < width; ++x) {
+            const int m = mag_a[x];
+            int kept = 0;
+            if (m > low) {
+                const int xs = dx_row[x];
+                const int ys = dy_row[x];
+                const int ax = std::abs(xs);
+                const int ay = std::abs(ys) << 15;
+                const int tg22x = ax * kTan22;
+                bool is_max;
+                if (ay < tg22x) {
+                    is_max = m > mag_a[x - 1] && m >= mag_a[x + 1];
+                } else {
+                    const int tg67x = tg22x + (ax << 16);
+                    if (ay > tg67x) {
+                        is_max = m > mag_p[x] && m >= mag_n[x];
+                    } else {
+                        const int s = (xs ^ ys) < 0 ? -1 : 1;
+                        is_max = m > mag_p[x - s] && m > mag_n[x + s];
+                    }
+                }
+                if (is_max) {
+                    kept = m;
+                }
+            }
+            out_row[x] = classify(kept);
+        }
+    }
+}
+
+/**
+ * @brief Grows strong edges from the stacked pixels into 8-connected weak pixels of rows [y0, y1).
+ *
+ * The stacked pixels must already be marked strong. The stack is empty on return.
+ */
+static void grow_edges(cv::Mat& map, int y0, int y1, std::vector<cv::Point>& stack) {
+    const int width = map.cols;
+    while (!stack.empty()) {
+        const cv::Point p = stack.back();
+        stack.pop_back();
+        for (int y = std::max(y0, p.y - 1); y <= std::min(y1 - 1, p.y + 1); ++y) {
+            uchar* row = map.ptr<uchar>(y);
+            for (int x = std::max(0, p.x - 1); x <= std::min(width - 1, p.x + 1); ++x) {
+                if (row[x] == kWeakEdge) {
+                    row[x] = kStrongEdge;
+                    stack.push_back(cv::Point(x, y));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Collects the weak pixels of border row y that touch a strong pixel of neighbour row ny.
+ */
+static void collect_border_seeds(const cv::Mat& map, int y, int ny, std::vector<cv::Point>& seeds) {
+    const int width = map.cols;
+    const uchar* row = map.ptr<uchar>(y);
+    const uchar* neighbour = map.ptr<uchar>(ny);
+    for (int x = 0; x < width; ++x) {
+        if (row[x] != kWeakEdge) {
+            continue;
+        }
+        for (int nx = std::max(0, x - 1); nx <= std::min(width - 1, x + 1); ++nx) {
+            if (neighbour[nx] == kStrongEdge) {
+                seeds.push_back(cv::Point(x, y));
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Hysteresis over a thresholded map split into bands of band_rows rows.
+ */
+static void hysteresis_bands(cv::Mat& map, int band_rows) {
+    const int rows = map.rows;
+    const int bands = (rows + band_rows - 1) / band_rows;
+
+    // Grow inside each band
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+        std::vector<cv::Point> stack;
+        for (int band = range.start; band < range.end; ++band) {
+            const int y0 = band * band_rows;
+            const int y1 = std::min(rows, y0 + band_rows);
+            for (int y = y0; y < y1; ++y) {
+                const uchar* row = map.ptr<uchar>(y);
+                for (int x = 0; x < map.cols; ++x) {
+                    if (row[x] == kStrongEdge) {
+                        stack.push_back(cv::Point(x, y));
+                    }
+                }
+            }
+            grow_edges(map, y0, y1, stack);
+        }
+    });
+
+    // Propagate across band borders until nothing changes. Seeds are collected while the
+    // map is only read, then each band marks and grows its own seeds, so bands never
+    // write the same rows concurrently.
+    std::vector<std::vector<cv::Point>> seeds(bands);
+    for (;;) {
+        cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+            for (int band = range.start; band < range.end; ++band) {
+                const int y0 = band * band_rows;
+                const int y1 = std::min(rows, y0 + band_rows);
+                seeds[band].clear();
+                if (y0 > 0) {
+                    collect_border_seeds(map, y0, y0 - 1, seeds[band]);
+                }
+                if (y1 < rows) {
+                    collect_border_seeds(map, y1 - 1, y1, seeds[band]);
+                }
+            }
+        });
+
+        bool changed = false;
+        for (const auto& band_seeds : seeds) {
+            changed = changed || !band_seeds.empty();
+        }
+        if (!changed) {
+            break;
+        }
+
+        cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+            for (int band = range.start; band < range.end; ++band) {
+                const int y0 = band * band_rows;
+                const int y1 = std::min(rows, y0 + band_rows);
+                std::vector<cv::Point>& stack = seeds[band];
+                for (const cv::Point& p : stack) {
+                    map.ptr<uchar>(p.y)[p.x] = kStrongEdge; // A pixel may be seeded from both sides
+                }
+                grow_edges(map, y0, y1, stack);
+            }
+        });
+    }
+}
+
+/**
+ * @brief Turns the final map into an edge image (strong -> 255, everything else -> 0) in place.
+ */
+static void finish_edge_map(cv::Mat& map) {
+    cv::parallel_for_(cv::Range(0, map.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            uchar* row = map.ptr<uchar>(y);
+            for (int x = 0; x < map.cols; ++x) {
+                row[x] = row[x] == kStrongEdge ? 255 : 0;
+            }
+        }
+    });
+}
+
+void detect_edges_canny(const cv::Mat& input_image,
+                        cv::Mat& edges,
+                        CannyWorkspace& workspace,
+                        double threshold1,
+                        double threshold2,
+                        int aperture_size,
+                        bool l2_gradient,
+                        int blur_size)
 {
     if (input_image.empty()) {
         throw std::invalid_argument("Input image for Canny edge detection is empty.");
@@ -13,29 +480,534 @@ cv::Mat detect_edges_canny(const cv::Mat& input_image,
     if (threshold1 < 0 || threshold2 < 0) {
         throw std::invalid_argument("Canny thresholds must be non-negative.");
     }
+    validate_blur_size(blur_size);
     // Optional: Check aperture_size is odd and >= 3? cv::Canny might handle this.
 
+    const int cn = input_image.channels();
+    if (aperture_size == 3 && input_image.depth() == CV_8U && (cn == 1 || cn == 3 || cn == 4)) {
+        // Fused gray + blur + Sobel front end into the workspace gradients.
+        // dx/dy are complete before edges is written, so edges may alias input_image.
+        compute_canny_gradients(input_image, workspace.dx, workspace.dy, blur_size);
+        cv::Canny(workspace.dx, workspace.dy, edges, threshold1, threshold2, l2_gradient);
+        return;
+    }
+
+    // The grayscale copy lives in the workspace, so per-frame loops do not allocate
+    // a new gray image every frame
+    cv::Mat& gray_buffer = workspace.gray;
+
     cv::Mat gray_image;
     // Convert to grayscale if the input image is not already grayscale
     if (input_image.channels() > 1) {
-        cv::cvtColor(input_image, gray_image, cv::COLOR_BGR2GRAY); 
+        cv::cvtColor(input_image, gray_buffer, cv::COLOR_BGR2GRAY); 
         // Assumes BGR input if multi-channel. Adjust if other formats are expected.
+        gray_image = gray_buffer;
+    } else if (input_image.data == edges.data || blur_size > 0) {
+        // Keep a copy of the source: an in-place call overwrites it, the blur below modifies it
+        input_image.copyTo(gray_buffer);
+        gray_image = gray_buffer;
     } else {
         gray_image = input_image; // Already grayscale
     }
 
-    // It's often recommended to blur the image slightly before Canny to reduce noise
-    // For example: cv::GaussianBlur(gray_image, gray_image, cv::Size(3,3), 0);
-    // Skipping blur for now to match basic requirements, but consider adding it.
+    if (blur_size > 0) {
+        // Replicated borders, matching the fused path and cv::Canny's own Sobel
+        cv::GaussianBlur(gray_image, gray_image, cv::Size(blur_size, blur_size), 0, 0, cv::BORDER_REPLICATE);
+    }
 
-    cv::Mat edges;
-    // Apply the Canny edge detector
+    // Apply the Canny edge detector (edges is reused if it already has the right size and type)
     cv::Canny(gray_image,      // Input grayscale image
               edges,           // Output edge map
               threshold1,      // Lower threshold for hysteresis
               threshold2,      // Upper threshold for hysteresis
               aperture_size,   // Aperture size for Sobel operator
               l2_gradient);    // L2 gradient flag
+}
 
+void detect_edges_canny(const cv::Mat& input_image,
+                        cv::Mat& edges,
+                        double threshold1,
+                        double threshold2,
+                        int aperture_size,
+                        bool l2_gradient,
+                        int blur_size)
+{
+    CannyWorkspace workspace;
+    detect_edges_canny(input_image, edges, workspace, threshold1, threshold2, aperture_size, l2_gradient, blur_size);
+}
+
+cv::Mat detect_edges_canny(const cv::Mat& input_image,
+                           double threshold1,
+                           double threshold2,
+                           int aperture_size,
+                           bool l2_gradient,
+                           int blur_size) 
+{
+    cv::Mat edges;
+    detect_edges_canny(input_image, edges, threshold1, threshold2, aperture_size, l2_gradient, blur_size);
     return edges;
-} 
\ No newline at end of file
+}
+
+/**
+ * @brief Band height to use for an image: the requested one, or a few bands per thread for 0.
+ */
+static int resolve_band_rows(int band_rows, int rows) {
+    if (band_rows == 0) {
+        // A few bands per thread so uneven edge density still balances
+        band_rows = std::max(32, rows / (4 * std::max(1, cv::getNumThreads())));
+    }
+    return std::min(band_rows, rows);
+}
+
+/**
+ * @brief Band-parallel suppression and hysteresis of precomputed gradients.
+ *
+ * On return edges holds the map codes: kStrongEdge for edge pixels, kWeakEdge or
+ * kNotEdge for all others.
+ */
+static void build_edge_map(const cv::Mat& dx, const cv::Mat& dy, cv::Mat& edges,
+                           double threshold1, double threshold2, bool l2_gradient, int band_rows) {
+    const int rows = dx.rows;
+    band_rows = resolve_band_rows(band_rows, rows);
+    const int bands = (rows + band_rows - 1) / band_rows;
+    const CannyThresholds thresholds = integer_thresholds(threshold1, threshold2, l2_gradient);
+
+    // The edge image doubles as the suppression / hysteresis map
+    edges.create(dx.size(), CV_8UC1);
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+        std::vector<int> mag_rows; // Per-thread magnitude rows, reused for every band
+        for (int band = range.start; band < range.end; ++band) {
+            const int y0 = band * band_rows;
+            suppress_band<uchar>(dx, dy, edges, y0, std::min(rows, y0 + band_rows),
+                                 thresholds.low, l2_gradient, mag_rows, [&](int m) {
+                return m > thresholds.high ? kStrongEdge : (m > thresholds.low ? kWeakEdge : kNotEdge);
+            });
+        }
+    });
+    hysteresis_bands(edges, band_rows);
+}
+
+/**
+ * @brief Band-parallel suppression and hysteresis of precomputed gradients into an edge image.
+ */
+static void edges_from_gradients_tiled(const cv::Mat& dx, const cv::Mat& dy, cv::Mat& edges,
+                                       double threshold1, double threshold2, bool l2_gradient, int band_rows) {
+    build_edge_map(dx, dy, edges, threshold1, threshold2, l2_gradient, band_rows);
+    finish_edge_map(edges);
+}
+
+void detect_edges_canny_tiled(const cv::Mat& input_image,
+                              cv::Mat& edges,
+                              CannyWorkspace& workspace,
+                              double threshold1,
+                              double threshold2,
+                              bool l2_gradient,
+                              int blur_size,
+                              int band_rows)
+{
+    if (input_image.empty()) {
+        throw std::invalid_argument("Input image for Canny edge detection is empty.");
+    }
+    if (threshold1 < 0 || threshold2 < 0) {
+        throw std::invalid_argument("Canny thresholds must be non-negative.");
+    }
+    if (band_rows < 0) {
+        throw std::invalid_argument("Canny band height must be non-negative, received: " + std::to_string(band_rows));
+    }
+
+    // The gradients are complete before edges is written, so edges may alias input_image.
+    compute_canny_gradients(input_image, workspace.dx, workspace.dy, blur_size);
+    edges_from_gradients_tiled(workspace.dx, workspace.dy, edges, threshold1, threshold2, l2_gradient, band_rows);
+}
+
+void detect_edges_canny_tiled(const cv::Mat& input_image,
+                              cv::Mat& edges,
+                              double threshold1,
+                              double threshold2,
+                              bool l2_gradient,
+                              int blur_size,
+                              int band_rows)
+{
+    CannyWorkspace workspace;
+    detect_edges_canny_tiled(input_image, edges, workspace, threshold1, threshold2, l2_gradient, blur_size, band_rows);
+}
+
+CannyAutoThresholds canny_auto_thresholds(const std::vector<int>& l1_histogram, CannyThresholdMethod method)
+{
+    if (l1_histogram.empty()) {
+        throw std::invalid_argument("Gradient histogram for automatic Canny thresholds is empty.");
+    }
+    const int bins = static_cast<int>(l1_histogram.size());
+
+    if (method == CannyThresholdMethod::Median) {
+        // Median of the non-zero magnitudes; flat regions would otherwise pull it to zero
+        long long total = 0;
+        for (int i = 1; i < bins; ++i) {
+            total += l1_histogram[i];
+        }
+        if (total == 0) {
+            return {0.0, 0.0}; // No gradients at all: no edges whatever the thresholds
+        }
+        long long seen = 0;
+        int median = 1;
+        for (; median < bins; ++median) {
+            seen += l1_histogram[median];
+            if (2 * seen >= total) {
+                break;
+            }
+        }
+        return {(1.0 - kCannyMedianSigma) * median, (1.0 + kCannyMedianSigma) * median};
+    }
+
+    // Otsu: the split of the magnitude histogram with the largest between-class variance
+    double total = 0.0;
+    double sum = 0.0;
+    for (int i = 0; i < bins; ++i) {
+        total += l1_histogram[i];
+        sum += static_cast<double>(i) * l1_histogram[i];
+    }
+    double weight_low = 0.0;
+    double sum_low = 0.0;
+    double best_variance = -1.0;
+    int best = 0;
+    for (int t = 0; t < bins; ++t) {
+        weight_low += l1_histogram[t];
+        sum_low += static_cast<double>(t) * l1_histogram[t];
+        const double weight_high = total - weight_low;
+        if (weight_low == 0.0 || weight_high == 0.0) {
+            continue;
+        }
+        const double mean_diff = sum_low / weight_low - (sum - sum_low) / weight_high;
+        const double variance = weight_low * weight_high * mean_diff * mean_diff;
+        if (variance > best_variance) {
+            best_variance = variance;
+            best = t;
+        }
+    }
+    return {kCannyOtsuLowRatio * best, static_cast<double>(best)};
+}
+
+CannyAutoThresholds detect_edges_canny_auto(const cv::Mat& input_image,
+                                            cv::Mat& edges,
+                                            CannyWorkspace& workspace,
+                                            CannyThresholdMethod method,
+                                            bool l2_gradient,
+                                            int blur_size,
+                                            bool tiled)
+{
+    if (input_image.empty()) {
+        throw std::invalid_argument("Input image for Canny edge detection is empty.");
+    }
+
+    // The histogram is gathered by the gradient pass itself, so auto mode adds no pass over the image
+    compute_canny_gradients(input_image, workspace.dx, workspace.dy, blur_size, &workspace.histogram);
+    const CannyAutoThresholds thresholds = canny_auto_thresholds(workspace.histogram, method);
+
+    if (tiled) {
+        edges_from_gradients_tiled(workspace.dx, workspace.dy, edges, thresholds.low, thresholds.high, l2_gradient, 0);
+    } else {
+        cv::Canny(workspace.dx, workspace.dy, edges, thresholds.low, thresholds.high, l2_gradient);
+    }
+    return thresholds;
+}
+
+CannyAutoThresholds detect_edges_canny_auto(const cv::Mat& input_image,
+                                            cv::Mat& edges,
+                                            CannyThresholdMethod method,
+                                            bool l2_gradient,
+                                            int blur_size,
+                                            bool tiled)
+{
+    CannyWorkspace workspace;
+    return detect_edges_canny_auto(input_image, edges, workspace, method, l2_gradient, blur_size, tiled);
+}
+
+void detect_edges_canny_sweep(const cv::Mat& input_image,
+                              const std::vector<std::pair<double, double>>& threshold_pairs,
+                              const std::function<void(size_t, const cv::Mat&)>& on_edges,
+                              bool l2_gradient,
+                              int blur_size)
+{
+    if (input_image.empty()) {
+        throw std::invalid_argument("Input image for Canny edge detection is empty.");
+    }
+    for (const auto& pair : threshold_pairs) {
+        if (pair.first < 0 || pair.second < 0) {
+            throw std::invalid_argument("Canny thresholds must be non-negative.");
+        }
+    }
+
+    cv::Mat dx;
+    cv::Mat dy;
+    compute_canny_gradients(input_image, dx, dy, blur_size);
+
+    // Suppress once: the magnitude of every local maximum, 0 elsewhere
+    const int rows = input_image.rows;
+    const int band_rows = resolve_band_rows(0, rows);
+    const int bands = (rows + band_rows - 1) / band_rows;
+    cv::Mat maxima(input_image.size(), CV_32SC1);
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+        std::vector<int> mag_rows;
+        for (int band = range.start; band < range.end; ++band) {
+            const int y0 = band * band_rows;
+            suppress_band<int>(dx, dy, maxima, y0, std::min(rows, y0 + band_rows),
+                               0, l2_gradient, mag_rows, [](int m) { return m; });
+        }
+    });
+    dx.release();
+    dy.release();
+
+    // Per pair, only thresholding and hysteresis remain; the edge map is reused
+    cv::Mat edges(input_image.size(), CV_8UC1);
+    for (size_t i = 0; i < threshold_pairs.size(); ++i) {
+        const CannyThresholds thresholds = integer_thresholds(threshold_pairs[i].first,
+                                                              threshold_pairs[i].second, l2_gradient);
+        cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+            for (int y = range.start; y < range.end; ++y) {
+                const int* m = maxima.ptr<int>(y);
+                uchar* row = edges.ptr<uchar>(y);
+                for (int x = 0; x < edges.cols; ++x) {
+                    row[x] = m[x] > thresholds.high ? kStrongEdge : (m[x] > thresholds.low ? kWeakEdge : kNotEdge);
+                }
+            }
+        });
+        hysteresis_bands(edges, band_rows);
+        finish_edge_map(edges);
+        on_edges(i, edges);
+    }
+}
+
+std::string canny_sweep_output_path(const std::string& pattern, double threshold1, double threshold2)
+{
+    auto format = [](double value) {
+        std::ostringstream out;
+        out << value; // 100 -> "100", 12.5 -> "12.5"
+        return out.str();
+    };
+    std::string path = pattern;
+    const std::pair<std::string, std::string> placeholders[] = {{"{t1}", format(threshold1)},
+                                                                {"{t2}", format(threshold2)}};
+    for (const auto& placeholder : placeholders) {
+        for (size_t pos = path.find(placeholder.first); pos != std::string::npos;
+             pos = path.find(placeholder.first, pos + placeholder.second.size())) {
+            path.replace(pos, placeholder.first.size(), placeholder.second);
+        }
+    }
+    return path;
+}
+
+// --- Sparse edge output ---
+
+// Map code for edge pixels already written to a contour
+static const uchar kTracedEdge = 3;
+
+// Bytes buffered before they are written to the edge list file
+static const size_t kEdgeListFlushBytes = 1 << 20;
+
+/**
+ * @brief Buffered binary writer for edge list files.
+ */
+class EdgeListFile {
+public:
+    EdgeListFile(const std::string& path, const cv::Size& size, uint32_t flags)
+        : path_(path)
+    {
+        out_.open(path, std::ios::binary);
+        if (!out_.is_open()) {
+            throw std::runtime_error("Failed to create edge list file: " + path);
+        }
+        buffer_.insert(buffer_.end(), kEdgeListMagic, kEdgeListMagic + 4);
+        put(kEdgeListVersion);
+        put(static_cast<uint32_t>(size.width));
+        put(static_cast<uint32_t>(size.height));
+        put(flags);
+        count_offset_ = buffer_.size();
+        put(static_cast<uint64_t>(0)); // Record count, patched by close()
+    }
+
+    template <typename T>
+    void put(const T& value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        buffer_.insert(buffer_.end(), bytes, bytes + sizeof(T));
+        if (buffer_.size() >= kEdgeListFlushBytes) {
+            flush();
+        }
+    }
+
+    void close(uint64_t count) {
+        flush();
+        out_.seekp(static_cast<std::streamoff>(count_offset_));
+        out_.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        out_.close();
+        if (!out_) {
+            throw std::runtime_error("Failed to write edge list file: " + path_);
+        }
+    }
+
+private:
+    void flush() {
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        if (!out_) {
+            throw std::runtime_error("Failed to write edge list file: " + path_);
+        }
+        buffer_.clear();
+    }
+
+    std::ofstream out_;
+    std::string path_;
+    std::vector<char> buffer_;
+    size_t count_offset_ = 0;
+};
+
+/**
+ * @brief Refines an edge pixel along its gradient with a parabola through the magnitudes.
+ *
+ * Uses the same direction bins as non-maximum suppression, so the neighbours are the
+ * ones the pixel was compared against.
+ */
+static cv::Point2f subpixel_edge_position(const cv::Mat& dx, const cv::Mat& dy, int x, int y, bool l2_gradient) {
+    auto magnitude = [&](int px, int py) -> float {
+        if (px < 0 || py < 0 || px >= dx.cols || py >= dx.rows) {
+            return 0.0f;
+        }
+        const float gx = dx.ptr<short>(py)[px];
+        const float gy = dy.ptr<short>(py)[px];
+        return l2_gradient ? std::sqrt(gx * gx + gy * gy) : std::abs(gx) + std::abs(gy);
+    };
+
+    const int xs = dx.ptr<short>(y)[x];
+    const int ys = dy.ptr<short>(y)[x];
+    const int ax = std::abs(xs);
+    const int ay = std::abs(ys) << 15;
+    const int tg22x = ax * kTan22;
+    int step_x = 1;
+    int step_y = 0;
+    if (ay >= tg22x) {
+        step_y = 1;
+        step_x = ay > tg22x + (ax << 16) ? 0 : ((xs ^ ys) < 0 ? -1 : 1);
+    }
+
+    const float before = magnitude(x - step_x, y - step_y);
+    const float centre = magnitude(x, y);
+    const float after = magnitude(x + step_x, y + step_y);
+    const float curvature = before - 2.0f * centre + after;
+    float offset = 0.0f;
+    if (curvature < 0.0f) {
+        offset = std::max(-0.5f, std::min(0.5f, 0.5f * (before - after) / curvature));
+    }
+    return cv::Point2f(x + offset * step_x, y + offset * step_y);
+}
+
+/**
+ * @brief Appends one point record (int32 or float32 coordinates).
+ */
+static void put_edge_point(EdgeListFile& file, const cv::Mat& dx, const cv::Mat& dy,
+                           cv::Point p, bool subpixel, bool l2_gradient) {
+    if (subpixel) {
+        const cv::Point2f q = subpixel_edge_position(dx, dy, p.x, p.y, l2_gradient);
+        file.put(q.x);
+        file.put(q.y);
+    } else {
+        file.put(static_cast<int32_t>(p.x));
+        file.put(static_cast<int32_t>(p.y));
+    }
+}
+
+/**
+ * @brief Follows untraced edge pixels from p, marking them traced, and appends them to chain.
+ */
+static void trace_chain(cv::Mat& map, cv::Point p, std::vector<cv::Point>& chain) {
+    // 4-neighbours first, so a chain follows a straight run before cutting a corner
+    static const int kStepX[] = {1, 0, -1, 0, 1, -1, -1, 1};
+    static const int kStepY[] = {0, 1, 0, -1, 1, 1, -1, -1};
+    for (;;) {
+        bool moved = false;
+        for (int k = 0; k < 8 && !moved; ++k) {
+            const int nx = p.x + kStepX[k];
+            const int ny = p.y + kStepY[k];
+            if (nx < 0 || ny < 0 || nx >= map.cols || ny >= map.rows) {
+                continue;
+            }
+            uchar& code = map.ptr<uchar>(ny)[nx];
+            if (code == kStrongEdge) {
+                code = kTracedEdge;
+                p = cv::Point(nx, ny);
+                chain.push_back(p);
+                moved = true;
+            }
+        }
+        if (!moved) {
+            return;
+        }
+    }
+}
+
+uint64_t write_canny_edge_list(const cv::Mat& input_image,
+                               const std::string& output_path,
+                               double threshold1,
+                               double threshold2,
+                               EdgeListFormat format,
+                               bool subpixel,
+                               bool l2_gradient,
+                               int blur_size)
+{
+    if (input_image.empty()) {
+        throw std::invalid_argument("Input image for Canny edge detection is empty.");
+    }
+    if (threshold1 < 0 || threshold2 < 0) {
+        throw std::invalid_argument("Canny thresholds must be non-negative.");
+    }
+
+    cv::Mat dx_buffer;
+    cv::Mat dy_buffer;
+    cv::Mat map;
+    compute_canny_gradients(input_image, dx_buffer, dy_buffer, blur_size);
+    build_edge_map(dx_buffer, dy_buffer, map, threshold1, threshold2, l2_gradient, 0);
+
+    const uint32_t flags = (subpixel ? kEdgeListSubpixel : 0u)
+                         | (format == EdgeListFormat::Contours ? kEdgeListContours : 0u);
+    EdgeListFile file(output_path, input_image.size(), flags);
+    uint64_t count = 0;
+
+    if (format == EdgeListFormat::Points) {
+        for (int y = 0; y < map.rows; ++y) {
+            const uchar* row = map.ptr<uchar>(y);
+            for (int x = 0; x < map.cols; ++x) {
+                if (row[x] == kStrongEdge) {
+                    put_edge_point(file, dx_buffer, dy_buffer, cv::Point(x, y), subpixel, l2_gradient);
+                    ++count;
+                }
+            }
+        }
+    } else {
+        // Chains start at the first untraced pixel in row-major order and are followed in
+        // both directions; a branching edge is split into several chains.
+        std::vector<cv::Point> forward;
+        std::vector<cv::Point> backward;
+        for (int y = 0; y < map.rows; ++y) {
+            uchar* row = map.ptr<uchar>(y);
+            for (int x = 0; x < map.cols; ++x) {
+                if (row[x] != kStrongEdge) {
+                    continue;
+                }
+                row[x] = kTracedEdge;
+                forward.assign(1, cv::Point(x, y));
+                backward.clear();
+                trace_chain(map, forward[0], forward);
+                trace_chain(map, forward[0], backward);
+
+                file.put(static_cast<uint32_t>(backward.size() + forward.size()));
+                for (auto it = backward.rbegin(); it != backward.rend(); ++it) {
+                    put_edge_point(file, dx_buffer, dy_buffer, *it, subpixel, l2_gradient);
+                }
+                for (const cv::Point& p : forward) {
+                    put_edge_point(file, dx_buffer, dy_buffer, p, subpixel, l2_gradient);
+                }
+                ++count;
+            }
+        }
+    }
+
+    file.close(count);
+    return count;
+}
@@ -3,10 +3,42 @@
 
 #include <opencv2/core.hpp> // For cv::Mat
 #include <opencv2/imgproc.hpp> // For cv::Canny
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Bins of the L1 gradient-magnitude histogram (3x3 Sobel on 8-bit data: |dx| + |dy| <= 2040).
+ */
+constexpr int kCannyHistogramBins = 2041;
+
+/**
+ * @brief Caller-owned scratch images for repeated Canny calls.
+ *
+ * Holds the Sobel derivatives, the grayscale copy and the magnitude histogram. They
+ * are reused while the frame size stays the same, so a per-frame loop that passes the
+ * same workspace and edge map does not reallocate them. Canny is not allocation-free
+ * in the steady state: the fused front end allocates small per-band row buffers, and
+ * cv::Canny (which runs the suppression and hysteresis) allocates its own full-size
+ * map on every call. The overloads without a workspace use a temporary one per call.
+ * A workspace must not be used by two calls at the same time.
+ */
+struct CannyWorkspace {
+    cv::Mat dx;                 // x derivative (CV_16SC1)
+    cv::Mat dy;                 // y derivative (CV_16SC1)
+    cv::Mat gray;               // Grayscale (and blurred) copy of the input on the cv::Canny path
+    std::vector<int> histogram; // L1 magnitude histogram of automatic thresholds
+};
 
 /**
  * @brief Detects edges in an input image using the Canny algorithm.
  *
+ * For 8-bit input with 1, 3 (BGR) or 4 (BGRA) channels and aperture size 3, the
+ * gradients come from the fused compute_canny_gradients() front end instead of a
+ * separate cvtColor / GaussianBlur / Sobel chain.
+ *
  * @param input_image The source image (cv::Mat). It's recommended to use a grayscale image,
  *                    although Canny can process multi-channel images (often treating them channel-wise).
  *                    This implementation will convert to grayscale first for standard behavior.
@@ -16,13 +48,262 @@
  * @param l2_gradient A flag indicating whether to use a more accurate L2 norm
  *                    for calculating image gradient magnitude (true) or the default L1 norm (false).
  *                    Default is false for performance.
+ * @param blur_size Gaussian pre-blur size to suppress noise: 0 (none, default), 3 or 5.
  * @return cv::Mat The output edge map (single-channel 8-bit image).
- * @throws std::invalid_argument if the input image is empty or thresholds are negative.
+ * @throws std::invalid_argument if the input image is empty, thresholds are negative
+ *         or blur_size is not 0, 3 or 5.
  */
 cv::Mat detect_edges_canny(const cv::Mat& input_image,
                            double threshold1,
                            double threshold2,
                            int aperture_size = 3,
-                           bool l2_gradient = false);
+                           bool l2_gradient = false,
+                           int blur_size = 0);
+
+/**
+ * @brief Detects Canny edges into a caller-owned edge map.
+ *
+ * Same as above, but edges is only (re)allocated when its size or type differs from
+ * the result. edges may be input_image itself for single-channel input. The gradients
+ * or grayscale copy are still allocated per call (see the workspace overload).
+ *
+ * @throws std::invalid_argument under the same conditions as the returning overload.
+ */
+void detect_edges_canny(const cv::Mat& input_image,
+                        cv::Mat& edges,
+                        double threshold1,
+                        double threshold2,
+                        int aperture_size = 3,
+                        bool l2_gradient = false,
+                        int blur_size = 0);
+
+/**
+ * @brief Detects Canny edges with caller-owned edge map and scratch images.
+ *
+ * Same as the out-parameter overload, with the gradients and grayscale copy kept in
+ * workspace, so per-frame loops that reuse both do not reallocate them (cv::Canny's
+ * internal map is still allocated per call, see CannyWorkspace).
+ *
+ * @throws std::invalid_argument under the same conditions as the returning overload.
+ */
+void detect_edges_canny(const cv::Mat& input_image,
+                        cv::Mat& edges,
+                        CannyWorkspace& workspace,
+                        double threshold1,
+                        double threshold2,
+                        int aperture_size = 3,
+                        bool l2_gradient = false,
+                        int blur_size = 0);
+
+/**
+ * @brief Computes the 3x3 Sobel gradients used by Canny in one fused pass.
+ *
+ * Converts BGR/BGRA input to gray, optionally applies a 3x3 or 5x5 Gaussian blur and
+ * computes the Sobel derivatives band by band, so neither the gray nor the blurred
+ * image is ever materialised at full size. Borders are replicated, as in cv::Canny.
+ * The results are within rounding of cvtColor + GaussianBlur (sigma derived from the
+ * size) + Sobel and can be passed straight to cv::Canny(dx, dy, ...).
+ *
+ * @param input_image 8-bit image with 1, 3 (BGR) or 4 (BGRA) channels.
+ * @param dx Output x derivative (CV_16SC1); reused if it already has the right size and type.
+ * @param dy Output y derivative (CV_16SC1); reused likewise.
+ * @param blur_size Gaussian pre-blur size: 0 (none), 3 or 5.
+ * @param l1_histogram If not null, receives the histogram of |dx| + |dy| over all pixels
+ *                     (kCannyHistogramBins entries), counted in the same pass.
+ * @throws std::invalid_argument if the input is empty or has an unsupported type,
+ *         or blur_size is not 0, 3 or 5.
+ */
+void compute_canny_gradients(const cv::Mat& input_image,
+                             cv::Mat& dx,
+                             cv::Mat& dy,
+                             int blur_size = 0,
+                             std::vector<int>* l1_histogram = nullptr);
+
+/**
+ * @brief Canny edge detection with band-parallel suppression and hysteresis.
+ *
+ * cv::Canny runs much of its hysteresis on one thread. This variant splits the image
+ * into bands of rows: gradients, non-maximum suppression and hysteresis run per band
+ * in parallel, and edges that cross band borders are then handed over between bands
+ * until nothing changes. The output does not depend on the band layout, so it is
+ * bit-identical to running with a single band (band_rows >= image height), and it
+ * follows the same integer magnitude and direction rules as cv::Canny with aperture 3.
+ *
+ * @param input_image 8-bit image with 1, 3 (BGR) or 4 (BGRA) channels.
+ * @param edges Output edge map (CV_8UC1, 0 or 255); may be input_image for single-channel input.
+ * @param threshold1 The first threshold for the hysteresis procedure.
+ * @param threshold2 The second threshold for the hysteresis procedure.
+ * @param l2_gradient Use the L2 gradient magnitude instead of L1 (default: false).
+ * @param blur_size Gaussian pre-blur size: 0 (none, default), 3 or 5.
+ * @param band_rows Rows per band, or 0 to choose from the image height and thread count.
+ * @throws std::invalid_argument if the input is empty or has an unsupported type, thresholds
+ *         are negative, blur_size is not 0, 3 or 5, or band_rows is negative.
+ */
+void detect_edges_canny_tiled(const cv::Mat& input_image,
+                              cv::Mat& edges,
+                              double threshold1,
+                              double threshold2,
+                              bool l2_gradient = false,
+                              int blur_size = 0,
+                              int band_rows = 0);
+
+/**
+ * @brief Band-parallel Canny with the gradients kept in a caller-owned workspace.
+ *
+ * @throws std::invalid_argument under the same conditions as the overload above.
+ */
+void detect_edges_canny_tiled(const cv::Mat& input_image,
+                              cv::Mat& edges,
+                              CannyWorkspace& workspace,
+                              double threshold1,
+                              double threshold2,
+                              bool l2_gradient = false,
+                              int blur_size = 0,
+                              int band_rows = 0);
+
+/**
+ * @brief How automatic Canny thresholds are chosen from the gradient-magnitude histogram.
+ */
+enum class CannyThresholdMethod {
+    Median, ///< low/high = 0.67 / 1.33 times the median non-zero magnitude
+    Otsu    ///< high = Otsu split of the magnitude histogram, low = half of it
+};
+
+/**
+ * @brief Hysteresis thresholds chosen for an image, in L1 gradient-magnitude units.
+ */
+struct CannyAutoThresholds {
+    double low = 0.0;
+    double high = 0.0;
+};
+
+/**
+ * @brief Chooses Canny thresholds from an L1 gradient-magnitude histogram.
+ *
+ * @param l1_histogram Histogram as produced by compute_canny_gradients().
+ * @param method Median- or Otsu-based selection.
+ * @return CannyAutoThresholds The chosen thresholds (both 0 if the image has no gradients).
+ * @throws std::invalid_argument if the histogram is empty.
+ */
+CannyAutoThresholds canny_auto_thresholds(const std::vector<int>& l1_histogram, CannyThresholdMethod method);
+
+/**
+ * @brief Canny edge detection with thresholds chosen from the image itself.
+ *
+ * The gradient-magnitude histogram is gathered by the fused gradient pass, so choosing
+ * the thresholds costs no extra pass over the image. The thresholds are always derived
+ * from L1 magnitudes; with l2_gradient they are applied to the L2 magnitude unchanged.
+ *
+ * @param input_image 8-bit image with 1, 3 (BGR) or 4 (BGRA) channels.
+ * @param edges Output edge map (CV_8UC1); may be input_image for single-channel input.
+ * @param method Median- or Otsu-based selection.
+ * @param l2_gradient Use the L2 gradient magnitude instead of L1 (default: false).
+ * @param blur_size Gaussian pre-blur size: 0 (none, default), 3 or 5.
+ * @param tiled Use the band-parallel suppression and hysteresis of detect_edges_canny_tiled().
+ * @return CannyAutoThresholds The thresholds that were used.
+ * @throws std::invalid_argument if the input is empty or has an unsupported type,
+ *         or blur_size is not 0, 3 or 5.
+ */
+CannyAutoThresholds detect_edges_canny_auto(const cv::Mat& input_image,
+                                            cv::Mat& edges,
+                                            CannyThresholdMethod method,
+                                            bool l2_gradient = false,
+                                            int blur_size = 0,
+                                            bool tiled = false);
+
+/**
+ * @brief Automatic-threshold Canny with the gradients and histogram kept in a caller-owned workspace.
+ *
+ * @return CannyAutoThresholds The thresholds that were used.
+ * @throws std::invalid_argument under the same conditions as the overload above.
+ */
+CannyAutoThresholds detect_edges_canny_auto(const cv::Mat& input_image,
+                                            cv::Mat& edges,
+                                            CannyWorkspace& workspace,
+                                            CannyThresholdMethod method,
+                                            bool l2_gradient = false,
+                                            int blur_size = 0,
+                                            bool tiled = false);
+
+/**
+ * @brief Runs Canny for several threshold pairs, sharing everything but hysteresis.
+ *
+ * Gradients and non-maximum suppression do not depend on the thresholds, so they are
+ * computed once (the magnitude of every local maximum is kept); each pair then costs
+ * only a thresholding pass and the band-parallel hysteresis of detect_edges_canny_tiled().
+ * Each pair gives the same edges as a separate detect_edges_canny_tiled() call.
+ *
+ * @param input_image 8-bit image with 1, 3 (BGR) or 4 (BGRA) channels.
+ * @param threshold_pairs (threshold1, threshold2) pairs, processed in order.
+ * @param on_edges Called with the pair index and its edge map (CV_8UC1) for every pair.
+ *                 The map is overwritten by the next pair; copy it to keep it.
+ * @param l2_gradient Use the L2 gradient magnitude instead of L1 (default: false).
+ * @param blur_size Gaussian pre-blur size: 0 (none, default), 3 or 5.
+ * @throws std::invalid_argument if the input is empty or has an unsupported type, a
+ *         threshold is negative, or blur_size is not 0, 3 or 5.
+ */
+void detect_edges_canny_sweep(const cv::Mat& input_image,
+                              const std::vector<std::pair<double, double>>& threshold_pairs,
+                              const std::function<void(size_t, const cv::Mat&)>& on_edges,
+                              bool l2_gradient = false,
+                              int blur_size = 0);
+
+/**
+ * @brief Expands the {t1} and {t2} placeholders of a sweep output pattern.
+ *
+ * @param pattern Output path pattern, e.g. "edges_{t1}_{t2}.png".
+ * @param threshold1 Value substituted for {t1} (formatted without trailing zeros).
+ * @param threshold2 Value substituted for {t2}.
+ * @return std::string The output path.
+ */
+std::string canny_sweep_output_path(const std::string& pattern, double threshold1, double threshold2);
+
+/**
+ * @brief Layout of the records in an edge list file.
+ */
+enum class EdgeListFormat {
+    Points,  ///< One record per edge pixel, in row-major order
+    Contours ///< Chains of 8-connected edge pixels: uint32 length, then that many points
+};
+
+// Edge list file layout (native byte order):
+//   char[4] magic "EDGL", uint32 version, uint32 width, uint32 height, uint32 flags,
+//   uint64 count (points for Points, chains for Contours), then the records.
+// A point is two int32 (x, y), or two float32 when kEdgeListSubpixel is set.
+constexpr char kEdgeListMagic[4] = {'E', 'D', 'G', 'L'};
+constexpr uint32_t kEdgeListVersion = 1;
+constexpr uint32_t kEdgeListSubpixel = 1u << 0; ///< Flag: float32 subpixel coordinates
+constexpr uint32_t kEdgeListContours = 1u << 1; ///< Flag: records are chains (EdgeListFormat::Contours)
+
+/**
+ * @brief Runs Canny and writes the edge pixels as a compact binary list instead of an image.
+ *
+ * Uses the band-parallel suppression and hysteresis of detect_edges_canny_tiled() and
+ * writes the edges straight from the hysteresis map through a small buffer, so neither
+ * a dense output image nor an encoded PNG is produced. With subpixel, each edge pixel is
+ * moved along its gradient to the peak of a parabola fitted through the magnitudes it
+ * was compared against during non-maximum suppression (at most half a pixel).
+ *
+ * @param input_image 8-bit image with 1, 3 (BGR) or 4 (BGRA) channels.
+ * @param output_path Path of the edge list file to write.
+ * @param threshold1 The first threshold for the hysteresis procedure.
+ * @param threshold2 The second threshold for the hysteresis procedure.
+ * @param format Individual points or chained contours.
+ * @param subpixel Write float32 subpixel positions instead of integer pixel positions.
+ * @param l2_gradient Use the L2 gradient magnitude instead of L1 (default: false).
+ * @param blur_size Gaussian pre-blur size: 0 (none, default), 3 or 5.
+ * @return uint64_t Number of points (Points) or chains (Contours) written.
+ * @throws std::invalid_argument if the input is empty or has an unsupported type, thresholds
+ *         are negative, or blur_size is not 0, 3 or 5.
+ * @throws std::runtime_error if the file cannot be written.
+ */
+uint64_t write_canny_edge_list(const cv::Mat& input_image,
+                               const std::string& output_path,
+                               double threshold1,
+                               double threshold2,
+                               EdgeListFormat format,
+                               bool subpixel = false,
+                               bool l2_gradient = false,
+                               int blur_size = 0);
 
 #endif // AI_SLOP_CANNY_HPP 
\ No newline at end of file
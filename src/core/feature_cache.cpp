@@ -0,0 +1,177 @@
+#include "feature_cache.hpp"
+#include <algorithm> // For std::copy
+#include <cstdio>    // For std::rename, std::remove, std::snprintf
+#include <fstream>
+#include <stdexcept> // For std::invalid_argument, std::runtime_error
+#include <vector>
+
+static const char kEntryMagic[4] = {'F', 'E', 'A', 'T'};
+static const uint32_t kEntryVersion = 1;
+
+/**
+ * @brief Fixed-size entry header; every field is 4 bytes, so the layout has no padding.
+ */
+struct EntryHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t image_width;
+    int32_t image_height;
+    uint32_t keypoint_count;
+    int32_t descriptor_rows;
+    int32_t descriptor_cols;
+    int32_t descriptor_type;
+};
+
+/**
+ * @brief One stored keypoint.
+ */
+struct EntryKeypoint {
+    float x;
+    float y;
+    float size;
+    float angle;
+    float response;
+    int32_t octave;
+    int32_t class_id;
+};
+
+uint64_t fnv1a_hash(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+FeatureCache::FeatureCache(const std::string& directory, const std::string& settings)
+    : directory_(directory), settings_(settings)
+{
+    if (directory.empty()) {
+        throw std::invalid_argument("Feature cache directory must not be empty.");
+    }
+}
+
+std::string FeatureCache::entry_path(uint64_t content_hash) const
+{
+    const uint64_t key = fnv1a_hash(settings_.data(), settings_.size(), content_hash);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.feat", static_cast<unsigned long long>(key));
+    return directory_ + "/" + name;
+}
+
+/**
+ * @brief Reads one entry; returns false if it is missing or does not have the entry layout.
+ *
+ * The header is validated against the file size before anything is allocated from
+ * it, so a corrupt or foreign file cannot request a huge allocation.
+ */
+static bool read_entry(const std::string& path, cv::detail::ImageFeatures& features)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) {
+        return false;
+    }
+    const std::streamoff file_size = in.tellg();
+    in.seekg(0, std::ios::beg);
+
+    EntryHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || std::string(header.magic, 4) != std::string(kEntryMagic, 4) || header.version != kEntryVersion) {
+        return false;
+    }
+    // Descriptors are one row per keypoint, binary (ORB) or float (SIFT/SURF-style) values
+    if (header.descriptor_type != CV_8UC1 && header.descriptor_type != CV_32FC1) {
+        return false;
+    }
+    if (header.descriptor_rows < 0 || header.descriptor_cols < 0
+        || static_cast<uint64_t>(header.descriptor_rows) != header.keypoint_count) {
+        return false;
+    }
+    const uint64_t keypoint_bytes = static_cast<uint64_t>(header.keypoint_count) * sizeof(EntryKeypoint);
+    const uint64_t element_bytes = header.descriptor_type == CV_32FC1 ? sizeof(float) : 1;
+    const uint64_t descriptor_bytes = static_cast<uint64_t>(header.descriptor_rows)
+        * static_cast<uint64_t>(header.descriptor_cols) * element_bytes;
+    if (file_size < 0 || static_cast<uint64_t>(file_size) != sizeof(header) + keypoint_bytes + descriptor_bytes) {
+        return false; // Truncated or trailing data
+    }
+
+    std::vector<EntryKeypoint> stored(header.keypoint_count);
+    in.read(reinterpret_cast<char*>(stored.data()), static_cast<std::streamsize>(keypoint_bytes));
+    cv::Mat descriptors(header.descriptor_rows, header.descriptor_cols, header.descriptor_type);
+    const size_t row_bytes = static_cast<size_t>(header.descriptor_cols) * descriptors.elemSize();
+    for (int r = 0; r < header.descriptor_rows && in; ++r) {
+        in.read(reinterpret_cast<char*>(descriptors.ptr(r)), static_cast<std::streamsize>(row_bytes));
+    }
+    if (!in) {
+        return false;
+    }
+
+    features.img_size = cv::Size(header.image_width, header.image_height);
+    features.keypoints.clear();
+    features.keypoints.reserve(stored.size());
+    for (const EntryKeypoint& k : stored) {
+        features.keypoints.emplace_back(cv::Point2f(k.x, k.y), k.size, k.angle, k.response, k.octave, k.class_id);
+    }
+    descriptors.copyTo(features.descriptors);
+    return true;
+}
+
+bool FeatureCache::load(uint64_t content_hash, cv::detail::ImageFeatures& features) const
+{
+    // Loads run inside parallel_for_, so nothing may escape: a bad entry is only a miss
+    try {
+        return read_entry(entry_path(content_hash), features);
+    } catch (const std::exception&) { // Includes cv::Exception and std::bad_alloc
+        return false;
+    }
+}
+
+void FeatureCache::store(uint64_t content_hash, const cv::detail::ImageFeatures& features) const
+{
+    const cv::Mat descriptors = features.descriptors.getMat(cv::ACCESS_READ);
+
+    EntryHeader header;
+    std::copy(kEntryMagic, kEntryMagic + 4, header.magic);
+    header.version = kEntryVersion;
+    header.image_width = features.img_size.width;
+    header.image_height = features.img_size.height;
+    header.keypoint_count = static_cast<uint32_t>(features.keypoints.size());
+    header.descriptor_rows = descriptors.rows;
+    header.descriptor_cols = descriptors.cols;
+    header.descriptor_type = descriptors.type();
+
+    std::vector<EntryKeypoint> stored;
+    stored.reserve(features.keypoints.size());
+    for (const cv::KeyPoint& k : features.keypoints) {
+        stored.push_back({k.pt.x, k.pt.y, k.size, k.angle, k.response, k.octave, k.class_id});
+    }
+
+    const std::string path = entry_path(content_hash);
+    const std::string temp_path = path + ".tmp" + std::to_string(cv::getTickCount());
+    {
+        std::ofstream out(temp_path, std::ios::binary);
+        if (!out.is_open()) {
+            throw std::runtime_error("Failed to create feature cache entry: " + temp_path);
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(stored.data()), static_cast<std::streamsize>(stored.size() * sizeof(EntryKeypoint)));
+        const size_t row_bytes = static_cast<size_t>(descriptors.cols) * descriptors.elemSize();
+        for (int r = 0; r < descriptors.rows; ++r) {
+            out.write(reinterpret_cast<const char*>(descriptors.ptr(r)), static_cast<std::streamsize>(row_bytes));
+        }
+        if (!out) {
+            out.close();
+            std::remove(temp_path.c_str());
+            throw std::runtime_error("Failed to write feature cache entry: " + temp_path);
+        }
+    }
+
+    std::remove(path.c_str()); // rename() does not replace existing files everywhere
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Failed to store feature cache entry: " + path);
+    }
+}
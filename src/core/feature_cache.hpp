@@ -0,0 +1,74 @@
+#ifndef AI_SLOP_FEATURE_CACHE_HPP
+#define AI_SLOP_FEATURE_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <opencv2/stitching/detail/matchers.hpp> // For cv::detail::ImageFeatures
+
+/**
+ * @brief 64-bit FNV-1a hash of a byte range.
+ *
+ * @param data Bytes to hash.
+ * @param size Number of bytes.
+ * @param seed Starting value; pass a previous hash to chain several ranges.
+ */
+uint64_t fnv1a_hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+/**
+ * @brief On-disk cache of stitching features, keyed by image content and detector settings.
+ *
+ * Each entry is one file named after the 64-bit key (hash of the encoded image file,
+ * chained with the settings string), so changing the detector, its parameters or the
+ * registration scale never returns stale features. Entries have a flat layout with
+ * 4-byte aligned fields, so they can be memory-mapped directly:
+ *
+ *   char[4] "FEAT", uint32 version, int32 image width, int32 image height,
+ *   uint32 keypoint count, int32 descriptor rows, int32 descriptor cols, int32 descriptor type,
+ *   keypoints (float x, y, size, angle, response; int32 octave, class_id),
+ *   descriptors (rows * cols elements, row-major, no padding).
+ *
+ * Entries are written to a temporary file and renamed into place, so concurrent
+ * writers never expose a partial entry. Unreadable or mismatching entries count as misses.
+ */
+class FeatureCache {
+public:
+    /**
+     * @brief Opens a cache directory.
+     *
+     * @param directory Existing directory holding the cache entries.
+     * @param settings Description of everything besides the image that affects the
+     *                 features (detector, parameters, scale).
+     * @throws std::invalid_argument if the directory path is empty.
+     */
+    FeatureCache(const std::string& directory, const std::string& settings);
+
+    /**
+     * @brief Looks up the features of an image.
+     *
+     * @param content_hash fnv1a_hash() of the encoded image file.
+     * @param features Receives the cached features (img_idx is left unchanged).
+     * @return true on a hit, false if there is no valid entry.
+     */
+    bool load(uint64_t content_hash, cv::detail::ImageFeatures& features) const;
+
+    /**
+     * @brief Stores the features of an image.
+     *
+     * @param content_hash fnv1a_hash() of the encoded image file.
+     * @param features Features to store.
+     * @throws std::runtime_error if the entry cannot be written.
+     */
+    void store(uint64_t content_hash, const cv::detail::ImageFeatures& features) const;
+
+    /**
+     * @brief Path of the cache entry for an image.
+     */
+    std::string entry_path(uint64_t content_hash) const;
+
+private:
+    std::string directory_;
+    std::string settings_;
+};
+
+#endif // AI_SLOP_FEATURE_CACHE_HPP
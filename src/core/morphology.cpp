@@ -1,5 +1,16 @@
 #include "morphology.hpp"
+#include "parallel.hpp"
 #include <stdexcept> // For std::invalid_argument
+#include <algorithm> // For std::max, std::min
+#include <limits>    // For std::numeric_limits
+#include <vector>
+#include <cstdint>   // For uint64_t
+#include <cstdlib>   // For std::abs
+#include <cstring>   // For std::strcmp
+#include <map>       // For the structuring element cache
+#include <mutex>
+#include <string>
+#include <utility>   // For std::pair
 
 /**
  * @brief Validates the kernel size for morphological operations.
@@ -13,31 +24,1057 @@ static void validate_kernel_size(int kernel_size) {
     }
 }
 
-cv::Mat dilate_image(const cv::Mat& input_image, int kernel_size) {
+/**
+ * @brief Validates the iteration count for morphological operations.
+ *
+ * @param iterations The count to validate.
+ * @throws std::invalid_argument if iterations is not positive.
+ */
+static void validate_iterations(int iterations) {
+    if (iterations <= 0) {
+        throw std::invalid_argument("Iteration count must be positive, received: " + std::to_string(iterations));
+    }
+}
+
+/**
+ * @brief Kernel size of the single rectangle equivalent to repeated rectangular passes.
+ *
+ * Dilating (eroding) N times with a k x k rectangle is the same as dilating (eroding)
+ * once with a rectangle of size N * (k - 1) + 1, since rectangles are separable and
+ * the constant identity border commutes with the running extremum (cv::dilate
+ * performs the same substitution internally). The result is capped at the size
+ * where the window already covers the whole image.
+ */
+static int iterated_kernel_size(int kernel_size, int iterations, const cv::Size& image_size) {
+    const long long max_radius = std::max(image_size.width, image_size.height);
+    const long long radius = std::min(static_cast<long long>(iterations) * (kernel_size / 2), max_radius);
+    return static_cast<int>(2 * radius + 1);
+}
+
+// --- van Herk/Gil-Werman running extremum engine ---
+//
+// A rectangular dilation (erosion) is separable into a horizontal and a vertical
+// running max (min). The van Herk/Gil-Werman algorithm computes a running
+// extremum over a window of length k with about three comparisons per element,
+// independently of k: the line is cut into blocks of length k, a prefix extremum
+// g is accumulated forwards inside every block and a suffix extremum h backwards,
+// and any window of length k is then covered by the tail of one block and the head
+// of the next one, i.e. result = op(h[start], g[end]).
+//
+// The line is padded with the identity of the operation (lowest value for max,
+// highest value for min), which reproduces the default constant border used by
+// cv::dilate / cv::erode (morphologyDefaultBorderValue()).
+
+/**
+ * @brief Running maximum operation used by dilation.
+ */
+template <typename T>
+struct MaxOp {
+    static T identity() { return std::numeric_limits<T>::lowest(); }
+    T operator()(T a, T b) const { return std::max(a, b); }
+};
+
+/**
+ * @brief Running minimum operation used by erosion.
+ */
+template <typename T>
+struct MinOp {
+    static T identity() { return std::numeric_limits<T>::max(); }
+    T operator()(T a, T b) const { return std::min(a, b); }
+};
+
+/**
+ * @brief Running bitwise OR, used by the bit-packed binary engine (identity: no bit set).
+ */
+template <typename T>
+struct OrOp {
+    static T identity() { return T(0); }
+    T operator()(T a, T b) const { return a | b; }
+};
+
+// Number of interleaved elements processed together by one vertical strip.
+// Keeps the g/h strip buffers small enough to stay cache resident.
+static const int kVerticalStripElements = 256;
+
+// The engine passes split their rows (strips) into one contiguous range per worker,
+// and worker w only ever uses line buffer lines[w], so the buffers can live in a
+// caller-owned MorphologyWorkspace and be reused from call to call.
+
+/**
+ * @brief Returns a buffer of at least count elements of T, growing it only when needed.
+ */
+template <typename T>
+static T* line_buffer(cv::Mat& buffer, size_t count) {
+    const size_t bytes = count * sizeof(T);
+    if (buffer.total() * buffer.elemSize() < bytes) {
+        buffer.create(1, static_cast<int>(bytes), CV_8U);
+    }
+    return buffer.ptr<T>();
+}
+
+/**
+ * @brief Makes sure a set of buffers has line buffers for the given number of workers.
+ */
+static void reserve_workers(MorphologyBuffers& buffers, int workers) {
+    if (static_cast<int>(buffers.lines.size()) < workers) {
+        buffers.lines.resize(workers);
+    }
+}
+
+/**
+ * @brief Number of workers an engine pass over items rows (strips) runs with.
+ */
+static int engine_workers(const std::vector<cv::Mat>& lines, int items) {
+    return std::max(1, std::min(static_cast<int>(lines.size()), items));
+}
+
+/**
+ * @brief First item of a worker's contiguous share of items.
+ */
+static int worker_begin(int items, int worker, int workers) {
+    return static_cast<int>(static_cast<int64_t>(items) * worker / workers);
+}
+
+/**
+ * @brief Horizontal running extremum: dst(y, x) = op(src(y, x + lo) ... src(y, x + hi)).
+ *
+ * Channels are handled independently (interleaved elements with stride cn).
+ * Positions outside the row are treated as the identity of the operation.
+ *
+ * @param src Source image (depth matching T).
+ * @param dst Destination image, same size and type as src (may alias src: each row is
+ *            copied to a scratch line before it is written).
+ * @param lo First horizontal offset of the window (relative to the anchor).
+ * @param hi Last horizontal offset of the window (lo <= hi).
+ * @param lines Line buffers, one per worker (at least one).
+ */
+template <typename T, typename Op>
+static void running_extremum_rows(const cv::Mat& src, cv::Mat& dst, int lo, int hi, std::vector<cv::Mat>& lines) {
+    const int cols = src.cols;
+    const int cn = src.channels();
+    const int k = hi - lo + 1;
+    const int pad_left = std::max(0, -lo);
+    const int pad_right = std::max(0, hi);
+    const int padded = cols + pad_left + pad_right;
+    const size_t length = static_cast<size_t>(padded) * cn;
+    const int workers = engine_workers(lines, src.rows);
+    const T identity = Op::identity();
+    Op op;
+
+    parallel_for_ref(cv::Range(0, workers), [&](const cv::Range& range) {
+        for (int worker = range.start; worker < range.end; ++worker) {
+            // Per-worker scratch lines, reused for every row of the worker's share.
+            T* line = line_buffer<T>(lines[worker], 3 * length);
+            T* g = line + length;
+            T* h = g + length;
+            std::fill(line, line + length, identity);
+
+            const int y_end = worker_begin(src.rows, worker + 1, workers);
+            for (int y = worker_begin(src.rows, worker, workers); y < y_end; ++y) {
+                const T* s = src.ptr<T>(y);
+                T* d = dst.ptr<T>(y);
+                std::copy(s, s + static_cast<size_t>(cols) * cn, line + static_cast<size_t>(pad_left) * cn);
+
+                // Forward prefix extremum inside each block of k pixels.
+                for (int i = 0; i < padded; ++i) {
+                    const T* in = &line[static_cast<size_t>(i) * cn];
+                    T* out = &g[static_cast<size_t>(i) * cn];
+                    if (i % k == 0) {
+                        for (int c = 0; c < cn; ++c) out[c] = in[c];
+                    } else {
+                        const T* prev = out - cn;
+                        for (int c = 0; c < cn; ++c) out[c] = op(prev[c], in[c]);
+                    }
+                }
+                // Backward suffix extremum inside each block of k pixels.
+                for (int i = padded - 1; i >= 0; --i) {
+                    const T* in = &line[static_cast<size_t>(i) * cn];
+                    T* out = &h[static_cast<size_t>(i) * cn];
+                    if (i % k == k - 1 || i == padded - 1) {
+                        for (int c = 0; c < cn; ++c) out[c] = in[c];
+                    } else {
+                        const T* next = out + cn;
+                        for (int c = 0; c < cn; ++c) out[c] = op(next[c], in[c]);
+                    }
+                }
+                // Window [x + lo, x + hi] maps to padded [x + lo + pad_left, x + hi + pad_left].
+                for (int x = 0; x < cols; ++x) {
+                    const T* hs = &h[static_cast<size_t>(x + lo + pad_left) * cn];
+                    const T* ge = &g[static_cast<size_t>(x + hi + pad_left) * cn];
+                    T* out = d + static_cast<size_t>(x) * cn;
+                    for (int c = 0; c < cn; ++c) out[c] = op(hs[c], ge[c]);
+                }
+            }
+        }
+    });
+}
+
+/**
+ * @brief Vertical running extremum, computed in place:
+ *        img(y, x) = op(img(y + lo, x) ... img(y + hi, x)).
+ *
+ * The image is processed in vertical strips of interleaved elements so that the
+ * prefix/suffix buffers of a strip stay small. Each strip reads all of its source
+ * rows into the buffers before writing any output, which makes the in-place update safe.
+ *
+ * @param img Image to filter in place (depth matching T).
+ * @param lo First vertical offset of the window (relative to the anchor).
+ * @param hi Last vertical offset of the window (lo <= hi).
+ * @param lines Line buffers, one per worker (at least one).
+ */
+template <typename T, typename Op>
+static void running_extremum_cols(cv::Mat& img, int lo, int hi, std::vector<cv::Mat>& lines) {
+    const int rows = img.rows;
+    const int width = static_cast<int>(img.cols * img.elemSize() / sizeof(T)); // Elements of T per row
+    const int k = hi - lo + 1;
+    const int pad_top = std::max(0, -lo);
+    const int pad_bottom = std::max(0, hi);
+    const int padded = rows + pad_top + pad_bottom;
+    const int strips = (width + kVerticalStripElements - 1) / kVerticalStripElements;
+    const size_t length = static_cast<size_t>(padded) * kVerticalStripElements;
+    const int workers = engine_workers(lines, strips);
+    const T identity = Op::identity();
+    Op op;
+
+    parallel_for_ref(cv::Range(0, workers), [&](const cv::Range& range) {
+        for (int worker = range.start; worker < range.end; ++worker) {
+            T* g = line_buffer<T>(lines[worker], 2 * length + kVerticalStripElements);
+            T* h = g + length;
+            T* identity_row = h + length;
+            std::fill(identity_row, identity_row + kVerticalStripElements, identity);
+
+            const int strip_end = worker_begin(strips, worker + 1, workers);
+            for (int strip = worker_begin(strips, worker, workers); strip < strip_end; ++strip) {
+                const int x0 = strip * kVerticalStripElements;
+                const int sw = std::min(kVerticalStripElements, width - x0);
+                auto source_row = [&](int i) -> const T* {
+                    const int y = i - pad_top;
+                    return (y < 0 || y >= rows) ? identity_row : img.ptr<T>(y) + x0;
+                };
+
+                for (int i = 0; i < padded; ++i) {
+                    const T* in = source_row(i);
+                    T* out = &g[static_cast<size_t>(i) * kVerticalStripElements];
+                    if (i % k == 0) {
+                        std::copy(in, in + sw, out);
+                    } else {
+                        const T* prev = out - kVerticalStripElements;
+                        for (int x = 0; x < sw; ++x) out[x] = op(prev[x], in[x]);
+                    }
+                }
+                for (int i = padded - 1; i >= 0; --i) {
+                    const T* in = source_row(i);
+                    T* out = &h[static_cast<size_t>(i) * kVerticalStripElements];
+                    if (i % k == k - 1 || i == padded - 1) {
+                        std::copy(in, in + sw, out);
+                    } else {
+                        const T* next = out + kVerticalStripElements;
+                        for (int x = 0; x < sw; ++x) out[x] = op(next[x], in[x]);
+                    }
+                }
+                for (int y = 0; y < rows; ++y) {
+                    const T* hs = &h[static_cast<size_t>(y + lo + pad_top) * kVerticalStripElements];
+                    const T* ge = &g[static_cast<size_t>(y + hi + pad_top) * kVerticalStripElements];
+                    T* out = img.ptr<T>(y) + x0;
+                    for (int x = 0; x < sw; ++x) out[x] = op(hs[x], ge[x]);
+                }
+            }
+        }
+    });
+}
+
+/**
+ * @brief Applies a separable rectangular running extremum of the given element type.
+ */
+template <typename T, template <typename> class Op>
+static void rect_extremum(const cv::Mat& src, cv::Mat& dst, const cv::Rect& window, std::vector<cv::Mat>& lines) {
+    dst.create(src.size(), src.type());
+    if (window.width > 1 || window.x != 0) {
+        running_extremum_rows<T, Op<T>>(src, dst, window.x, window.x + window.width - 1, lines);
+    } else {
+        src.copyTo(dst);
+    }
+    if (window.height > 1 || window.y != 0) {
+        running_extremum_cols<T, Op<T>>(dst, window.y, window.y + window.height - 1, lines);
+    }
+}
+
+/**
+ * @brief Checks whether the running extremum engine handles the given depth.
+ */
+static bool engine_supports_depth(int depth) {
+    return depth == CV_8U || depth == CV_16U || depth == CV_16S || depth == CV_32F || depth == CV_64F;
+}
+
+/**
+ * @brief Dilates or erodes an image with a rectangular element using the
+ *        van Herk/Gil-Werman engine (constant cost per pixel, whatever the kernel size).
+ *
+ * @param src Source image. Any channel count; depths 8U, 16U, 16S, 32F and 64F are supported.
+ * @param dst Destination image (must not alias src).
+ * @param window Window offsets relative to the anchor: x/y are the first offsets,
+ *               width/height the window extent.
+ * @param dilate True for dilation (running max), false for erosion (running min).
+ * @param lines Line buffers, one per worker (at least one).
+ * @return bool False if the depth is not supported by the engine.
+ */
+static bool rect_morphology(const cv::Mat& src, cv::Mat& dst, const cv::Rect& window, bool dilate,
+                            std::vector<cv::Mat>& lines) {
+    switch (src.depth()) {
+        case CV_8U:
+            dilate ? rect_extremum<uchar, MaxOp>(src, dst, window, lines)
+                   : rect_extremum<uchar, MinOp>(src, dst, window, lines);
+            return true;
+        case CV_16U:
+            dilate ? rect_extremum<ushort, MaxOp>(src, dst, window, lines)
+                   : rect_extremum<ushort, MinOp>(src, dst, window, lines);
+            return true;
+        case CV_16S:
+            dilate ? rect_extremum<short, MaxOp>(src, dst, window, lines)
+                   : rect_extremum<short, MinOp>(src, dst, window, lines);
+            return true;
+        case CV_32F:
+            dilate ? rect_extremum<float, MaxOp>(src, dst, window, lines)
+                   : rect_extremum<float, MinOp>(src, dst, window, lines);
+            return true;
+        case CV_64F:
+            dilate ? rect_extremum<double, MaxOp>(src, dst, window, lines)
+                   : rect_extremum<double, MinOp>(src, dst, window, lines);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// --- Bit-packed binary engine ---
+//
+// Masks holding only 0 and 255 are packed 64 pixels per 64-bit word (pixel x of a
+// row is bit x % 64 of word x / 64), so every memory access moves 8x less data
+// and each logical operation handles 64 pixels at once.
+//
+// Dilation uses shifts and OR: horizontally the OR of a window of k bits is built
+// by doubling (O(log k) word operations), vertically the van Herk/Gil-Werman engine
+// runs directly on the words with OR as the operation. Erosion is computed through
+// duality as NOT dilate(NOT mask), which keeps the border behaviour of cv::erode
+// (pixels outside the image never remove foreground).
+//
+// Packed images are stored in CV_32SC2 matrices (8 bytes per element, one word each).
+
+/**
+ * @brief Checks whether an image is a binary mask (8-bit single channel, values 0 or 255 only).
+ */
+static bool is_binary_mask(const cv::Mat& image) {
+    if (image.type() != CV_8UC1) {
+        return false;
+    }
+    for (int y = 0; y < image.rows; ++y) {
+        const uchar* row = image.ptr<uchar>(y);
+        for (int x = 0; x < image.cols; ++x) {
+            if (row[x] != 0 && row[x] != 255) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Mask of the valid bits in the last word of a packed row.
+ */
+static uint64_t last_word_mask(int cols) {
+    const int used = cols % 64;
+    return used == 0 ? ~uint64_t(0) : ((uint64_t(1) << used) - 1);
+}
+
+/**
+ * @brief Packs a binary mask into words, optionally complementing it.
+ *        Bits past the last column are always cleared.
+ */
+static void pack_mask(const cv::Mat& mask, cv::Mat& packed, bool invert) {
+    const int words = (mask.cols + 63) / 64;
+    packed.create(mask.rows, words, CV_32SC2);
+    const uint64_t tail = last_word_mask(mask.cols);
+
+    parallel_for_ref(cv::Range(0, mask.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uchar* src = mask.ptr<uchar>(y);
+            uint64_t* dst = packed.ptr<uint64_t>(y);
+            for (int w = 0; w < words; ++w) {
+                const int x0 = w * 64;
+                const int n = std::min(64, mask.cols - x0);
+                uint64_t bits = 0;
+                for (int b = 0; b < n; ++b) {
+                    bits |= uint64_t(src[x0 + b] != 0) << b;
+                }
+                dst[w] = invert ? ~bits : bits;
+            }
+            dst[words - 1] &= tail;
+        }
+    });
+}
+
+/**
+ * @brief Expands packed words back to a 0/255 mask, optionally complementing it.
+ */
+static void unpack_mask(const cv::Mat& packed, cv::Mat& mask, int cols, bool invert) {
+    mask.create(packed.rows, cols, CV_8UC1);
+    const uchar on = invert ? 0 : 255;
+    const uchar off = invert ? 255 : 0;
+
+    parallel_for_ref(cv::Range(0, packed.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uint64_t* src = packed.ptr<uint64_t>(y);
+            uchar* dst = mask.ptr<uchar>(y);
+            for (int x = 0; x < cols; ++x) {
+                dst[x] = ((src[x >> 6] >> (x & 63)) & 1) ? on : off;
+            }
+        }
+    });
+}
+
+/**
+ * @brief Complements packed words, keeping the bits past the last column cleared.
+ *        May run in place.
+ */
+static void complement_packed(const cv::Mat& src, cv::Mat& dst, int cols) {
+    dst.create(src.size(), src.type());
+    const uint64_t tail = last_word_mask(cols);
+    for (int y = 0; y < src.rows; ++y) {
+        const uint64_t* s = src.ptr<uint64_t>(y);
+        uint64_t* d = dst.ptr<uint64_t>(y);
+        for (int w = 0; w < src.cols; ++w) {
+            d[w] = ~s[w];
+        }
+        d[src.cols - 1] &= tail;
+    }
+}
+
+/**
+ * @brief Shifts a packed row by s bits: dst(x) = src(x + s). Positive s pulls bits
+ *        from higher columns, negative s pushes them towards higher columns.
+ *        Bits shifted in from outside the row are 0.
+ */
+static void shift_packed_row(const uint64_t* src, uint64_t* dst, int words, int s) {
+    const int q = (s >= 0 ? s : -s) >> 6;
+    const int r = (s >= 0 ? s : -s) & 63;
+    if (s >= 0) {
+        for (int w = 0; w < words; ++w) {
+            const uint64_t lo = (w + q < words) ? src[w + q] : 0;
+            const uint64_t hi = (w + q + 1 < words) ? src[w + q + 1] : 0;
+            dst[w] = r == 0 ? lo : ((lo >> r) | (hi << (64 - r)));
+        }
+    } else {
+        for (int w = words - 1; w >= 0; --w) {
+            const uint64_t hi = (w - q >= 0) ? src[w - q] : 0;
+            const uint64_t lo = (w - q - 1 >= 0) ? src[w - q - 1] : 0;
+            dst[w] = r == 0 ? hi : ((hi << r) | (lo >> (64 - r)));
+        }
+    }
+}
+
+/**
+ * @brief Binary dilation of packed rows with a horizontal window [lo, hi].
+ */
+static void binary_dilate_rows(const cv::Mat& src, cv::Mat& dst, int lo, int hi, int cols,
+                               std::vector<cv::Mat>& lines) {
+    const int words = src.cols;
+    const int k = hi - lo + 1;
+    const uint64_t tail = last_word_mask(cols);
+    // Zero margin on both sides of the row so that partial windows reaching past
+    // the row ends are not lost by the intermediate shifts.
+    const int margin = (std::max(std::abs(lo), std::abs(hi)) + 63) / 64 + 1;
+    const int padded = words + 2 * margin;
+    const int workers = engine_workers(lines, src.rows);
+
+    parallel_for_ref(cv::Range(0, workers), [&](const cv::Range& range) {
+        for (int worker = range.start; worker < range.end; ++worker) {
+            uint64_t* power = line_buffer<uint64_t>(lines[worker], 3 * static_cast<size_t>(padded));
+            uint64_t* acc = power + padded;
+            uint64_t* shifted = acc + padded;
+
+            const int y_end = worker_begin(src.rows, worker + 1, workers);
+            for (int y = worker_begin(src.rows, worker, workers); y < y_end; ++y) {
+                const uint64_t* s = src.ptr<uint64_t>(y);
+                uint64_t* d = dst.ptr<uint64_t>(y);
+
+                // acc(x) = OR of src over [x, x + len), built from power(x) = OR over [x, x + p)
+                std::fill(power, power + padded, 0);
+                std::copy(s, s + words, power + margin);
+                std::fill(acc, acc + padded, 0);
+                int len = 0;
+                for (int p = 1, remaining = k; remaining > 0; p *= 2, remaining >>= 1) {
+                    if (remaining & 1) {
+                        shift_packed_row(power, shifted, padded, len);
+                        for (int w = 0; w < padded; ++w) acc[w] |= shifted[w];
+                        len += p;
+                    }
+                    if (remaining > 1) {
+                        shift_packed_row(power, shifted, padded, p);
+                        for (int w = 0; w < padded; ++w) power[w] |= shifted[w];
+                    }
+                }
+                // dst(x) = acc(x + lo) covers [x + lo, x + hi]
+                shift_packed_row(acc, shifted, padded, lo);
+                std::copy(shifted + margin, shifted + margin + words, d);
+                d[words - 1] &= tail;
+            }
+        }
+    });
+}
+
+/**
+ * @brief Binary dilation of a packed mask with a rectangular window (see rect_morphology).
+ */
+static void binary_dilate_packed(const cv::Mat& src, cv::Mat& dst, const cv::Rect& window, int cols,
+                                 std::vector<cv::Mat>& lines) {
+    dst.create(src.size(), src.type());
+    if (window.width > 1 || window.x != 0) {
+        binary_dilate_rows(src, dst, window.x, window.x + window.width - 1, cols, lines);
+    } else {
+        src.copyTo(dst);
+    }
+    if (window.height > 1 || window.y != 0) {
+        running_extremum_cols<uint64_t, OrOp<uint64_t>>(dst, window.y, window.y + window.height - 1, lines);
+    }
+}
+
+/**
+ * @brief Binary erosion of a packed mask, computed as NOT dilate(NOT src).
+ */
+static void binary_erode_packed(const cv::Mat& src, cv::Mat& dst, const cv::Rect& window, int cols,
+                                MorphologyBuffers& buffers) {
+    complement_packed(src, buffers.complement, cols);
+    binary_dilate_packed(buffers.complement, dst, window, cols, buffers.lines);
+    complement_packed(dst, dst, cols);
+}
+
+/**
+ * @brief In-place union (OR) or intersection (AND) of two packed masks: dst op= src.
+ */
+static void combine_packed(const cv::Mat& src, cv::Mat& dst, bool use_or) {
+    for (int y = 0; y < src.rows; ++y) {
+        const uint64_t* s = src.ptr<uint64_t>(y);
+        uint64_t* d = dst.ptr<uint64_t>(y);
+        for (int w = 0; w < src.cols; ++w) {
+            d[w] = use_or ? (d[w] | s[w]) : (d[w] & s[w]);
+        }
+    }
+}
+
+/**
+ * @brief Set difference of two packed masks: out = a AND NOT b. out may alias a or b.
+ */
+static void subtract_packed(const cv::Mat& a, const cv::Mat& b, cv::Mat& out) {
+    for (int y = 0; y < a.rows; ++y) {
+        const uint64_t* pa = a.ptr<uint64_t>(y);
+        const uint64_t* pb = b.ptr<uint64_t>(y);
+        uint64_t* po = out.ptr<uint64_t>(y);
+        for (int w = 0; w < a.cols; ++w) po[w] = pa[w] & ~pb[w];
+    }
+}
+
+// --- Structuring elements ---
+//
+// Every supported element is decomposed into a union of rectangular windows:
+// the dilation (erosion) by a union of sets is the maximum (minimum) of the
+// dilations (erosions) by each set, and every rectangle runs on the O(1) engine.
+// A rectangle is one window, a cross is a horizontal and a vertical line, and an
+// ellipse/disk is one rectangle per distinct row width (about radius windows
+// instead of kernel_size^2 taps per pixel).
+//
+// Decompositions are cached process-wide by (shape, size), so video loops and
+// batch runs do not rebuild them.
+
+/**
+ * @brief Structuring element prepared for execution.
+ */
+struct DecomposedElement {
+    std::vector<cv::Rect>& windows; // Rectangular windows relative to the anchor (empty: not decomposable),
+                                    // kept in the caller's workspace
+    int reach = 0;                  // Largest vertical offset reached by any window
+    int iterations = 1;             // Passes to execute (rectangles fold their iterations into one pass)
+};
+
+/**
+ * @brief Validates the structuring element shape.
+ *
+ * @param shape The shape to validate.
+ * @throws std::invalid_argument if shape is not MORPH_RECT, MORPH_CROSS or MORPH_ELLIPSE.
+ */
+static void validate_shape(int shape) {
+    if (shape != cv::MORPH_RECT && shape != cv::MORPH_CROSS && shape != cv::MORPH_ELLIPSE) {
+        throw std::invalid_argument("Unsupported structuring element shape: " + std::to_string(shape));
+    }
+}
+
+/**
+ * @brief Decomposes a centered structuring element into a union of rectangles.
+ *
+ * Each row of the element must be a single contiguous run. For the run of every
+ * row, the rows above and below whose runs contain it are gathered into one
+ * rectangle; the union of those rectangles is exactly the element.
+ *
+ * @param element The element (CV_8U, non-zero = member).
+ * @return std::vector<cv::Rect> The windows, or an empty vector if a row is not contiguous.
+ */
+static std::vector<cv::Rect> decompose_element(const cv::Mat& element) {
+    const int anchor_x = element.cols / 2;
+    const int anchor_y = element.rows / 2;
+    std::vector<int> first(element.rows, -1), last(element.rows, -2);
+
+    for (int y = 0; y < element.rows; ++y) {
+        const uchar* row = element.ptr<uchar>(y);
+        for (int x = 0; x < element.cols; ++x) {
+            if (!row[x]) continue;
+            if (first[y] < 0) {
+                first[y] = x;
+            } else if (last[y] != x - 1) {
+                return std::vector<cv::Rect>(); // Row with a hole: not decomposable
+            }
+            last[y] = x;
+        }
+    }
+
+    std::vector<cv::Rect> windows;
+    for (int y = 0; y < element.rows; ++y) {
+        if (first[y] < 0) continue;
+        auto contains = [&](int r) { return first[r] >= 0 && first[r] <= first[y] && last[r] >= last[y]; };
+        int top = y, bottom = y;
+        while (top > 0 && contains(top - 1)) --top;
+        while (bottom + 1 < element.rows && contains(bottom + 1)) ++bottom;
+
+        const cv::Rect window(first[y] - anchor_x, top - anchor_y, last[y] - first[y] + 1, bottom - top + 1);
+        if (std::find(windows.begin(), windows.end(), window) == windows.end()) {
+            windows.push_back(window);
+        }
+    }
+    return windows;
+}
+
+/**
+ * @brief Returns the decomposition of a (shape, size) element from the process-wide cache.
+ *        Entries are never removed, so the reference stays valid.
+ */
+static const std::vector<cv::Rect>& cached_decomposition(int shape, int kernel_size) {
+    static std::mutex cache_mutex;
+    static std::map<std::pair<int, int>, std::vector<cv::Rect>> cache;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    const auto key = std::make_pair(shape, kernel_size);
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        cv::Mat element = cv::getStructuringElement(shape, cv::Size(kernel_size, kernel_size));
+        it = cache.emplace(key, decompose_element(element)).first;
+    }
+    return it->second;
+}
+
+/**
+ * @brief Fills in the execution plan for an element of the given shape, size and iteration count.
+ *        The window list reuses the capacity of element.windows.
+ */
+static void prepare_element(int shape, int kernel_size, int iterations, const cv::Size& image_size,
+                            DecomposedElement& element) {
+    if (shape == cv::MORPH_RECT) {
+        // All iterations collapse into one pass of the O(1) engine.
+        const int effective_size = iterated_kernel_size(kernel_size, iterations, image_size);
+        const int radius = effective_size / 2;
+        element.windows.assign(1, cv::Rect(-radius, -radius, effective_size, effective_size));
+    } else {
+        element.windows = cached_decomposition(shape, kernel_size);
+        element.iterations = iterations;
+    }
+    for (const cv::Rect& window : element.windows) {
+        element.reach = std::max(element.reach, std::max(-window.y, window.y + window.height - 1));
+    }
+}
+
+/**
+ * @brief One pass of a decomposed element on 8/16/32/64-bit data: max (min) over all windows.
+ *        Partial results go to buffers.scratch.
+ */
+static void element_pass(const cv::Mat& src, cv::Mat& dst, MorphologyBuffers& buffers,
+                         const std::vector<cv::Rect>& windows, bool dilate) {
+    rect_morphology(src, dst, windows[0], dilate, buffers.lines);
+    for (size_t i = 1; i < windows.size(); ++i) {
+        rect_morphology(src, buffers.scratch, windows[i], dilate, buffers.lines);
+        if (dilate) {
+            cv::max(dst, buffers.scratch, dst);
+        } else {
+            cv::min(dst, buffers.scratch, dst);
+        }
+    }
+}
+
+/**
+ * @brief One pass of a decomposed element on a packed binary mask: OR (AND) over all windows.
+ *        Partial results go to buffers.scratch.
+ */
+static void binary_element_pass(const cv::Mat& src, cv::Mat& dst, MorphologyBuffers& buffers,
+                                const std::vector<cv::Rect>& windows, bool dilate, int cols) {
+    auto apply = [&](const cv::Rect& window, cv::Mat& out) {
+        if (dilate) {
+            binary_dilate_packed(src, out, window, cols, buffers.lines);
+        } else {
+            binary_erode_packed(src, out, window, cols, buffers);
+        }
+    };
+    apply(windows[0], dst);
+    for (size_t i = 1; i < windows.size(); ++i) {
+        apply(windows[i], buffers.scratch);
+        combine_packed(buffers.scratch, dst, dilate);
+    }
+}
+
+/**
+ * @brief Runs all iterations of one stage, alternating between two work buffers.
+ *
+ * @param src Stage input (not modified, never used as an output).
+ * @param work0 First work buffer.
+ * @param work1 Second work buffer (only used for two or more iterations).
+ * @param iterations Number of passes.
+ * @param pass Callable (const cv::Mat& in, cv::Mat& out) performing one pass.
+ * @return const cv::Mat& The work buffer holding the stage result.
+ */
+template <typename Pass>
+static const cv::Mat& run_stage(const cv::Mat& src, cv::Mat& work0, cv::Mat& work1, int iterations, Pass pass) {
+    const cv::Mat* current = &src;
+    cv::Mat* targets[2] = {&work0, &work1};
+    for (int i = 0; i < iterations; ++i) {
+        cv::Mat& out = *targets[i % 2];
+        pass(*current, out);
+        current = &out;
+    }
+    return *current;
+}
+
+/**
+ * @brief Runs a compound operation (two stages and an optional difference) on one
+ *        block of data using the given buffers.
+ *
+ * @param in The input block.
+ * @param buffers Work buffers; the returned result is one of them.
+ * @param morph_op The compound operation.
+ * @param iterations Passes per stage.
+ * @param pass Callable (const cv::Mat& in, cv::Mat& out, MorphologyBuffers& buffers, bool dilate).
+ * @param difference Callable (const cv::Mat& a, const cv::Mat& b, cv::Mat& out) computing a - b.
+ */
+template <typename Pass, typename Difference>
+static const cv::Mat& run_compound(const cv::Mat& in, MorphologyBuffers& buffers, int morph_op, int iterations,
+                                   Pass pass, Difference difference) {
+    auto stage = [&](const cv::Mat& src, cv::Mat& work0, cv::Mat& work1, bool dilate) -> const cv::Mat& {
+        return run_stage(src, work0, work1, iterations,
+                         [&](const cv::Mat& s, cv::Mat& d) { pass(s, d, buffers, dilate); });
+    };
+    // The second stage (or operand) must not write into the first stage's result.
+    auto free_buffer = [&](const cv::Mat& used) -> cv::Mat& { return &used == &buffers.a ? buffers.b : buffers.a; };
+
+    if (morph_op == cv::MORPH_GRADIENT) {
+        const cv::Mat& dilated = stage(in, buffers.a, buffers.b, true);
+        cv::Mat& eroded = const_cast<cv::Mat&>(stage(in, buffers.c, free_buffer(dilated), false));
+        difference(dilated, eroded, eroded);
+        return eroded;
+    }
+
+    const bool first_dilate = (morph_op == cv::MORPH_CLOSE || morph_op == cv::MORPH_BLACKHAT);
+    const cv::Mat& first = stage(in, buffers.a, buffers.b, first_dilate);
+    cv::Mat& second = const_cast<cv::Mat&>(stage(first, buffers.c, free_buffer(first), !first_dilate));
+    if (morph_op == cv::MORPH_TOPHAT) {
+        difference(in, second, second);     // src - opening
+    } else if (morph_op == cv::MORPH_BLACKHAT) {
+        difference(second, in, second);     // closing - src
+    }
+    return second;
+}
+
+// --- Banded execution ---
+//
+// Multi-pass operations (compound operations, iterated non-rectangular elements)
+// run band by band: each band of output rows is computed from a band of input
+// rows extended by a halo, using small per-thread buffers that are swapped between
+// the passes (ping-pong). Intermediate results therefore only ever exist for one
+// band at a time instead of as full-size images, and all passes of a band complete
+// while it is still cache resident.
+//
+// Rows of a pass that are closer than the element reach to an interior band edge
+// are wrong (the engine treats the band edge as an image border), but the halo
+// (reach * passes) is chosen so that those rows never reach the rows copied to
+// the output.
+
+/**
+ * @brief Output rows per band for a given halo. Larger halos get taller bands so
+ *        the recomputed halo rows stay a bounded fraction of the work.
+ */
+static int band_rows_for_halo(int halo) {
+    return std::max(64, 4 * halo);
+}
+
+/**
+ * @brief Points the stage buffers of a band worker at rows of one grow-only backing image.
+ *
+ * The first, interior and last bands have different heights; binding views of the
+ * right height keeps every create() on them a no-op instead of reallocating whenever
+ * the height changes.
+ */
+static void bind_band_buffers(MorphologyBuffers& buffers, int rows, int capacity, int cols, int type) {
+    cv::Mat* stages[] = {&buffers.a, &buffers.b, &buffers.c, &buffers.scratch};
+    const int slots = 4;
+    if (buffers.storage.rows < slots * capacity || buffers.storage.cols != cols || buffers.storage.type() != type) {
+        buffers.storage.create(slots * capacity, cols, type);
+    }
+    const int slot_rows = buffers.storage.rows / slots;
+    for (int i = 0; i < slots; ++i) {
+        *stages[i] = buffers.storage.rowRange(i * slot_rows, i * slot_rows + rows);
+    }
+}
+
+/**
+ * @brief Runs a banded operation over src and writes the result into dst.
+ *
+ * The bands are split into one contiguous share per worker, and each worker uses its
+ * own buffers from band_buffers for all of its bands. Engine passes inside a band run
+ * on the worker's thread (one line buffer set each).
+ *
+ * @param src Source image.
+ * @param dst Destination image (allocated here, same size and type as src).
+ * @param halo Number of extra input rows needed above and below each band.
+ * @param band_buffers Per-worker buffers; grown to the number of workers.
+ * @param band_op Callable (const cv::Mat& in_band, MorphologyBuffers& buffers) -> const cv::Mat&
+ *                returning the buffer that holds the result for all rows of in_band.
+ */
+template <typename BandOp>
+static void process_bands(const cv::Mat& src, cv::Mat& dst, int halo, std::vector<MorphologyBuffers>& band_buffers,
+                          BandOp band_op) {
+    dst.create(src.size(), src.type());
+    const int band_rows = band_rows_for_halo(halo);
+    const int bands = (src.rows + band_rows - 1) / band_rows;
+    const int workers = std::max(1, std::min(cv::getNumThreads(), bands));
+    const int band_capacity = std::min(src.rows, band_rows + 2 * halo);
+    if (static_cast<int>(band_buffers.size()) < workers) {
+        band_buffers.resize(workers);
+    }
+
+    parallel_for_ref(cv::Range(0, workers), [&](const cv::Range& range) {
+        for (int worker = range.start; worker < range.end; ++worker) {
+            MorphologyBuffers& buffers = band_buffers[worker];
+            reserve_workers(buffers, 1);
+            const int band_end = worker_begin(bands, worker + 1, workers);
+            for (int band = worker_begin(bands, worker, workers); band < band_end; ++band) {
+                const int y0 = band * band_rows;
+                const int y1 = std::min(src.rows, y0 + band_rows);
+                const int in0 = std::max(0, y0 - halo);
+                const int in1 = std::min(src.rows, y1 + halo);
+
+                bind_band_buffers(buffers, in1 - in0, band_capacity, src.cols, src.type());
+                const cv::Mat& result = band_op(src.rowRange(in0, in1), buffers);
+                cv::Mat dst_band = dst.rowRange(y0, y1);
+                result.rowRange(y0 - in0, y1 - in0).copyTo(dst_band);
+            }
+        }
+    });
+}
+
+/**
+ * @brief Converts a compound morphology operation code to a readable name.
+ */
+static const char* morph_operation_name(int morph_op) {
+    switch (morph_op) {
+        case cv::MORPH_OPEN: return "opening";
+        case cv::MORPH_CLOSE: return "closing";
+        case cv::MORPH_GRADIENT: return "morphological gradient";
+        case cv::MORPH_TOPHAT: return "top-hat";
+        case cv::MORPH_BLACKHAT: return "black-hat";
+        default: return "unknown";
+    }
+}
+
+/**
+ * @brief Shared implementation of dilate_image / erode_image.
+ *
+ * output_image may alias input_image. The binary, single-rectangle and OpenCV paths
+ * are in-place safe; the banded path reads neighbouring rows after earlier bands are
+ * written, so an aliased output goes through workspace.staging there.
+ */
+static void single_morphology(const cv::Mat& input_image, cv::Mat& output_image, MorphologyWorkspace& workspace,
+                              int kernel_size, int iterations, int shape, bool dilate) {
     validate_kernel_size(kernel_size);
+    validate_iterations(iterations);
+    validate_shape(shape);
+    if (input_image.empty()) {
+        throw std::invalid_argument(std::string("Input image for ") + (dilate ? "dilation" : "erosion") + " is empty.");
+    }
+
+    DecomposedElement element = {workspace.windows};
+    prepare_element(shape, kernel_size, iterations, input_image.size(), element);
+    MorphologyBuffers& buffers = workspace.image;
+    reserve_workers(buffers, cv::getNumThreads());
+
+    if (!element.windows.empty() && is_binary_mask(input_image)) {
+        // 0/255 masks: bit-packed engine, 64 pixels per word. Erosion packs the
+        // complement, dilates it and unpacks the complement again.
+        pack_mask(input_image, workspace.packed, !dilate);
+        const cv::Mat& result = run_stage(workspace.packed, buffers.a, buffers.b, element.iterations,
+            [&](const cv::Mat& s, cv::Mat& d) { binary_element_pass(s, d, buffers, element.windows, true, input_image.cols); });
+        unpack_mask(result, output_image, input_image.cols, !dilate);
+    } else if (!element.windows.empty() && engine_supports_depth(input_image.depth())) {
+        if (element.windows.size() == 1 && element.iterations == 1) {
+            // Single rectangle: one full-image pass, no intermediate buffers
+            rect_morphology(input_image, output_image, element.windows[0], dilate, buffers.lines);
+        } else {
+            const bool in_place = input_image.data == output_image.data;
+            process_bands(input_image, in_place ? workspace.staging : output_image, element.reach * element.iterations,
+                workspace.bands,
+                [&](const cv::Mat& in, MorphologyBuffers& band) -> const cv::Mat& {
+                    return run_stage(in, band.a, band.b, element.iterations,
+                        [&](const cv::Mat& s, cv::Mat& d) { element_pass(s, d, band, element.windows, dilate); });
+                });
+            if (in_place) {
+                workspace.staging.copyTo(output_image);
+            }
+        }
+    } else {
+        // Unsupported depth (e.g. 8S, 32S): fall back to OpenCV's generic path.
+        cv::Mat kernel = cv::getStructuringElement(shape, cv::Size(kernel_size, kernel_size));
+        if (dilate) {
+            cv::dilate(input_image, output_image, kernel, cv::Point(-1, -1), iterations);
+        } else {
+            cv::erode(input_image, output_image, kernel, cv::Point(-1, -1), iterations);
+        }
+    }
+}
 
-    // Create the structuring element (kernel) for dilation
-    // Using a rectangular element here, could also use MORPH_CROSS or MORPH_ELLIPSE
-    cv::Mat element = cv::getStructuringElement(cv::MORPH_RECT,
-                                            cv::Size(kernel_size, kernel_size));
+void dilate_image(const cv::Mat& input_image, cv::Mat& output_image, MorphologyWorkspace& workspace,
+                  int kernel_size, int iterations, int shape) {
+    // Union of rectangles: separable running max, O(1) per pixel per rectangle
+    single_morphology(input_image, output_image, workspace, kernel_size, iterations, shape, true);
+}
+
+void erode_image(const cv::Mat& input_image, cv::Mat& output_image, MorphologyWorkspace& workspace,
+                 int kernel_size, int iterations, int shape) {
+    // Union of rectangles: separable running min, O(1) per pixel per rectangle
+    single_morphology(input_image, output_image, workspace, kernel_size, iterations, shape, false);
+}
+
+void dilate_image(const cv::Mat& input_image, cv::Mat& output_image, int kernel_size, int iterations, int shape) {
+    MorphologyWorkspace workspace;
+    dilate_image(input_image, output_image, workspace, kernel_size, iterations, shape);
+}
+
+void erode_image(const cv::Mat& input_image, cv::Mat& output_image, int kernel_size, int iterations, int shape) {
+    MorphologyWorkspace workspace;
+    erode_image(input_image, output_image, workspace, kernel_size, iterations, shape);
+}
 
-    cv::Mat dilated_image;
-    // Perform dilation
-    cv::dilate(input_image, dilated_image, element);
+cv::Mat dilate_image(const cv::Mat& input_image, int kernel_size, int iterations, int shape) {
+    cv::Mat output_image;
+    dilate_image(input_image, output_image, kernel_size, iterations, shape);
+    return output_image;
+}
 
-    return dilated_image;
+cv::Mat erode_image(const cv::Mat& input_image, int kernel_size, int iterations, int shape) {
+    cv::Mat output_image;
+    erode_image(input_image, output_image, kernel_size, iterations, shape);
+    return output_image;
 }
 
-cv::Mat erode_image(const cv::Mat& input_image, int kernel_size) {
+void morph_compound_image(const cv::Mat& input_image, cv::Mat& output_image, MorphologyWorkspace& workspace,
+                          int morph_op, int kernel_size, int iterations, int shape) {
     validate_kernel_size(kernel_size);
+    validate_iterations(iterations);
+    validate_shape(shape);
+    const char* name = morph_operation_name(morph_op);
+    if (std::strcmp(name, "unknown") == 0) {
+        throw std::invalid_argument("Unsupported compound morphology operation: " + std::to_string(morph_op));
+    }
+    if (input_image.empty()) {
+        throw std::invalid_argument(std::string("Input image for ") + name + " is empty.");
+    }
+
+    DecomposedElement element = {workspace.windows};
+    prepare_element(shape, kernel_size, iterations, input_image.size(), element);
+
+    if (!element.windows.empty() && is_binary_mask(input_image)) {
+        // The packed mask is 8x smaller than the 8-bit image, so the stages run on
+        // whole packed images instead of bands.
+        const int cols = input_image.cols;
+        MorphologyBuffers& buffers = workspace.image;
+        reserve_workers(buffers, cv::getNumThreads());
+        pack_mask(input_image, workspace.packed, false);
+        const cv::Mat& result = run_compound(workspace.packed, buffers, morph_op, element.iterations,
+            [&](const cv::Mat& s, cv::Mat& d, MorphologyBuffers& b, bool dilate) {
+                binary_element_pass(s, d, b, element.windows, dilate, cols);
+            },
+            subtract_packed);
+        unpack_mask(result, output_image, cols, false);
+    } else if (!element.windows.empty() && engine_supports_depth(input_image.depth())) {
+        // Opening/closing/top-hat/black-hat chain two stages; the gradient runs two
+        // independent stages on the same input. Bands read rows around them, so an
+        // aliased output is produced in workspace.staging first.
+        const int stages = (morph_op == cv::MORPH_GRADIENT) ? 1 : 2;
+        const bool in_place = input_image.data == output_image.data;
+        process_bands(input_image, in_place ? workspace.staging : output_image,
+            stages * element.reach * element.iterations, workspace.bands,
+            [&](const cv::Mat& in, MorphologyBuffers& band) -> const cv::Mat& {
+                return run_compound(in, band, morph_op, element.iterations,
+                    [&](const cv::Mat& s, cv::Mat& d, MorphologyBuffers& b, bool dilate) {
+                        element_pass(s, d, b, element.windows, dilate);
+                    },
+                    [](const cv::Mat& a, const cv::Mat& b, cv::Mat& out) { cv::subtract(a, b, out); });
+            });
+        if (in_place) {
+            workspace.staging.copyTo(output_image);
+        }
+    } else {
+        cv::Mat kernel = cv::getStructuringElement(shape, cv::Size(kernel_size, kernel_size));
+        cv::morphologyEx(input_image, output_image, morph_op, kernel, cv::Point(-1, -1), iterations);
+    }
+}
 
-    // Create the structuring element (kernel) for erosion
-    cv::Mat element = cv::getStructuringElement(cv::MORPH_RECT,
-                                            cv::Size(kernel_size, kernel_size));
+void morph_compound_image(const cv::Mat& input_image, cv::Mat& output_image, int morph_op, int kernel_size,
+                          int iterations, int shape) {
+    MorphologyWorkspace workspace;
+    morph_compound_image(input_image, output_image, workspace, morph_op, kernel_size, iterations, shape);
+}
 
-    cv::Mat eroded_image;
-    // Perform erosion
-    cv::erode(input_image, eroded_image, element);
+cv::Mat morph_compound_image(const cv::Mat& input_image, int morph_op, int kernel_size, int iterations, int shape) {
+    cv::Mat output_image;
+    morph_compound_image(input_image, output_image, morph_op, kernel_size, iterations, shape);
+    return output_image;
+}
 
-    return eroded_image;
-} 
\ No newline at end of file
+std::vector<MorphologyBenchmark> benchmark_morphology(const cv::Mat& input_image, const std::vector<int>& kernel_sizes,
+                                                      int repeats, bool dilate) {
+    if (input_image.empty() || repeats <= 0) {
+        throw std::invalid_argument("Morphology benchmark needs a non-empty image and a positive repeat count.");
+    }
+    for (int kernel_size : kernel_sizes) {
+        validate_kernel_size(kernel_size);
+    }
+
+    MorphologyWorkspace workspace;
+    cv::Mat output;
+    std::vector<MorphologyBenchmark> results;
+    for (int kernel_size : kernel_sizes) {
+        MorphologyBenchmark result;
+        result.kernel_size = kernel_size;
+
+        // Engine path: workspace and destination reused (one warm-up run first)
+        single_morphology(input_image, output, workspace, kernel_size, 1, cv::MORPH_RECT, dilate);
+        int64 start = cv::getTickCount();
+        for (int i = 0; i < repeats; ++i) {
+            single_morphology(input_image, output, workspace, kernel_size, 1, cv::MORPH_RECT, dilate);
+        }
+        result.engine_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / repeats;
+
+        // Reference path: OpenCV with the equivalent rectangular element
+        const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_RECT, cv::Size(kernel_size, kernel_size));
+        dilate ? cv::dilate(input_image, output, kernel) : cv::erode(input_image, output, kernel);
+        start = cv::getTickCount();
+        for (int i = 0; i < repeats; ++i) {
+            dilate ? cv::dilate(input_image, output, kernel) : cv::erode(input_image, output, kernel);
+        }
+        result.opencv_ms = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() / repeats;
+        results.push_back(result);
+    }
+    return results;
+}
@@ -1,27 +1,198 @@
 #ifndef AI_SLOP_MORPHOLOGY_HPP
 #define AI_SLOP_MORPHOLOGY_HPP
 
+#include <vector>
 #include <opencv2/core.hpp> // For cv::Mat
 #include <opencv2/imgproc.hpp> // For morphological operations
 
+/**
+ * @brief Scratch buffers of one worker of the morphology engines.
+ */
+struct MorphologyBuffers {
+    cv::Mat a, b, c;            // Stage buffers, swapped between passes
+    cv::Mat scratch;            // Partial result of a multi-window element
+    cv::Mat complement;         // Complemented packed mask of a binary erosion
+    cv::Mat storage;            // Banded passes: backing rows of a, b, c and scratch
+    std::vector<cv::Mat> lines; // Line buffers of the running extremum engines, one per worker
+};
+
+/**
+ * @brief Caller-owned scratch memory for repeated morphology calls.
+ *
+ * The workspace overloads keep their packed masks, band buffers, line buffers and
+ * element decomposition here instead of allocating them on every call. Buffers only
+ * grow, so once a loop has processed its largest frame, further calls with the same
+ * workspace and destination do not touch the heap on the engine paths (8/16/32/64-bit
+ * images with rectangle, cross or ellipse elements, and binary masks). The exceptions
+ * are OpenCV's own: its thread pool allocates a job record per parallel dispatch when
+ * more than one thread is used, and depths the engines do not handle fall back to
+ * cv::dilate / cv::erode / cv::morphologyEx. tests/test_allocations.cpp checks this
+ * with a counting allocator.
+ *
+ * A workspace must not be used by two calls at the same time.
+ */
+struct MorphologyWorkspace {
+    MorphologyBuffers image;              // Whole-image passes
+    std::vector<MorphologyBuffers> bands; // One per worker of the banded passes
+    cv::Mat packed;                       // Bit-packed input mask
+    cv::Mat staging;                      // Result of an in-place banded call before it is copied back
+    std::vector<cv::Rect> windows;        // Rectangles of the structuring element
+};
+
 /**
  * @brief Dilates an input image.
  *
+ * The structuring element is decomposed into a union of rectangles (one for
+ * cv::MORPH_RECT, two lines for cv::MORPH_CROSS, one rectangle per distinct row
+ * width for cv::MORPH_ELLIPSE), and each rectangle is computed as a separable
+ * van Herk/Gil-Werman running maximum, so the cost per pixel does not depend on
+ * kernel_size. Decompositions are cached per (shape, size). Binary masks (8-bit
+ * single-channel, values 0/255 only) are detected automatically and processed by a
+ * bit-packed engine (64 pixels per word).
+ *
  * @param input_image The source image (cv::Mat).
  * @param kernel_size The size of the structuring element kernel (must be a positive odd integer).
+ * @param iterations Number of times the dilation is applied (default: 1). Repeated
+ *                   rectangular dilations are executed as a single pass.
+ * @param shape Structuring element shape: cv::MORPH_RECT (default), cv::MORPH_CROSS
+ *              or cv::MORPH_ELLIPSE.
  * @return cv::Mat The dilated image.
- * @throws std::invalid_argument if kernel_size is not a positive odd integer.
+ * @throws std::invalid_argument if kernel_size is not a positive odd integer, iterations
+ *                               is not positive, the shape is unsupported or the image is empty.
  */
-cv::Mat dilate_image(const cv::Mat& input_image, int kernel_size);
+cv::Mat dilate_image(const cv::Mat& input_image, int kernel_size, int iterations = 1,
+                     int shape = cv::MORPH_RECT);
 
 /**
  * @brief Erodes an input image.
  *
+ * The structuring element is decomposed into rectangles and computed with
+ * separable van Herk/Gil-Werman running minima, as for dilate_image(). Binary
+ * masks use the bit-packed engine.
+ *
  * @param input_image The source image (cv::Mat).
  * @param kernel_size The size of the structuring element kernel (must be a positive odd integer).
+ * @param iterations Number of times the erosion is applied (default: 1). Repeated
+ *                   rectangular erosions are executed as a single pass.
+ * @param shape Structuring element shape: cv::MORPH_RECT (default), cv::MORPH_CROSS
+ *              or cv::MORPH_ELLIPSE.
  * @return cv::Mat The eroded image.
- * @throws std::invalid_argument if kernel_size is not a positive odd integer.
+ * @throws std::invalid_argument if kernel_size is not a positive odd integer, iterations
+ *                               is not positive, the shape is unsupported or the image is empty.
+ */
+cv::Mat erode_image(const cv::Mat& input_image, int kernel_size, int iterations = 1,
+                    int shape = cv::MORPH_RECT);
+
+/**
+ * @brief Applies a compound morphological operation in a single banded pass.
+ *
+ * Supported operations are opening (cv::MORPH_OPEN), closing (cv::MORPH_CLOSE),
+ * morphological gradient (cv::MORPH_GRADIENT), top-hat (cv::MORPH_TOPHAT) and
+ * black-hat (cv::MORPH_BLACKHAT).
+ * The image is processed in horizontal bands with small reusable per-thread buffers,
+ * so the intermediate result (e.g. the erosion inside an opening) is never
+ * materialized as a full-size image. Binary masks run on the bit-packed engine.
+ * Results match cv::morphologyEx.
+ *
+ * @param input_image The source image (cv::Mat).
+ * @param morph_op The operation, one of the cv::MorphTypes listed above.
+ * @param kernel_size The size of the structuring element kernel (must be a positive odd integer).
+ * @param iterations Number of erosions/dilations per stage, as in cv::morphologyEx (default: 1).
+ *                   Each band then carries a halo of iterations * radius rows per stage, so
+ *                   all iterations of a band complete while it is cache resident.
+ * @param shape Structuring element shape: cv::MORPH_RECT (default), cv::MORPH_CROSS
+ *              or cv::MORPH_ELLIPSE.
+ * @return cv::Mat The processed image.
+ * @throws std::invalid_argument if kernel_size or iterations is invalid, the operation is
+ *                               unsupported, the shape is unsupported or the image is empty.
+ */
+cv::Mat morph_compound_image(const cv::Mat& input_image, int morph_op, int kernel_size, int iterations = 1,
+                             int shape = cv::MORPH_RECT);
+
+/**
+ * @brief Dilates into a caller-owned destination.
+ *
+ * Same as dilate_image() above, but writes to output_image, which is only
+ * (re)allocated when its size or type differs from the input. Reusing the same
+ * destination across frames therefore avoids a full-image allocation per call;
+ * scratch buffers are still allocated per call (see the workspace overload).
+ * output_image may be input_image itself (in-place dilation).
+ *
+ * @throws std::invalid_argument under the same conditions as dilate_image().
+ */
+void dilate_image(const cv::Mat& input_image, cv::Mat& output_image, int kernel_size, int iterations = 1,
+                  int shape = cv::MORPH_RECT);
+
+/**
+ * @brief Erodes into a caller-owned destination (may be input_image itself).
+ *
+ * @throws std::invalid_argument under the same conditions as erode_image().
+ */
+void erode_image(const cv::Mat& input_image, cv::Mat& output_image, int kernel_size, int iterations = 1,
+                 int shape = cv::MORPH_RECT);
+
+/**
+ * @brief Applies a compound morphological operation into a caller-owned destination
+ *        (may be input_image itself).
+ *
+ * @throws std::invalid_argument under the same conditions as morph_compound_image().
+ */
+void morph_compound_image(const cv::Mat& input_image, cv::Mat& output_image, int morph_op, int kernel_size,
+                          int iterations = 1, int shape = cv::MORPH_RECT);
+
+/**
+ * @brief Dilates into a caller-owned destination with caller-owned scratch memory.
+ *
+ * Same as the out-parameter overload, with all intermediate buffers taken from
+ * workspace. A per-frame loop that reuses both workspace and output_image does not
+ * allocate image-sized or line buffers after its first frame.
+ *
+ * @throws std::invalid_argument under the same conditions as dilate_image().
+ */
+void dilate_image(const cv::Mat& input_image, cv::Mat& output_image, MorphologyWorkspace& workspace,
+                  int kernel_size, int iterations = 1, int shape = cv::MORPH_RECT);
+
+/**
+ * @brief Erodes with caller-owned destination and scratch memory (see the dilate overload).
+ *
+ * @throws std::invalid_argument under the same conditions as erode_image().
+ */
+void erode_image(const cv::Mat& input_image, cv::Mat& output_image, MorphologyWorkspace& workspace,
+                 int kernel_size, int iterations = 1, int shape = cv::MORPH_RECT);
+
+/**
+ * @brief Compound operation with caller-owned destination and scratch memory (see the dilate overload).
+ *
+ * @throws std::invalid_argument under the same conditions as morph_compound_image().
+ */
+void morph_compound_image(const cv::Mat& input_image, cv::Mat& output_image, MorphologyWorkspace& workspace,
+                          int morph_op, int kernel_size, int iterations = 1, int shape = cv::MORPH_RECT);
+
+/**
+ * @brief Time per run of the rectangle engine versus OpenCV for one kernel size.
+ */
+struct MorphologyBenchmark {
+    int kernel_size = 0;    ///< Side of the square cv::MORPH_RECT element
+    double engine_ms = 0.0; ///< Milliseconds per dilate_image/erode_image run (workspace reused)
+    double opencv_ms = 0.0; ///< Milliseconds per cv::dilate/cv::erode run
+};
+
+/**
+ * @brief Times rectangular dilation or erosion of one image with the van Herk/Gil-Werman
+ *        engine and with cv::dilate/cv::erode, for each kernel size.
+ *
+ * Each path runs once untimed per kernel size, then repeats times. Binary masks are
+ * timed on the bit-packed engine, like dilate_image() would run them.
+ *
+ * @param input_image The source image.
+ * @param kernel_sizes Element sizes to time (positive odd integers).
+ * @param repeats Number of timed runs per path and size. Must be positive.
+ * @param dilate True to time dilation, false for erosion.
+ * @return std::vector<MorphologyBenchmark> One entry per kernel size, in order.
+ * @throws std::invalid_argument if the image is empty, a kernel size is invalid or the
+ *                               repeat count is not positive.
  */
-cv::Mat erode_image(const cv::Mat& input_image, int kernel_size);
+std::vector<MorphologyBenchmark> benchmark_morphology(const cv::Mat& input_image, const std::vector<int>& kernel_sizes,
+                                                      int repeats, bool dilate);
 
 #endif // AI_SLOP_MORPHOLOGY_HPP 
\ No newline at end of file
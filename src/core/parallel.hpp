@@ -0,0 +1,26 @@
+#ifndef AI_SLOP_PARALLEL_HPP
+#define AI_SLOP_PARALLEL_HPP
+
+#include <opencv2/core.hpp> // For cv::parallel_for_
+#include <functional>       // For std::cref
+
+/**
+ * @brief cv::parallel_for_ for per-frame kernels, without a heap copy of the loop body.
+ *
+ * cv::parallel_for_ wraps its body in a std::function, which copies a capturing
+ * lambda to the heap once it outgrows the small-object buffer (a few pointers).
+ * Passing the body through std::cref stores only a reference, so the dispatch itself
+ * does not allocate. With more than one thread, OpenCV's thread pool still allocates
+ * its job record per dispatch; with cv::setNumThreads(1) the body runs inline.
+ *
+ * @param range The iteration range, as for cv::parallel_for_.
+ * @param body Callable (const cv::Range&); must outlive the call (a temporary lambda does).
+ * @param nstripes Stripe count hint, as for cv::parallel_for_.
+ */
+template <typename Body>
+inline void parallel_for_ref(const cv::Range& range, const Body& body, double nstripes = -1.)
+{
+    cv::parallel_for_(range, std::cref(body), nstripes);
+}
+
+#endif // AI_SLOP_PARALLEL_HPP
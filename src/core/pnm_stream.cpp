@@ -0,0 +1,137 @@
+#include "pnm_stream.hpp"
+#include <algorithm> // For std::transform, std::min
+#include <cctype>    // For std::isspace, std::tolower
+#include <stdexcept> // For std::runtime_error, std::invalid_argument
+
+/**
+ * Reads the next whitespace-separated header token, skipping '#' comments.
+ */
+static std::string read_header_token(std::ifstream& in)
+{
+    std::string token;
+    int c = in.get();
+    while (in) {
+        if (c == '#') {
+            while (in && c != '\n' && c != '\r') {
+                c = in.get();
+            }
+        } else if (std::isspace(c)) {
+            if (!token.empty()) {
+                break; // The single whitespace after the last header field is consumed here
+            }
+        } else {
+            token.push_back(static_cast<char>(c));
+        }
+        c = in.get();
+    }
+    return token;
+}
+
+static int parse_header_int(std::ifstream& in, const std::string& path, const char* field)
+{
+    const std::string token = read_header_token(in);
+    try {
+        size_t used = 0;
+        int value = std::stoi(token, &used);
+        if (used == token.size() && value > 0) {
+            return value;
+        }
+    } catch (const std::exception&) {
+        // Fall through to the error below
+    }
+    throw std::runtime_error("Invalid PNM " + std::string(field) + " in: " + path);
+}
+
+PnmReader::PnmReader(const std::string& path)
+    : in_(path, std::ios::binary), path_(path)
+{
+    if (!in_.is_open()) {
+        throw std::runtime_error("Failed to open image for streaming: " + path);
+    }
+
+    const std::string magic = read_header_token(in_);
+    if (magic == "P5") {
+        channels_ = 1;
+    } else if (magic == "P6") {
+        channels_ = 3;
+    } else {
+        throw std::runtime_error("Streaming requires a binary PGM (P5) or PPM (P6) file: " + path);
+    }
+    width_ = parse_header_int(in_, path, "width");
+    height_ = parse_header_int(in_, path, "height");
+    const int maxval = parse_header_int(in_, path, "maxval");
+    if (maxval > 255) {
+        throw std::runtime_error("Streaming supports 8-bit PNM files only (maxval <= 255): " + path);
+    }
+    if (maxval < 255) {
+        // Samples are rescaled to 0..255 as they are read; values above maxval saturate
+        rescale_.resize(256);
+        for (int v = 0; v < 256; ++v) {
+            rescale_[v] = static_cast<uchar>(std::min(255, (v * 255 + maxval / 2) / maxval));
+        }
+    }
+}
+
+void PnmReader::read_rows(uchar* buffer, int rows)
+{
+    if (rows < 0 || rows_read_ + rows > height_) {
+        throw std::runtime_error("Attempt to read past the last row of: " + path_);
+    }
+    const std::streamsize bytes = static_cast<std::streamsize>(row_bytes() * rows);
+    in_.read(reinterpret_cast<char*>(buffer), bytes);
+    if (in_.gcount() != bytes) {
+        throw std::runtime_error("Unexpected end of PNM data in: " + path_);
+    }
+    if (!rescale_.empty()) {
+        std::transform(buffer, buffer + bytes, buffer, [this](uchar v) { return rescale_[v]; });
+    }
+    rows_read_ += rows;
+}
+
+PnmWriter::PnmWriter(const std::string& path, int width, int height, int channels)
+    : path_(path), width_(width), height_(height), channels_(channels)
+{
+    if (channels != 1 && channels != 3) {
+        throw std::invalid_argument("PNM output supports 1 or 3 channels, received: " + std::to_string(channels));
+    }
+    out_.open(path, std::ios::binary);
+    if (!out_.is_open()) {
+        throw std::runtime_error("Failed to create output image: " + path);
+    }
+    out_ << (channels == 1 ? "P5" : "P6") << "\n" << width << " " << height << "\n255\n";
+}
+
+void PnmWriter::write_row(const uchar* row)
+{
+    if (rows_written_ >= height_) {
+        throw std::runtime_error("Attempt to write past the last row of: " + path_);
+    }
+    out_.write(reinterpret_cast<const char*>(row), static_cast<std::streamsize>(width_) * channels_);
+    if (!out_) {
+        throw std::runtime_error("Failed to write output image: " + path_);
+    }
+    ++rows_written_;
+}
+
+void PnmWriter::close()
+{
+    if (rows_written_ != height_) {
+        throw std::runtime_error("Output image is incomplete (" + std::to_string(rows_written_) + " of "
+                                 + std::to_string(height_) + " rows): " + path_);
+    }
+    out_.close();
+    if (!out_) {
+        throw std::runtime_error("Failed to finish output image: " + path_);
+    }
+}
+
+bool is_pnm_path(const std::string& path)
+{
+    const size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+    std::string ext = path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == "pgm" || ext == "ppm" || ext == "pnm";
+}
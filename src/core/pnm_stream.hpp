@@ -0,0 +1,96 @@
+#ifndef AI_SLOP_PNM_STREAM_HPP
+#define AI_SLOP_PNM_STREAM_HPP
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp> // For uchar
+
+/**
+ * @brief Row-by-row reader for binary 8-bit PGM (P5) and PPM (P6) files.
+ *
+ * Only the header is parsed up front; pixel rows are read on demand, so an
+ * image of any height can be processed with memory proportional to its width.
+ * Files with a maxval below 255 are rescaled to 0..255 as rows are read.
+ */
+class PnmReader {
+public:
+    /**
+     * @brief Opens a PNM file and parses its header.
+     *
+     * @param path Path to a binary PGM/PPM file with maxval <= 255.
+     * @throws std::runtime_error if the file cannot be opened or is not a supported PNM file.
+     */
+    explicit PnmReader(const std::string& path);
+
+    /**
+     * @brief Reads the next rows into a buffer of rows * row_bytes() bytes.
+     *
+     * @param buffer Destination for the interleaved pixel data.
+     * @param rows Number of rows to read; must not exceed the rows remaining.
+     * @throws std::runtime_error if the file ends early.
+     */
+    void read_rows(uchar* buffer, int rows);
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int channels() const { return channels_; }
+    size_t row_bytes() const { return static_cast<size_t>(width_) * channels_; }
+    int rows_read() const { return rows_read_; }
+
+private:
+    std::ifstream in_;
+    std::string path_;
+    int width_ = 0;
+    int height_ = 0;
+    int channels_ = 0;
+    int rows_read_ = 0;
+    std::vector<uchar> rescale_; // maxval -> 255 lookup table; empty when maxval is 255
+};
+
+/**
+ * @brief Row-by-row writer for binary 8-bit PGM (P5) and PPM (P6) files.
+ */
+class PnmWriter {
+public:
+    /**
+     * @brief Creates the file and writes the header.
+     *
+     * @param path Output path.
+     * @param width Image width in pixels.
+     * @param height Image height in pixels.
+     * @param channels 1 (PGM) or 3 (PPM).
+     * @throws std::invalid_argument if the channel count is not 1 or 3.
+     * @throws std::runtime_error if the file cannot be created.
+     */
+    PnmWriter(const std::string& path, int width, int height, int channels);
+
+    /**
+     * @brief Appends one row of width * channels bytes.
+     *
+     * @throws std::runtime_error if writing fails or more rows than the header declares are written.
+     */
+    void write_row(const uchar* row);
+
+    /**
+     * @brief Flushes and closes the file.
+     *
+     * @throws std::runtime_error if fewer rows than the header declares were written.
+     */
+    void close();
+
+private:
+    std::ofstream out_;
+    std::string path_;
+    int width_;
+    int height_;
+    int channels_;
+    int rows_written_ = 0;
+};
+
+/**
+ * @brief Returns true if the path has a .pgm, .ppm or .pnm extension (case-insensitive).
+ */
+bool is_pnm_path(const std::string& path);
+
+#endif // AI_SLOP_PNM_STREAM_HPP
@@ -1,9 +1,95 @@
 #include "resize.hpp"
+#include "parallel.hpp"
+#include "pnm_stream.hpp"
+#include <opencv2/imgcodecs.hpp> // For cv::imread, cv::imwrite
+#include <opencv2/core/hal/intrin.hpp> // Universal intrinsics for the bilinear kernel
 #include <stdexcept> // For std::invalid_argument
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
 
-cv::Mat resize_image(const cv::Mat& input_image,
-                     double factor,
-                     int interpolation) 
+/**
+ * Single interpolation pass to dsize. 8-bit bilinear resizes run on the fixed-point
+ * ResizePlan kernel (channel-specialised, SIMD vertical pass), kept in the workspace
+ * while the pass stays the same; everything else goes through cv::resize. dst may
+ * alias src; it is then rebound to a new buffer.
+ */
+static void resize_single_pass(const cv::Mat& src, cv::Mat& dst, cv::Size dsize, int interpolation,
+                               ResizeWorkspace& workspace)
+{
+    if (interpolation == cv::INTER_LINEAR && src.depth() == CV_8U && src.channels() <= 4) {
+        std::unique_ptr<ResizePlan>& plan = workspace.plan;
+        if (!plan || !plan->matches(src.size(), src.type()) || plan->dst_size() != dsize
+            || plan->interpolation() != interpolation) {
+            plan.reset(new ResizePlan(src.size(), dsize, interpolation, src.type()));
+        }
+        if (src.data == dst.data) {
+            cv::Mat resized;
+            plan->apply(src, resized);
+            dst = resized;
+        } else {
+            plan->apply(src, dst);
+        }
+    } else {
+        cv::resize(src, dst, dsize, 0, 0, interpolation);
+    }
+}
+
+/**
+ * Resizes to dsize, first halving with 2x2 box reductions while the image is still at
+ * least twice the target in both dimensions, then finishing with one interpolation.
+ * Each halving is cv::resize with INTER_AREA at exactly half size on an even-sized view,
+ * which OpenCV runs through its vectorized fast-area kernel; at most one trailing
+ * row/column is dropped per level. Nearest-neighbour requests skip the pyramid.
+ * Intermediate levels live in the workspace; a level that is already the result is
+ * written straight into output_image.
+ */
+static void pyramid_resize(const cv::Mat& input_image, cv::Mat& output_image, cv::Size dsize, int interpolation,
+                           ResizeWorkspace& workspace)
+{
+    cv::Mat current = input_image;
+    const bool in_place = output_image.data == input_image.data;
+    if (interpolation != cv::INTER_NEAREST && interpolation != cv::INTER_NEAREST_EXACT) {
+        for (size_t level = 0; current.cols >= 2 * dsize.width && current.rows >= 2 * dsize.height; ++level) {
+            const cv::Mat even = current(cv::Rect(0, 0, current.cols & ~1, current.rows & ~1));
+            const cv::Size half(even.cols / 2, even.rows / 2);
+            if (half == dsize && !in_place) {
+                cv::resize(even, output_image, half, 0, 0, cv::INTER_AREA);
+                return;
+            }
+            if (workspace.levels.size() <= level) {
+                workspace.levels.resize(level + 1);
+            }
+            cv::resize(even, workspace.levels[level], half, 0, 0, cv::INTER_AREA);
+            current = workspace.levels[level];
+        }
+    }
+
+    if (current.size() != dsize) {
+        resize_single_pass(current, output_image, dsize, interpolation, workspace);
+    } else {
+        current.copyTo(output_image); // Same size as the input (no-op in place), or an in-place pyramid result
+    }
+}
+
+void resize_image(const cv::Mat& input_image,
+                  cv::Mat& output_image,
+                  double factor,
+                  int interpolation)
+{
+    ResizeWorkspace workspace;
+    resize_image(input_image, output_image, workspace, factor, interpolation);
+}
+
+void resize_image(const cv::Mat& input_image,
+                  cv::Mat& output_image,
+                  ResizeWorkspace& workspace,
+                  double factor,
+                  int interpolation)
 {
     if (factor <= 0) {
         throw std::invalid_argument("Resize factor must be positive, received: " + std::to_string(factor));
@@ -14,37 +100,643 @@ cv::Mat resize_image(const cv::Mat& input_image,
         throw std::invalid_argument("Input image for resize is empty."); 
     }
 
-    cv::Mat resized_image;
+    // Large reductions go through the 2x pyramid; the rest is a single pass
+    if (factor < 0.5) {
+        pyramid_resize(input_image, output_image, scaled_size(input_image.size(), factor), interpolation, workspace);
+        return;
+    }
+
+    if (interpolation == cv::INTER_LINEAR && input_image.depth() == CV_8U) {
+        resize_single_pass(input_image, output_image, scaled_size(input_image.size(), factor), interpolation,
+                           workspace);
+        return;
+    }
+
     // cv::resize uses fx and fy for scaling factors.
     // Setting dsize to (0, 0) tells it to use the factors.
     cv::resize(input_image, 
-               resized_image, 
+               output_image, 
                cv::Size(), // Target size (0,0 means calculate from factors)
                factor,      // Scale factor along X axis
                factor,      // Scale factor along Y axis
                interpolation);
+}
 
+cv::Mat resize_image(const cv::Mat& input_image,
+                     double factor,
+                     int interpolation) 
+{
+    cv::Mat resized_image;
+    resize_image(input_image, resized_image, factor, interpolation);
     return resized_image;
 }
 
-// Implementation for potential future overload:
-/*
-cv::Mat resize_image(const cv::Mat& input_image, int target_width, int target_height, int interpolation) {
+cv::Size scaled_size(cv::Size src_size, double factor)
+{
+    if (factor <= 0) {
+        throw std::invalid_argument("Resize factor must be positive, received: " + std::to_string(factor));
+    }
+    // Same rounding cv::resize applies when dsize is derived from fx/fy
+    return cv::Size(std::max(1, static_cast<int>(std::lround(src_size.width * factor))),
+                    std::max(1, static_cast<int>(std::lround(src_size.height * factor))));
+}
+
+// --- ResizePlan ---
+
+// Fixed-point precision of the interpolation weights (matches OpenCV's INTER_RESIZE_COEF_BITS)
+static const int kResizeCoefBits = 11;
+static const int kResizeCoefScale = 1 << kResizeCoefBits;
+
+/**
+ * Source position of destination coordinate d along one axis, split into the left tap
+ * and its fractional weight. Uses cv::resize's half-pixel-centre mapping with the same
+ * reciprocal-of-inverse scale and float arithmetic, so the taps and rounded weights
+ * are the ones cv::resize computes.
+ */
+static int linear_source_tap(int d, double scale, float& fraction)
+{
+    const float f = static_cast<float>((d + 0.5) * scale - 0.5);
+    const int s = cvFloor(f);
+    fraction = f - s;
+    return s;
+}
+
+/**
+ * Computes the left tap and fixed-point weight pair for every destination column, as
+ * cv::resize does for INTER_LINEAR (taps outside the image are clamped with zero
+ * fraction).
+ */
+static void linear_column_table(int src_len, int dst_len, std::vector<int>& ofs, std::vector<short>& weights)
+{
+    const double scale = 1.0 / (static_cast<double>(dst_len) / src_len);
+    ofs.resize(dst_len);
+    weights.resize(2 * static_cast<size_t>(dst_len));
+    for (int d = 0; d < dst_len; ++d) {
+        float f = 0.f;
+        int s = linear_source_tap(d, scale, f);
+        if (s < 0) {
+            s = 0;
+            f = 0.f;
+        }
+        if (s >= src_len - 1) {
+            s = src_len - 1;
+            f = 0.f;
+        }
+        short w0 = cv::saturate_cast<short>((1.f - f) * kResizeCoefScale);
+        short w1 = cv::saturate_cast<short>(f * kResizeCoefScale);
+        if (s == src_len - 1 && src_len > 1) {
+            // Same sample expressed as full weight on the right tap, so the right tap
+            // is always the left tap + 1 and stays inside the row
+            s = src_len - 2;
+            w1 = w0;
+            w0 = 0;
+        }
+        ofs[d] = s;
+        weights[2 * d] = w0;
+        weights[2 * d + 1] = w1;
+    }
+}
+
+/**
+ * Computes the two source rows and fixed-point weight pair for every destination row,
+ * as cv::resize does for INTER_LINEAR (rows are clamped, weights are not).
+ */
+static void linear_row_table(int src_len, int dst_len,
+                             std::vector<int>& ofs0, std::vector<int>& ofs1, std::vector<short>& weights)
+{
+    const double scale = 1.0 / (static_cast<double>(dst_len) / src_len);
+    ofs0.resize(dst_len);
+    ofs1.resize(dst_len);
+    weights.resize(2 * static_cast<size_t>(dst_len));
+    for (int d = 0; d < dst_len; ++d) {
+        float f = 0.f;
+        const int s = linear_source_tap(d, scale, f);
+        ofs0[d] = std::min(std::max(s, 0), src_len - 1);
+        ofs1[d] = std::min(std::max(s + 1, 0), src_len - 1);
+        weights[2 * d] = cv::saturate_cast<short>((1.f - f) * kResizeCoefScale);
+        weights[2 * d + 1] = cv::saturate_cast<short>(f * kResizeCoefScale);
+    }
+}
+
+/**
+ * Computes the source index for every destination coordinate along one axis
+ * the way cv::resize does for INTER_NEAREST (including its reciprocal-of-inverse scale).
+ */
+static void nearest_axis_table(int src_len, int dst_len, std::vector<int>& ofs)
+{
+    const double scale = 1.0 / (static_cast<double>(dst_len) / src_len);
+    ofs.resize(dst_len);
+    for (int d = 0; d < dst_len; ++d) {
+        ofs[d] = std::min(static_cast<int>(std::floor(d * scale)), src_len - 1);
+    }
+}
+
+/**
+ * Expands per-column source indices into per-element offsets for interleaved channels.
+ */
+static void expand_to_channels(std::vector<int>& ofs, int channels)
+{
+    std::vector<int> expanded(ofs.size() * channels);
+    for (size_t d = 0; d < ofs.size(); ++d) {
+        for (int c = 0; c < channels; ++c) {
+            expanded[d * channels + c] = ofs[d] * channels + c;
+        }
+    }
+    ofs.swap(expanded);
+}
+
+ResizePlan::ResizePlan(cv::Size src_size, cv::Size dst_size, int interpolation, int type)
+    : src_size_(src_size), dst_size_(dst_size), interpolation_(interpolation), type_(type),
+      use_tables_(false), stripes_(1)
+{
+    if (src_size.width <= 0 || src_size.height <= 0 || dst_size.width <= 0 || dst_size.height <= 0) {
+        throw std::invalid_argument("ResizePlan requires non-empty source and destination sizes.");
+    }
+
+    const int channels = CV_MAT_CN(type);
+    use_tables_ = CV_MAT_DEPTH(type) == CV_8U && channels <= 4
+        && (interpolation == cv::INTER_NEAREST || interpolation == cv::INTER_LINEAR);
+    if (!use_tables_) {
+        return;
+    }
+
+    if (interpolation == cv::INTER_NEAREST) {
+        nearest_axis_table(src_size.width, dst_size.width, xofs0_);
+        nearest_axis_table(src_size.height, dst_size.height, yofs0_);
+        expand_to_channels(xofs0_, channels);
+        return;
+    }
+
+    // Linear columns stay per destination column; the channel loop is unrolled in the kernel
+    linear_column_table(src_size.width, dst_size.width, xofs0_, alpha_);
+    linear_row_table(src_size.height, dst_size.height, yofs0_, yofs1_, beta_);
+    for (int& ofs : xofs0_) {
+        ofs *= channels;
+    }
+
+    // Each stripe keeps its last two horizontally-resized source rows
+    stripes_ = std::max(1, std::min(cv::getNumThreads(), dst_size.height));
+    row_buffers_.assign(static_cast<size_t>(stripes_) * 2 * dst_size.width * channels, 0);
+}
+
+bool ResizePlan::matches(cv::Size src_size, int type) const
+{
+    return src_size == src_size_ && type == type_;
+}
+
+void ResizePlan::apply(const cv::Mat& src, cv::Mat& dst)
+{
+    if (src.empty() || !matches(src.size(), src.type())) {
+        throw std::invalid_argument("Input frame does not match the size and type of the resize plan.");
+    }
+    if (src.data == dst.data) {
+        throw std::invalid_argument("ResizePlan cannot resize in place.");
+    }
+
+    if (!use_tables_) {
+        cv::resize(src, dst, dst_size_, 0, 0, interpolation_);
+        return;
+    }
+
+    dst.create(dst_size_, type_); // No-op when dst is reused across frames
+    if (interpolation_ == cv::INTER_NEAREST) {
+        apply_nearest(src, dst);
+    } else {
+        apply_linear(src, dst);
+    }
+}
+
+void ResizePlan::apply_nearest(const cv::Mat& src, cv::Mat& dst) const
+{
+    const int width = static_cast<int>(xofs0_.size());
+    const int* xofs = xofs0_.data();
+    parallel_for_ref(cv::Range(0, dst.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; ++y) {
+            const uchar* s = src.ptr<uchar>(yofs0_[y]);
+            uchar* d = dst.ptr<uchar>(y);
+            for (int x = 0; x < width; ++x) {
+                d[x] = s[xofs[x]];
+            }
+        }
+    });
+}
+
+/**
+ * Horizontal pass of the fixed-point bilinear kernel for one source row, specialised on
+ * the channel count so the per-pixel channel loop is fully unrolled. xofs holds the
+ * element offset of the left tap per destination column; the right tap is `next`
+ * elements further (the channel count, or 0 for one-pixel-wide sources).
+ */
+template <int CN>
+static void linear_horizontal(const uchar* src, int* out, const int* xofs, const short* alpha,
+                              int dst_cols, int next)
+{
+    for (int dx = 0; dx < dst_cols; ++dx) {
+        const uchar* p = src + xofs[dx];
+        const int a0 = alpha[2 * dx];
+        const int a1 = alpha[2 * dx + 1];
+        for (int c = 0; c < CN; ++c) {
+            out[dx * CN + c] = p[c] * a0 + p[c + next] * a1;
+        }
+    }
+}
+
+/**
+ * Vertical pass: blends two horizontally-resized rows and narrows to 8 bits. Rounds
+ * exactly like cv::resize's 8-bit vertical pass: each row is reduced to 16 bits
+ * (>> 4), multiplied by its weight keeping the high 16 bits, and the sum is rounded
+ * by the remaining 2 bits. Uses OpenCV universal intrinsics, which compile to
+ * SSE4/AVX2 on x86 and NEON on ARM, with a scalar tail.
+ */
+static void linear_vertical(const int* r0, const int* r1, int b0, int b1, uchar* dst, int width)
+{
+    int x = 0;
+#if CV_SIMD
+    const cv::v_int32 vb0 = cv::vx_setall_s32(b0);
+    const cv::v_int32 vb1 = cv::vx_setall_s32(b1);
+    const cv::v_int32 vround = cv::vx_setall_s32(2);
+    const int lanes = cv::v_int32::nlanes;
+    auto blend = [&](int offset) {
+        return cv::v_shr<2>(cv::v_shr<16>(cv::v_shr<4>(cv::vx_load(r0 + offset)) * vb0)
+                            + cv::v_shr<16>(cv::v_shr<4>(cv::vx_load(r1 + offset)) * vb1) + vround);
+    };
+    for (; x <= width - 4 * lanes; x += 4 * lanes) {
+        cv::v_store(dst + x, cv::v_pack_u(cv::v_pack(blend(x), blend(x + lanes)),
+                                          cv::v_pack(blend(x + 2 * lanes), blend(x + 3 * lanes))));
+    }
+#endif
+    for (; x < width; ++x) {
+        // (r >> 4) * b stays below 2^26, so nothing overflows an int
+        const int v = ((((r0[x] >> 4) * b0) >> 16) + (((r1[x] >> 4) * b1) >> 16) + 2) >> 2;
+        dst[x] = static_cast<uchar>(std::min(std::max(v, 0), 255));
+    }
+}
+
+void ResizePlan::apply_linear(const cv::Mat& src, cv::Mat& dst)
+{
+    const int channels = src.channels();
+    const int width = dst_size_.width * channels;
+    const int rows = dst.rows;
+    const int stripes = stripes_;
+    const int next = src.cols > 1 ? channels : 0;
+
+    typedef void (*HorizontalKernel)(const uchar*, int*, const int*, const short*, int, int);
+    HorizontalKernel kernel_for_cn[] = { linear_horizontal<1>, linear_horizontal<2>,
+                                         linear_horizontal<3>, linear_horizontal<4> };
+    const HorizontalKernel kernel = kernel_for_cn[channels - 1];
+    auto horizontal = [&](int sy, int* out) {
+        kernel(src.ptr<uchar>(sy), out, xofs0_.data(), alpha_.data(), dst_size_.width, next);
+    };
+
+    parallel_for_ref(cv::Range(0, stripes), [&](const cv::Range& range) {
+        for (int stripe = range.start; stripe < range.end; ++stripe) {
+            int* rows_buf[2] = { row_buffers_.data() + static_cast<size_t>(stripe) * 2 * width,
+                                 row_buffers_.data() + (static_cast<size_t>(stripe) * 2 + 1) * width };
+            int cached[2] = { -1, -1 }; // Source row currently held by each buffer
+
+            const int y_begin = static_cast<int>(static_cast<int64_t>(rows) * stripe / stripes);
+            const int y_end = static_cast<int>(static_cast<int64_t>(rows) * (stripe + 1) / stripes);
+            for (int y = y_begin; y < y_end; ++y) {
+                const int sy0 = yofs0_[y];
+                const int sy1 = yofs1_[y];
+                // Consecutive output rows usually share (or advance by one) source row
+                if (cached[0] != sy0 && cached[1] == sy0) {
+                    std::swap(rows_buf[0], rows_buf[1]);
+                    std::swap(cached[0], cached[1]);
+                }
+                if (cached[0] != sy0) {
+                    horizontal(sy0, rows_buf[0]);
+                    cached[0] = sy0;
+                }
+                if (cached[1] != sy1) {
+                    if (sy1 == sy0) {
+                        std::copy(rows_buf[0], rows_buf[0] + width, rows_buf[1]);
+                    } else {
+                        horizontal(sy1, rows_buf[1]);
+                    }
+                    cached[1] = sy1;
+                }
+                linear_vertical(rows_buf[0], rows_buf[1], beta_[2 * y], beta_[2 * y + 1], dst.ptr<uchar>(y), width);
+            }
+        }
+#if CV_SIMD
+        cv::vx_cleanup();
+#endif
+    });
+}
+
+ResizeBenchmark benchmark_resize(const cv::Mat& input_image, cv::Size dsize, int repeats)
+{
+    if (input_image.empty() || dsize.width <= 0 || dsize.height <= 0 || repeats <= 0) {
+        throw std::invalid_argument("Resize benchmark needs a non-empty image, a positive size and repeat count.");
+    }
+
+    const double megapixels = input_image.total() / 1e6;
+    cv::Mat output;
+    ResizeBenchmark result;
+    result.repeats = repeats;
+
+    // Kernel path: plan built once, applied repeatedly (one warm-up run first)
+    ResizePlan plan(input_image.size(), dsize, cv::INTER_LINEAR, input_image.type());
+    plan.apply(input_image, output);
+    int64 start = cv::getTickCount();
+    for (int i = 0; i < repeats; ++i) {
+        plan.apply(input_image, output);
+    }
+    double seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+    result.kernel_mpix_per_sec = seconds > 0 ? megapixels * repeats / seconds : 0.0;
+
+    // Reference path: a fresh cv::resize call per image
+    cv::resize(input_image, output, dsize, 0, 0, cv::INTER_LINEAR);
+    start = cv::getTickCount();
+    for (int i = 0; i < repeats; ++i) {
+        cv::resize(input_image, output, dsize, 0, 0, cv::INTER_LINEAR);
+    }
+    seconds = (cv::getTickCount() - start) / cv::getTickFrequency();
+    result.opencv_mpix_per_sec = seconds > 0 ? megapixels * repeats / seconds : 0.0;
+
+    return result;
+}
+
+size_t resize_image_batch(const std::vector<std::string>& image_paths,
+                          const std::string& output_dir,
+                          double factor,
+                          int interpolation)
+{
+    if (factor <= 0) {
+        throw std::invalid_argument("Resize factor must be positive, received: " + std::to_string(factor));
+    }
+
+    ResizeWorkspace workspace; // Keeps the plan while the resolution and type stay the same
+    cv::Mat image;
+    cv::Mat resized;
+    size_t written = 0;
+    for (const std::string& path : image_paths) {
+        image = cv::imread(path, cv::IMREAD_COLOR); // Same as single-image resize
+        if (image.empty()) {
+            throw std::runtime_error("Failed to load image for resize: " + path);
+        }
+
+        // Same path as single-image resize, including the pyramid for factors below 0.5
+        resize_image(image, resized, workspace, factor, interpolation);
+
+        const size_t slash = path.find_last_of("/\\");
+        const std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+        const std::string out_path = output_dir + "/" + name;
+        if (!cv::imwrite(out_path, resized)) {
+            throw std::runtime_error("Failed to save resized image to: " + out_path);
+        }
+        std::cout << "  Resized: " << path << " -> " << out_path << std::endl;
+        ++written;
+    }
+    return written;
+}
+
+void resize_image(const cv::Mat& input_image,
+                  cv::Mat& output_image,
+                  int target_width,
+                  int target_height,
+                  int interpolation,
+                  ResizeMode mode)
+{
+    ResizeWorkspace workspace;
+    resize_image(input_image, output_image, workspace, target_width, target_height, interpolation, mode);
+}
+
+void resize_image(const cv::Mat& input_image,
+                  cv::Mat& output_image,
+                  ResizeWorkspace& workspace,
+                  int target_width,
+                  int target_height,
+                  int interpolation,
+                  ResizeMode mode)
+{
     if (target_width <= 0 || target_height <= 0) {
         throw std::invalid_argument("Target width and height must be positive.");
     }
     if (input_image.empty()) {
-        throw std::invalid_argument("Input image for resize is empty."); 
+        throw std::invalid_argument("Input image for resize is empty.");
     }
 
-    cv::Mat resized_image;
-    cv::resize(input_image, 
-               resized_image, 
-               cv::Size(target_width, target_height),
-               0, // fx (unused when dsize is specified)
-               0, // fy (unused when dsize is specified)
-               interpolation);
+    if (mode == ResizeMode::Exact) {
+        pyramid_resize(input_image, output_image, cv::Size(target_width, target_height), interpolation, workspace);
+        return;
+    }
 
+    // Fit scales to the largest size inside the box, Fill to the smallest size covering it
+    const double scale_x = static_cast<double>(target_width) / input_image.cols;
+    const double scale_y = static_cast<double>(target_height) / input_image.rows;
+    const double scale = mode == ResizeMode::Fit ? std::min(scale_x, scale_y) : std::max(scale_x, scale_y);
+    cv::Size scaled(std::max(1, static_cast<int>(std::lround(input_image.cols * scale))),
+                    std::max(1, static_cast<int>(std::lround(input_image.rows * scale))));
+    if (mode == ResizeMode::Fit) {
+        scaled.width = std::min(scaled.width, target_width);
+        scaled.height = std::min(scaled.height, target_height);
+        pyramid_resize(input_image, output_image, scaled, interpolation, workspace);
+        return;
+    }
+
+    scaled.width = std::max(scaled.width, target_width);
+    scaled.height = std::max(scaled.height, target_height);
+    cv::Mat& covered = workspace.covered;
+    pyramid_resize(input_image, covered, scaled, interpolation, workspace);
+    // Centre crop; copied so the result does not share the workspace buffer
+    cv::Rect box((covered.cols - target_width) / 2, (covered.rows - target_height) / 2, target_width, target_height);
+    covered(box).copyTo(output_image);
+}
+
+cv::Mat resize_image(const cv::Mat& input_image,
+                     int target_width,
+                     int target_height,
+                     int interpolation,
+                     ResizeMode mode)
+{
+    cv::Mat resized_image;
+    resize_image(input_image, resized_image, target_width, target_height, interpolation, mode);
     return resized_image;
 }
-*/ 
\ No newline at end of file
+
+// --- Streaming resize ---
+
+// Source rows decoded per read while streaming
+static const int kStreamStripRows = 64;
+
+/**
+ * Sparse resampling weights along one axis: destination element d uses the source
+ * indices index[start[d] .. start[d + 1]) with the matching weights.
+ */
+struct AxisTaps {
+    std::vector<int> start;
+    std::vector<int> index;
+    std::vector<float> weight;
+};
+
+static void add_tap(AxisTaps& taps, int index, float weight)
+{
+    // Taps for one destination are appended in increasing source order; merge clamped duplicates
+    if (taps.index.size() > static_cast<size_t>(taps.start.back()) && taps.index.back() == index) {
+        taps.weight.back() += weight;
+        return;
+    }
+    taps.index.push_back(index);
+    taps.weight.push_back(weight);
+}
+
+/**
+ * Builds the taps for one axis. Reductions use area (box coverage) weights so large
+ * downscales average every source pixel; enlargements and INTER_LINEAR use two-tap
+ * linear weights, INTER_NEAREST a single tap.
+ */
+static AxisTaps stream_axis_taps(int src_len, int dst_len, int interpolation)
+{
+    AxisTaps taps;
+    taps.start.reserve(dst_len + 1);
+    const double scale = static_cast<double>(src_len) / dst_len;
+    const bool area = interpolation == cv::INTER_AREA && scale > 1.0;
+    for (int d = 0; d < dst_len; ++d) {
+        taps.start.push_back(static_cast<int>(taps.index.size()));
+        if (interpolation == cv::INTER_NEAREST) {
+            const double nearest_scale = 1.0 / (static_cast<double>(dst_len) / src_len); // As cv::resize
+            add_tap(taps, std::min(static_cast<int>(std::floor(d * nearest_scale)), src_len - 1), 1.0f);
+        } else if (area) {
+            const double begin = d * scale;
+            const double end = std::min((d + 1) * scale, static_cast<double>(src_len));
+            for (int s = static_cast<int>(std::floor(begin)); s < end; ++s) {
+                const double covered = std::min(end, s + 1.0) - std::max(begin, static_cast<double>(s));
+                if (covered > 1e-9) {
+                    add_tap(taps, s, static_cast<float>(covered / (end - begin)));
+                }
+            }
+        } else {
+            double f = (d + 0.5) * scale - 0.5;
+            int s = static_cast<int>(std::floor(f));
+            f -= s;
+            if (s < 0) {
+                s = 0;
+                f = 0;
+            }
+            if (s >= src_len - 1) {
+                s = src_len - 1;
+                f = 0;
+            }
+            add_tap(taps, s, static_cast<float>(1.0 - f));
+            if (f > 0) {
+                add_tap(taps, s + 1, static_cast<float>(f));
+            }
+        }
+    }
+    taps.start.push_back(static_cast<int>(taps.index.size()));
+    return taps;
+}
+
+/**
+ * Resamples a PNM stream into a PNM file. Source rows are decoded in strips; each row
+ * is resampled horizontally once and accumulated into every output row that uses it,
+ * and output rows are written as soon as their last source row has been seen. Memory is
+ * a strip of source rows plus a small ring of output-row accumulators, so it grows with
+ * the image width, not its area.
+ */
+static void stream_resize(PnmReader& reader, const std::string& output_path, cv::Size dsize, int interpolation)
+{
+    const int channels = reader.channels();
+    const int out_width = dsize.width * channels;
+    const AxisTaps columns = stream_axis_taps(reader.width(), dsize.width, interpolation);
+    const AxisTaps rows = stream_axis_taps(reader.height(), dsize.height, interpolation);
+
+    // Invert the row taps: for each source row, the output rows (and weights) it feeds.
+    // Output rows are complete once their last source row has been accumulated.
+    std::vector<std::vector<std::pair<int, float>>> feeds(reader.height());
+    std::vector<int> last_source(dsize.height);
+    for (int dy = 0; dy < dsize.height; ++dy) {
+        for (int t = rows.start[dy]; t < rows.start[dy + 1]; ++t) {
+            feeds[rows.index[t]].emplace_back(dy, rows.weight[t]);
+        }
+        last_source[dy] = rows.index[rows.start[dy + 1] - 1];
+    }
+
+    // Ring size: the most output rows open at once (started but not yet written)
+    int ring = 1;
+    {
+        int next_out = 0;
+        int highest_open = -1;
+        for (int sy = 0; sy < reader.height(); ++sy) {
+            for (const auto& feed : feeds[sy]) {
+                highest_open = std::max(highest_open, feed.first);
+            }
+            ring = std::max(ring, highest_open - next_out + 1);
+            while (next_out < dsize.height && last_source[next_out] <= sy) {
+                ++next_out;
+            }
+        }
+    }
+
+    std::vector<uchar> strip(reader.row_bytes() * kStreamStripRows);
+    std::vector<float> horizontal(out_width);
+    std::vector<float> accumulators(static_cast<size_t>(ring) * out_width, 0.0f);
+    std::vector<uchar> out_row(out_width);
+    PnmWriter writer(output_path, dsize.width, dsize.height, channels);
+
+    int next_out = 0;
+    for (int strip_begin = 0; strip_begin < reader.height(); strip_begin += kStreamStripRows) {
+        const int strip_rows = std::min(kStreamStripRows, reader.height() - strip_begin);
+        reader.read_rows(strip.data(), strip_rows);
+
+        for (int r = 0; r < strip_rows; ++r) {
+            const int sy = strip_begin + r;
+            if (!feeds[sy].empty()) {
+                const uchar* src = strip.data() + reader.row_bytes() * r;
+                for (int dx = 0; dx < dsize.width; ++dx) {
+                    for (int c = 0; c < channels; ++c) {
+                        float sum = 0.0f;
+                        for (int t = columns.start[dx]; t < columns.start[dx + 1]; ++t) {
+                            sum += columns.weight[t] * src[columns.index[t] * channels + c];
+                        }
+                        horizontal[dx * channels + c] = sum;
+                    }
+                }
+                for (const auto& feed : feeds[sy]) {
+                    float* acc = accumulators.data() + static_cast<size_t>(feed.first % ring) * out_width;
+                    for (int x = 0; x < out_width; ++x) {
+                        acc[x] += feed.second * horizontal[x];
+                    }
+                }
+            }
+
+            while (next_out < dsize.height && last_source[next_out] <= sy) {
+                float* acc = accumulators.data() + static_cast<size_t>(next_out % ring) * out_width;
+                for (int x = 0; x < out_width; ++x) {
+                    out_row[x] = cv::saturate_cast<uchar>(acc[x]);
+                    acc[x] = 0.0f;
+                }
+                writer.write_row(out_row.data());
+                ++next_out;
+            }
+        }
+    }
+    writer.close();
+}
+
+void resize_image_streaming(const std::string& input_path,
+                            const std::string& output_path,
+                            double factor,
+                            int interpolation)
+{
+    if (factor <= 0) {
+        throw std::invalid_argument("Resize factor must be positive, received: " + std::to_string(factor));
+    }
+    PnmReader reader(input_path);
+    stream_resize(reader, output_path, scaled_size(cv::Size(reader.width(), reader.height()), factor), interpolation);
+}
+
+void resize_image_streaming(const std::string& input_path,
+                            const std::string& output_path,
+                            int target_width,
+                            int target_height,
+                            int interpolation)
+{
+    if (target_width <= 0 || target_height <= 0) {
+        throw std::invalid_argument("Target width and height must be positive.");
+    }
+    PnmReader reader(input_path);
+    stream_resize(reader, output_path, cv::Size(target_width, target_height), interpolation);
+}
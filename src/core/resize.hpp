@@ -3,10 +3,17 @@
 
 #include <opencv2/core.hpp> // For cv::Mat
 #include <opencv2/imgproc.hpp> // For cv::resize
+#include <memory>
+#include <string>
+#include <vector>
 
 /**
  * @brief Resizes an input image by a given factor.
  *
+ * Factors below 0.5 use the same 2x pyramid fast path as the target-size overload.
+ * Other 8-bit bilinear resizes run on the ResizePlan kernel instead of cv::resize, with
+ * bit-identical output.
+ *
  * @param input_image The source image (cv::Mat).
  * @param factor The scaling factor (e.g., > 1 to enlarge, < 1 to shrink). Must be positive.
  * @param interpolation The interpolation method to use (default: cv::INTER_LINEAR).
@@ -18,7 +25,276 @@ cv::Mat resize_image(const cv::Mat& input_image,
                      double factor,
                      int interpolation = cv::INTER_LINEAR);
 
-// Potential future overload:
-// cv::Mat resize_image(const cv::Mat& input_image, int target_width, int target_height, int interpolation = cv::INTER_LINEAR);
+/**
+ * @brief How a target-size resize treats the aspect ratio of the input.
+ */
+enum class ResizeMode {
+    Exact, ///< Output is exactly target_width x target_height (aspect ratio may change)
+    Fit,   ///< Keep aspect ratio; largest size that fits inside the target box
+    Fill   ///< Keep aspect ratio; cover the target box, then centre-crop to it
+};
+
+/**
+ * @brief Resizes an input image to a target size or box.
+ *
+ * Large reductions (target at most half the input in both dimensions) are done as
+ * successive 2x box reductions followed by a single final interpolation, which is much
+ * cheaper than one interpolation pass over a full-resolution image and avoids aliasing.
+ *
+ * @param input_image The source image (cv::Mat).
+ * @param target_width Target width in pixels. Must be positive.
+ * @param target_height Target height in pixels. Must be positive.
+ * @param interpolation The interpolation method for the final pass (default: cv::INTER_LINEAR).
+ * @param mode Exact size, fit inside the box, or fill and crop the box (default: exact).
+ * @return cv::Mat The resized image.
+ * @throws std::invalid_argument if the target size is not positive or the input is empty.
+ */
+cv::Mat resize_image(const cv::Mat& input_image,
+                     int target_width,
+                     int target_height,
+                     int interpolation = cv::INTER_LINEAR,
+                     ResizeMode mode = ResizeMode::Exact);
+
+/**
+ * @brief Resizes by a factor into a caller-owned destination.
+ *
+ * Same as the factor overload above, but output_image is only (re)allocated when its
+ * size or type differs from the result, so a destination reused across frames costs
+ * no full-size allocation; the ResizePlan and pyramid levels are still built per call
+ * (see the ResizeWorkspace overloads). Resizing cannot run in place; if output_image
+ * aliases input_image it is rebound to a new buffer.
+ *
+ * @throws std::invalid_argument under the same conditions as the returning overload.
+ */
+void resize_image(const cv::Mat& input_image,
+                  cv::Mat& output_image,
+                  double factor,
+                  int interpolation = cv::INTER_LINEAR);
+
+/**
+ * @brief Resizes to a target size or box into a caller-owned destination.
+ *
+ * See the returning target-size overload; output_image is reused as for the factor
+ * overload. Pyramid levels, the ResizePlan of the final pass and the uncropped Fill
+ * intermediate are still allocated per call (see the ResizeWorkspace overloads).
+ *
+ * @throws std::invalid_argument under the same conditions as the returning overload.
+ */
+void resize_image(const cv::Mat& input_image,
+                  cv::Mat& output_image,
+                  int target_width,
+                  int target_height,
+                  int interpolation = cv::INTER_LINEAR,
+                  ResizeMode mode = ResizeMode::Exact);
+
+/**
+ * @brief Computes the output size cv::resize produces for a scale factor.
+ *
+ * @param src_size Size of the source image.
+ * @param factor The scaling factor. Must be positive.
+ * @return cv::Size The rounded destination size (at least 1x1).
+ * @throws std::invalid_argument if factor is not positive.
+ */
+cv::Size scaled_size(cv::Size src_size, double factor);
+
+/**
+ * @brief A resize precomputed for one (source size, destination size, interpolation, type).
+ *
+ * Building the plan computes the per-column source offsets and weights and the
+ * per-row source indices and weights once, and allocates the per-stripe row buffers.
+ * apply() then runs each frame without recomputing tables or allocating memory
+ * (as long as the destination already has the right size and type), which makes it
+ * suitable for video streams and batches of same-resolution images.
+ *
+ * INTER_NEAREST and INTER_LINEAR on 8-bit images with 1-4 channels use the
+ * precomputed tables. Their output is bit-identical to cv::resize: the bilinear tables
+ * and the 11-bit fixed-point rounding of both passes reproduce OpenCV's generic 8-bit
+ * path (builds that route cv::resize through a platform HAL may differ). The bilinear
+ * kernel is specialised on the channel count and its vertical pass uses OpenCV
+ * universal intrinsics (SSE4/AVX2/NEON, depending on the build). Other
+ * interpolations and depths fall back to cv::resize on every call.
+ *
+ * A plan holds mutable scratch buffers, so a single plan must not be applied from
+ * several threads at once; apply() itself is parallel.
+ */
+class ResizePlan {
+public:
+    /**
+     * @brief Builds a plan.
+     *
+     * @param src_size Size of the frames that will be passed to apply().
+     * @param dst_size Size of the resized frames.
+     * @param interpolation OpenCV interpolation flag (e.g., cv::INTER_LINEAR).
+     * @param type OpenCV type of the frames (e.g., CV_8UC3).
+     * @throws std::invalid_argument if either size is empty.
+     */
+    ResizePlan(cv::Size src_size, cv::Size dst_size, int interpolation, int type);
+
+    /**
+     * @brief Resizes one frame with the precomputed tables.
+     *
+     * @param src Source frame; must match the plan's source size and type.
+     * @param dst Destination; (re)allocated only if its size or type differ from the plan's.
+     * @throws std::invalid_argument if src does not match the plan.
+     */
+    void apply(const cv::Mat& src, cv::Mat& dst);
+
+    /**
+     * @brief Returns true if the plan was built for frames of this size and type.
+     */
+    bool matches(cv::Size src_size, int type) const;
+
+    cv::Size src_size() const { return src_size_; }
+    cv::Size dst_size() const { return dst_size_; }
+    int interpolation() const { return interpolation_; }
+    int type() const { return type_; }
+
+private:
+    void apply_nearest(const cv::Mat& src, cv::Mat& dst) const;
+    void apply_linear(const cv::Mat& src, cv::Mat& dst);
+
+    cv::Size src_size_;
+    cv::Size dst_size_;
+    int interpolation_;
+    int type_;
+    bool use_tables_;
+
+    // Column tables: per destination element for nearest, per destination column for linear
+    std::vector<int> xofs0_;     // Element offset of the left (or only) tap
+    std::vector<short> alpha_;   // Fixed-point weight pairs for the two taps (linear only)
+
+    // Row tables, one entry per destination row
+    std::vector<int> yofs0_;
+    std::vector<int> yofs1_;
+    std::vector<short> beta_;    // Fixed-point weight pairs for the two rows (linear only)
+
+    // Horizontally-resized row buffers: two per stripe (linear only)
+    int stripes_;
+    std::vector<int> row_buffers_;
+};
+
+/**
+ * @brief Caller-owned state for repeated resizes of same-sized frames.
+ *
+ * Keeps the ResizePlan of the final interpolation pass, the 2x pyramid levels and the
+ * uncropped Fill intermediate between calls. The plan is rebuilt only when the size,
+ * type or interpolation of the pass changes, and buffers are reused while their sizes
+ * stay the same. A per-frame loop that passes the same workspace and destination
+ * therefore allocates no tables or image buffers after its first frame. For 8-bit
+ * bilinear passes (factors of at least 0.5, or a single-pass target size) the steady
+ * state does not touch the heap at all, apart from the job record OpenCV's thread
+ * pool allocates per dispatch when more than one thread is used
+ * (tests/test_allocations.cpp checks this). The pyramid halvings and the fallback
+ * for other depths and interpolations run inside cv::resize, which manages its own
+ * scratch memory. A workspace must not be used by two calls at the same time.
+ */
+struct ResizeWorkspace {
+    std::unique_ptr<ResizePlan> plan; // Final pass of 8-bit bilinear resizes
+    std::vector<cv::Mat> levels;      // 2x pyramid levels
+    cv::Mat covered;                  // Fill mode: result before the centre crop
+};
+
+/**
+ * @brief Resizes by a factor with caller-owned destination and state.
+ *
+ * Same as the factor out-parameter overload, with the plan and intermediate levels
+ * kept in workspace between calls.
+ *
+ * @throws std::invalid_argument under the same conditions as the returning overload.
+ */
+void resize_image(const cv::Mat& input_image,
+                  cv::Mat& output_image,
+                  ResizeWorkspace& workspace,
+                  double factor,
+                  int interpolation = cv::INTER_LINEAR);
+
+/**
+ * @brief Resizes to a target size or box with caller-owned destination and state.
+ *
+ * @throws std::invalid_argument under the same conditions as the returning overload.
+ */
+void resize_image(const cv::Mat& input_image,
+                  cv::Mat& output_image,
+                  ResizeWorkspace& workspace,
+                  int target_width,
+                  int target_height,
+                  int interpolation = cv::INTER_LINEAR,
+                  ResizeMode mode = ResizeMode::Exact);
+
+/**
+ * @brief Throughput of the fixed-point bilinear kernel versus cv::resize.
+ */
+struct ResizeBenchmark {
+    double kernel_mpix_per_sec = 0.0; ///< Source megapixels per second through a reused ResizePlan
+    double opencv_mpix_per_sec = 0.0; ///< Source megapixels per second through cv::resize
+    int repeats = 0;                  ///< Timed runs per path (after one warm-up run each)
+};
+
+/**
+ * @brief Times bilinear resizing of one image with ResizePlan and with cv::resize.
+ *
+ * @param input_image The source image; 8-bit images exercise the fixed-point kernel.
+ * @param dsize Destination size.
+ * @param repeats Number of timed runs per path. Must be positive.
+ * @return ResizeBenchmark Throughput of both paths in source megapixels per second.
+ * @throws std::invalid_argument if the image is empty or the size/repeat count is not positive.
+ */
+ResizeBenchmark benchmark_resize(const cv::Mat& input_image, cv::Size dsize, int repeats);
+
+/**
+ * @brief Resizes a batch of image files by a common factor and writes them to a directory.
+ *
+ * Images are processed in order through one ResizeWorkspace, so each image is resized
+ * exactly as a single-image resize would (including the 2x pyramid for factors below
+ * 0.5), and a batch of same-resolution images builds its ResizePlan only once. Each
+ * output keeps the file name of its input. Images are read as 8-bit BGR, like a
+ * single-image resize.
+ *
+ * @param image_paths Paths of the images to resize.
+ * @param output_dir Existing directory the resized images are written to.
+ * @param factor The scaling factor. Must be positive.
+ * @param interpolation The interpolation method to use (default: cv::INTER_LINEAR).
+ * @return size_t The number of images written.
+ * @throws std::invalid_argument if factor is not positive.
+ * @throws std::runtime_error if an image cannot be loaded or saved.
+ */
+size_t resize_image_batch(const std::vector<std::string>& image_paths,
+                          const std::string& output_dir,
+                          double factor,
+                          int interpolation = cv::INTER_LINEAR);
+
+/**
+ * @brief Resizes an image file that may not fit in memory, streaming it strip by strip.
+ *
+ * The input is decoded in horizontal strips, each source row is resampled once and
+ * accumulated into the output rows it contributes to, and finished output rows are
+ * written straight to disk. Peak memory depends on the image width, not its area.
+ * Input and output are binary 8-bit PGM/PPM files, which can be read and written
+ * row by row.
+ *
+ * @param input_path Path to the source PGM/PPM file.
+ * @param output_path Path of the PGM/PPM file to write (same channel count as the input).
+ * @param factor The scaling factor. Must be positive.
+ * @param interpolation cv::INTER_AREA (box averaging for reductions, linear for
+ *                      enlargements), cv::INTER_LINEAR or cv::INTER_NEAREST.
+ * @throws std::invalid_argument if factor is not positive.
+ * @throws std::runtime_error if the input is not a readable 8-bit PNM file or the output cannot be written.
+ */
+void resize_image_streaming(const std::string& input_path,
+                            const std::string& output_path,
+                            double factor,
+                            int interpolation = cv::INTER_AREA);
+
+/**
+ * @brief Streaming resize to an exact target size. See the factor overload for details.
+ *
+ * @throws std::invalid_argument if the target size is not positive.
+ * @throws std::runtime_error if the input is not a readable 8-bit PNM file or the output cannot be written.
+ */
+void resize_image_streaming(const std::string& input_path,
+                            const std::string& output_path,
+                            int target_width,
+                            int target_height,
+                            int interpolation = cv::INTER_AREA);
 
-#endif // AI_SLOP_RESIZE_HPP 
\ No newline at end of file
+#endif // AI_SLOP_RESIZE_HPP
@@ -0,0 +1,751 @@
+#include "stitch_pipeline.hpp"
+#include "feature_cache.hpp"
+#include <opencv2/imgcodecs.hpp> // For cv::imread, cv::imdecode
+#include <opencv2/imgproc.hpp>   // For cv::resize, cv::dilate
+#include <opencv2/calib3d.hpp>   // For cv::findHomography
+#include <opencv2/flann.hpp>     // For cv::flann::Index
+#include <opencv2/stitching/detail/motion_estimators.hpp>
+#include <opencv2/stitching/detail/exposure_compensate.hpp>
+#include <opencv2/stitching/detail/seam_finders.hpp>
+#include <opencv2/stitching/detail/blenders.hpp>
+#include <opencv2/stitching/warpers.hpp>
+#include <algorithm> // For std::sort, std::min
+#include <cmath>     // For std::sqrt, std::abs, std::isnan
+#include <fstream>   // For reading encoded images
+#include <iostream>  // For status messages
+#include <limits>    // For std::numeric_limits
+#include <memory>    // For std::unique_ptr
+#include <set>       // For the matched keypoint pairs
+#include <stdexcept> // For std::runtime_error
+#include <unordered_map>
+
+/**
+ * @brief Scale that brings an image of the given size down to the given number of megapixels.
+ */
+static double scale_for_megapix(const cv::Size& size, double megapix) {
+    if (megapix < 0) {
+        return 1.0; // Original resolution
+    }
+    return std::min(1.0, std::sqrt(megapix * 1e6 / size.area()));
+}
+
+/**
+ * @brief Adds the seconds elapsed since start to a stage timer, if there is one.
+ */
+static void add_stage_time(double* stage_seconds, int64 start) {
+    if (stage_seconds) {
+        *stage_seconds += (cv::getTickCount() - start) / cv::getTickFrequency();
+    }
+}
+
+StitchScales stitch_scales(const cv::Size& image_size, const StitchOptions& options) {
+    StitchScales scales;
+    scales.work = scale_for_megapix(image_size, options.registration_resol);
+    scales.seam = scale_for_megapix(image_size, options.seam_estimation_resol);
+    scales.compose = scale_for_megapix(image_size, options.compositing_resol);
+    if (std::abs(scales.compose - 1.0) <= 1e-1) {
+        scales.compose = 1.0; // Not worth a resize
+    }
+    return scales;
+}
+
+cv::Size stitch_scaled_size(const cv::Size& size, double scale) {
+    return cv::Size(cvRound(size.width * scale), cvRound(size.height * scale));
+}
+
+cv::Mat decode_stitch_image(const std::string& path, uint64_t* content_hash) {
+    if (!content_hash) {
+        return cv::imread(path, cv::IMREAD_COLOR);
+    }
+    // Read the file once: the same bytes are hashed and decoded
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) {
+        return cv::Mat();
+    }
+    std::vector<uchar> bytes(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!in || bytes.empty()) {
+        return cv::Mat();
+    }
+    *content_hash = fnv1a_hash(bytes.data(), bytes.size());
+    return cv::imdecode(bytes, cv::IMREAD_COLOR);
+}
+
+std::string stitch_feature_settings(const StitchScales& scales) {
+    // Covers everything besides the image that changes the features
+    return "ORB:" + std::to_string(kStitchOrbFeatures) + ":work_scale=" + std::to_string(scales.work);
+}
+
+void compute_stitch_features(const cv::Ptr<cv::Feature2D>& finder, const cv::Mat& image, double work_scale,
+                             cv::detail::ImageFeatures& features) {
+    cv::Mat work = image;
+    if (work_scale < 1.0) {
+        cv::resize(image, work, cv::Size(), work_scale, work_scale, cv::INTER_LINEAR_EXACT);
+    }
+    const int img_idx = features.img_idx;
+    cv::detail::computeImageFeatures(finder, work, features);
+    features.img_idx = img_idx;
+}
+
+void load_stitch_images(const std::vector<std::string>& image_paths,
+                        const StitchOptions& options,
+                        std::vector<cv::Mat>& full_images,
+                        std::vector<cv::Mat>& seam_images,
+                        std::vector<cv::detail::ImageFeatures>& features,
+                        StitchScales& scales,
+                        std::vector<uint64_t>& content_hashes,
+                        std::vector<cv::Size>* image_sizes) {
+    const int count = static_cast<int>(image_paths.size());
+    full_images.assign(count, cv::Mat());
+    seam_images.assign(count, cv::Mat());
+    features.assign(count, cv::detail::ImageFeatures());
+
+    const bool use_cache = !options.feature_cache_dir.empty();
+    content_hashes.assign(count, 0);
+    if (image_sizes) {
+        image_sizes->assign(count, cv::Size());
+    }
+    full_images[0] = decode_stitch_image(image_paths[0], use_cache ? &content_hashes[0] : nullptr);
+    if (full_images[0].empty()) {
+        throw std::runtime_error("Failed to load image for stitching: " + image_paths[0]);
+    }
+    scales = stitch_scales(full_images[0].size(), options);
+
+    std::unique_ptr<FeatureCache> cache;
+    if (use_cache) {
+        cache.reset(new FeatureCache(options.feature_cache_dir, stitch_feature_settings(scales)));
+    }
+
+    std::vector<char> failed(count, 0); // Exceptions are not thrown across the thread pool
+    std::vector<char> cached(count, 0);
+    std::vector<std::string> cache_errors(count);
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+        cv::Ptr<cv::Feature2D> finder = cv::ORB::create(kStitchOrbFeatures); // One detector per task
+        for (int i = range.start; i < range.end; ++i) {
+            if (i > 0) {
+                full_images[i] = decode_stitch_image(image_paths[i], use_cache ? &content_hashes[i] : nullptr);
+                if (full_images[i].empty()) {
+                    failed[i] = 1;
+                    continue;
+                }
+            }
+            const cv::Mat& full = full_images[i];
+
+            features[i].img_idx = i;
+            if (cache && cache->load(content_hashes[i], features[i])) {
+                cached[i] = 1;
+            } else {
+                compute_stitch_features(finder, full, scales.work, features[i]);
+                if (cache) {
+                    try {
+                        cache->store(content_hashes[i], features[i]);
+                    } catch (const std::exception& e) {
+                        cache_errors[i] = e.what(); // Caching is best effort
+                    }
+                }
+            }
+
+            cv::resize(full, seam_images[i], cv::Size(), scales.seam, scales.seam, cv::INTER_LINEAR_EXACT);
+            if (image_sizes) {
+                (*image_sizes)[i] = full.size();
+                full_images[i].release();
+            }
+        }
+    }, count);
+
+    int reused = 0;
+    for (int i = 0; i < count; ++i) {
+        if (failed[i]) {
+            throw std::runtime_error("Failed to load image for stitching: " + image_paths[i]);
+        }
+        if (!cache_errors[i].empty()) {
+            std::cerr << "Warning: " << cache_errors[i] << std::endl;
+        }
+        reused += cached[i];
+        std::cout << "  Loaded: " << image_paths[i] << " (" << features[i].keypoints.size() << " features"
+                  << (cached[i] ? ", cached" : "") << ")" << std::endl;
+    }
+    if (cache) {
+        std::cout << "Feature cache: " << reused << " of " << count << " images reused." << std::endl;
+    }
+}
+
+/**
+ * @brief Best-of-2-nearest matcher that builds one FLANN index per image, once.
+ *
+ * cv::detail::BestOf2NearestMatcher trains a new FLANN index on one image of every pair
+ * it matches, so an image's index is rebuilt once per pair. Here the index of every
+ * image is built up front (LSH for binary descriptors such as ORB, kd-trees for float
+ * descriptors) and shared by all pairs. Ratio test, homography estimation and pair
+ * confidence follow BestOf2NearestMatcher, so the results are interchangeable.
+ */
+class IndexedFeaturesMatcher : public cv::detail::FeaturesMatcher {
+public:
+    IndexedFeaturesMatcher() : cv::detail::FeaturesMatcher(true) {} // Searching a built index is thread-safe
+
+    void collectGarbage() override {
+        indices_.clear();
+        descriptors_.clear();
+        slots_.clear();
+    }
+
+protected:
+    void match(const std::vector<cv::detail::ImageFeatures>& features,
+               std::vector<cv::detail::MatchesInfo>& pairwise_matches,
+               const cv::UMat& mask) override {
+        collectGarbage();
+        indices_.resize(features.size());
+        descriptors_.resize(features.size());
+        for (size_t i = 0; i < features.size(); ++i) {
+            slots_[features[i].img_idx] = i;
+        }
+        cv::parallel_for_(cv::Range(0, static_cast<int>(features.size())), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; ++i) {
+                // The index keeps pointers into the descriptors, so they are owned here
+                descriptors_[i] = features[i].descriptors.getMat(cv::ACCESS_READ).clone();
+                if (descriptors_[i].rows < 2) {
+                    continue; // Nothing to match against
+                }
+                if (descriptors_[i].depth() == CV_8U) {
+                    indices_[i] = cv::makePtr<cv::flann::Index>(descriptors_[i], cv::flann::LshIndexParams(12, 20, 2),
+                                                                cvflann::FLANN_DIST_HAMMING);
+                } else {
+                    indices_[i] = cv::makePtr<cv::flann::Index>(descriptors_[i], cv::flann::KDTreeIndexParams(4),
+                                                                cvflann::FLANN_DIST_L2);
+                }
+            }
+        });
+        cv::detail::FeaturesMatcher::match(features, pairwise_matches, mask);
+    }
+
+    void match(const cv::detail::ImageFeatures& features1, const cv::detail::ImageFeatures& features2,
+               cv::detail::MatchesInfo& matches_info) override {
+        matches_info.matches.clear();
+        const size_t slot1 = slots_.at(features1.img_idx);
+        const size_t slot2 = slots_.at(features2.img_idx);
+        if (!indices_[slot1] || !indices_[slot2]) {
+            return;
+        }
+
+        // 1->2 matches, then the 2->1 matches not found already
+        std::set<std::pair<int, int>> found;
+        ratio_test(*indices_[slot2], descriptors_[slot1], [&](int query, int train, float distance) {
+            matches_info.matches.push_back(cv::DMatch(query, train, distance));
+            found.insert(std::make_pair(query, train));
+        });
+        ratio_test(*indices_[slot1], descriptors_[slot2], [&](int query, int train, float distance) {
+            if (found.find(std::make_pair(train, query)) == found.end()) {
+                matches_info.matches.push_back(cv::DMatch(train, query, distance));
+            }
+        });
+        if (matches_info.matches.size() < static_cast<size_t>(kMinMatches)) {
+            return;
+        }
+
+        cv::Mat src_points;
+        cv::Mat dst_points;
+        centred_points(features1, features2, matches_info.matches, std::vector<uchar>(), src_points, dst_points);
+        matches_info.H = cv::findHomography(src_points, dst_points, matches_info.inliers_mask, cv::RANSAC);
+        if (matches_info.H.empty() || std::abs(cv::determinant(matches_info.H)) < std::numeric_limits<double>::epsilon()) {
+            return;
+        }
+        matches_info.num_inliers = 0;
+        for (uchar inlier : matches_info.inliers_mask) {
+            matches_info.num_inliers += inlier ? 1 : 0;
+        }
+        // Confidence as in Brown and Lowe, "Automatic Panoramic Image Stitching using Invariant
+        // Features"; near-identical images are given none, as cv::detail does
+        matches_info.confidence = matches_info.num_inliers / (8 + 0.3 * matches_info.matches.size());
+        matches_info.confidence = matches_info.confidence > 3. ? 0. : matches_info.confidence;
+        if (matches_info.num_inliers < kMinMatches) {
+            return;
+        }
+        // Refine the homography on the inliers only
+        centred_points(features1, features2, matches_info.matches, matches_info.inliers_mask, src_points, dst_points);
+        matches_info.H = cv::findHomography(src_points, dst_points, cv::RANSAC);
+    }
+
+private:
+    static constexpr int kMinMatches = 6; // BestOf2NearestMatcher's num_matches_thresh1/2
+
+    template <typename Accept>
+    static void ratio_test(cv::flann::Index& index, const cv::Mat& query, Accept accept) {
+        cv::Mat nearest;
+        cv::Mat distances;
+        index.knnSearch(query, nearest, distances, 2, cv::flann::SearchParams());
+        distances.convertTo(distances, CV_32F); // Hamming distances come back as integers
+        if (query.depth() != CV_8U) {
+            cv::sqrt(distances, distances); // FLANN_DIST_L2 is the squared distance
+        }
+        for (int i = 0; i < nearest.rows; ++i) {
+            const int best = nearest.at<int>(i, 0);
+            if (best < 0 || nearest.at<int>(i, 1) < 0) {
+                continue; // Fewer than two neighbours found
+            }
+            if (distances.at<float>(i, 0) < (1.f - kStitchMatchConfidence) * distances.at<float>(i, 1)) {
+                accept(i, best, distances.at<float>(i, 0));
+            }
+        }
+    }
+
+    static void centred_points(const cv::detail::ImageFeatures& features1, const cv::detail::ImageFeatures& features2,
+                               const std::vector<cv::DMatch>& matches, const std::vector<uchar>& inliers,
+                               cv::Mat& src_points, cv::Mat& dst_points) {
+        std::vector<cv::Point2f> src;
+        std::vector<cv::Point2f> dst;
+        const cv::Point2f centre1(features1.img_size.width * 0.5f, features1.img_size.height * 0.5f);
+        const cv::Point2f centre2(features2.img_size.width * 0.5f, features2.img_size.height * 0.5f);
+        for (size_t i = 0; i < matches.size(); ++i) {
+            if (!inliers.empty() && !inliers[i]) {
+                continue;
+            }
+            src.push_back(features1.keypoints[matches[i].queryIdx].pt - centre1);
+            dst.push_back(features2.keypoints[matches[i].trainIdx].pt - centre2);
+        }
+        cv::Mat(src).reshape(2, 1).copyTo(src_points);
+        cv::Mat(dst).reshape(2, 1).copyTo(dst_points);
+    }
+
+    std::vector<cv::Ptr<cv::flann::Index>> indices_; // By slot; empty for images without features
+    std::vector<cv::Mat> descriptors_;
+    std::unordered_map<int, size_t> slots_;          // img_idx -> slot
+};
+
+cv::Ptr<cv::detail::FeaturesMatcher> create_stitch_matcher(const StitchOptions& options) {
+    if (options.indexed_matching) {
+        return cv::makePtr<IndexedFeaturesMatcher>();
+    }
+    return cv::makePtr<cv::detail::BestOf2NearestMatcher>(false, kStitchMatchConfidence);
+}
+
+/**
+ * @brief Great-circle distance in metres between two (latitude, longitude) positions in degrees.
+ */
+static double gps_distance_m(const cv::Point2d& a, const cv::Point2d& b) {
+    constexpr double kEarthRadiusM = 6371000.0;
+    const double to_radians = CV_PI / 180.0;
+    const double sin_lat = std::sin((b.x - a.x) * to_radians * 0.5);
+    const double sin_lon = std::sin((b.y - a.y) * to_radians * 0.5);
+    const double h = sin_lat * sin_lat
+                     + std::cos(a.x * to_radians) * std::cos(b.x * to_radians) * sin_lon * sin_lon;
+    return 2.0 * kEarthRadiusM * std::asin(std::min(1.0, std::sqrt(h)));
+}
+
+cv::Mat stitch_match_mask(size_t count, const StitchOptions& options) {
+    const bool use_gps = !options.gps_positions.empty() && options.gps_radius_m > 0;
+    if (options.match_range <= 0 && !use_gps) {
+        return cv::Mat(); // All pairs
+    }
+    auto position = [&](size_t i) {
+        return i < options.gps_positions.size()
+                   ? options.gps_positions[i]
+                   : cv::Point2d(std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN());
+    };
+    auto located = [](const cv::Point2d& p) { return !std::isnan(p.x) && !std::isnan(p.y); };
+
+    cv::Mat mask = cv::Mat::zeros(static_cast<int>(count), static_cast<int>(count), CV_8U);
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = i + 1; j < count; ++j) {
+            bool match = options.match_range > 0 && j - i <= static_cast<size_t>(options.match_range);
+            if (!match && use_gps) {
+                const cv::Point2d a = position(i);
+                const cv::Point2d b = position(j);
+                if (located(a) && located(b)) {
+                    match = gps_distance_m(a, b) <= options.gps_radius_m;
+                } else {
+                    match = options.match_range <= 0; // Unknown positions: only the range limits them
+                }
+            }
+            mask.at<uchar>(static_cast<int>(i), static_cast<int>(j)) = match ? 1 : 0;
+        }
+    }
+    return mask;
+}
+
+cv::Stitcher::Status register_stitch_images(std::vector<cv::detail::ImageFeatures>& features,
+                                            const StitchOptions& options,
+                                            std::vector<cv::detail::MatchesInfo>& pairwise_matches,
+                                            std::vector<cv::detail::CameraParams>& cameras,
+                                            double& warped_image_scale,
+                                            std::vector<int>& indices,
+                                            StitchTimings* timings) {
+    int64 start = cv::getTickCount();
+    cv::Ptr<cv::detail::FeaturesMatcher> matcher = create_stitch_matcher(options);
+    const cv::Mat mask = stitch_match_mask(features.size(), options);
+    (*matcher)(features, pairwise_matches, mask.empty() ? cv::UMat() : mask.getUMat(cv::ACCESS_READ));
+    matcher->collectGarbage();
+    add_stage_time(timings ? &timings->matching : nullptr, start);
+
+    start = cv::getTickCount();
+    indices = cv::detail::leaveBiggestComponent(features, pairwise_matches, static_cast<float>(kStitchPanoConfidence));
+    if (indices.size() < 2) {
+        return cv::Stitcher::ERR_NEED_MORE_IMGS;
+    }
+
+    cv::detail::HomographyBasedEstimator estimator;
+    if (!estimator(features, pairwise_matches, cameras)) {
+        return cv::Stitcher::ERR_HOMOGRAPHY_EST_FAIL;
+    }
+    for (auto& camera : cameras) {
+        cv::Mat R;
+        camera.R.convertTo(R, CV_32F);
+        camera.R = R;
+    }
+
+    cv::detail::BundleAdjusterRay adjuster;
+    adjuster.setConfThresh(kStitchPanoConfidence);
+    adjuster.setRefinementMask(cv::Mat::ones(3, 3, CV_8U));
+    if (!adjuster(features, pairwise_matches, cameras)) {
+        return cv::Stitcher::ERR_CAMERA_PARAMS_ADJUST_FAIL;
+    }
+
+    std::vector<double> focals;
+    for (const auto& camera : cameras) {
+        focals.push_back(camera.focal);
+    }
+    std::sort(focals.begin(), focals.end());
+    warped_image_scale = focals.size() % 2 == 1
+                             ? focals[focals.size() / 2]
+                             : (focals[focals.size() / 2 - 1] + focals[focals.size() / 2]) * 0.5;
+
+    std::vector<cv::Mat> rotations;
+    for (const auto& camera : cameras) {
+        rotations.push_back(camera.R.clone());
+    }
+    cv::detail::waveCorrect(rotations, cv::detail::WAVE_CORRECT_HORIZ);
+    for (size_t i = 0; i < cameras.size(); ++i) {
+        cameras[i].R = rotations[i];
+    }
+    add_stage_time(timings ? &timings->estimation : nullptr, start);
+    return cv::Stitcher::OK;
+}
+
+cv::Mat stitch_scaled_intrinsics(const cv::detail::CameraParams& camera, double scale) {
+    cv::Mat K;
+    camera.K().convertTo(K, CV_32F);
+    K.at<float>(0, 0) *= static_cast<float>(scale);
+    K.at<float>(0, 2) *= static_cast<float>(scale);
+    K.at<float>(1, 1) *= static_cast<float>(scale);
+    K.at<float>(1, 2) *= static_cast<float>(scale);
+    return K;
+}
+
+cv::Rect stitch_compose_roi(const cv::Size& image_size, const cv::detail::CameraParams& camera,
+                            double warped_image_scale, const StitchScales& scales) {
+    const double compose_work_aspect = scales.compose / scales.work;
+    cv::SphericalWarper warper_creator;
+    cv::Ptr<cv::detail::RotationWarper> warper =
+        warper_creator.create(static_cast<float>(warped_image_scale * compose_work_aspect));
+    return warper->warpRoi(stitch_scaled_size(image_size, scales.compose),
+                           stitch_scaled_intrinsics(camera, compose_work_aspect), camera.R);
+}
+
+cv::Ptr<cv::detail::ExposureCompensator> create_stitch_compensator(const StitchOptions& options) {
+    switch (options.exposure) {
+        case StitchExposure::None:
+            return cv::makePtr<cv::detail::NoExposureCompensator>();
+        case StitchExposure::Gain:
+            return cv::makePtr<cv::detail::GainCompensator>();
+        case StitchExposure::Blocks:
+            return cv::makePtr<cv::detail::BlocksGainCompensator>();
+        case StitchExposure::Channels:
+            return cv::makePtr<cv::detail::ChannelsCompensator>();
+    }
+    throw std::invalid_argument("Unknown exposure compensator.");
+}
+
+cv::Ptr<cv::detail::SeamFinder> create_stitch_seam_finder(const StitchOptions& options) {
+    switch (options.seam_finder) {
+        case StitchSeamFinder::None:
+            return cv::makePtr<cv::detail::NoSeamFinder>();
+        case StitchSeamFinder::Voronoi:
+            return cv::makePtr<cv::detail::VoronoiSeamFinder>();
+        case StitchSeamFinder::Dp:
+            return cv::makePtr<cv::detail::DpSeamFinder>(cv::detail::DpSeamFinder::COLOR);
+        case StitchSeamFinder::GraphCut:
+            return cv::makePtr<cv::detail::GraphCutSeamFinder>(cv::detail::GraphCutSeamFinderBase::COST_COLOR);
+    }
+    throw std::invalid_argument("Unknown seam finder.");
+}
+
+cv::Ptr<cv::detail::Blender> create_stitch_blender(const StitchOptions& options) {
+    if (options.blender == StitchBlender::Feather) {
+        return cv::makePtr<cv::detail::FeatherBlender>();
+    }
+    if (options.blend_bands < 1) {
+        throw std::invalid_argument("Multi-band blending needs at least one band.");
+    }
+    return cv::makePtr<cv::detail::MultiBandBlender>(false, options.blend_bands);
+}
+
+int stitch_blend_margin(const StitchOptions& options) {
+    // Feather weights saturate 50 pixels from a mask edge (sharpness 0.02). The multi-band
+    // blender pads each fed image by 3 << bands pixels, and its 5x5 kernels reach about
+    // 2 << bands further while building the pyramids and as much again collapsing them
+    const int bands = options.blender == StitchBlender::MultiBand ? options.blend_bands : 0;
+    return std::max(64, 7 << std::min(bands, 12));
+}
+
+cv::Rect stitch_blend_context(const cv::Rect& region, const cv::Rect& canvas, const StitchOptions& options) {
+    const int margin = stitch_blend_margin(options);
+    // MultiBandBlender builds its pyramids from the top-left corner of the prepared
+    // rectangle, so that corner is snapped down to the canvas's 2^bands grid
+    const int grid = options.blender == StitchBlender::MultiBand ? 1 << std::min(options.blend_bands, 12) : 1;
+    const int left = std::max(0, region.x - margin - canvas.x) / grid * grid;
+    const int top = std::max(0, region.y - margin - canvas.y) / grid * grid;
+    const cv::Point br(std::min(canvas.br().x, region.br().x + margin), std::min(canvas.br().y, region.br().y + margin));
+    return cv::Rect(canvas.tl() + cv::Point(left, top), br);
+}
+
+StitchSeams find_stitch_seams(const std::vector<cv::Mat>& seam_images,
+                              const std::vector<cv::detail::CameraParams>& cameras,
+                              double warped_image_scale,
+                              const StitchScales& scales,
+                              const StitchOptions& options,
+                              StitchTimings* timings) {
+    int64 start = cv::getTickCount();
+    const int count = static_cast<int>(seam_images.size());
+    const double seam_work_aspect = scales.seam / scales.work;
+    std::vector<cv::Point> corners(count);
+    std::vector<cv::UMat> images_warped(count);
+    StitchSeams seams;
+    seams.masks.resize(count);
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+        cv::SphericalWarper warper_creator; // One warper per task
+        cv::Ptr<cv::detail::RotationWarper> warper =
+            warper_creator.create(static_cast<float>(warped_image_scale * seam_work_aspect));
+        for (int i = range.start; i < range.end; ++i) {
+            const cv::Mat K = stitch_scaled_intrinsics(cameras[i], seam_work_aspect);
+            corners[i] = warper->warp(seam_images[i], K, cameras[i].R, cv::INTER_LINEAR, cv::BORDER_REFLECT,
+                                      images_warped[i]);
+            cv::Mat mask(seam_images[i].size(), CV_8U, cv::Scalar::all(255));
+            warper->warp(mask, K, cameras[i].R, cv::INTER_NEAREST, cv::BORDER_CONSTANT, seams.masks[i]);
+        }
+    });
+
+    seams.compensator = create_stitch_compensator(options);
+    seams.compensator->feed(corners, images_warped, seams.masks);
+    add_stage_time(timings ? &timings->exposure : nullptr, start);
+
+    start = cv::getTickCount();
+    std::vector<cv::UMat> images_warped_f(count);
+    for (int i = 0; i < count; ++i) {
+        images_warped[i].convertTo(images_warped_f[i], CV_32F);
+    }
+    create_stitch_seam_finder(options)->find(images_warped_f, corners, seams.masks);
+    add_stage_time(timings ? &timings->seams : nullptr, start);
+    return seams;
+}
+
+std::vector<cv::Mat> stitch_exposure_gains(const StitchSeams& seams, const StitchOptions& options, size_t count) {
+    std::vector<cv::Mat> gains(count);
+    if (options.exposure == StitchExposure::None) {
+        return gains;
+    }
+    std::vector<cv::Mat> compensator_gains;
+    seams.compensator->getMatGains(compensator_gains);
+    for (size_t i = 0; i < count && i < compensator_gains.size(); ++i) {
+        cv::Mat column;
+        compensator_gains[i].convertTo(column, CV_32F);
+        if (options.exposure == StitchExposure::Channels) {
+            // cv::Mat(cv::Scalar): B, G, R and an unused fourth gain
+            gains[i] = cv::Mat(1, 1, CV_32FC3,
+                               cv::Scalar(column.at<float>(0), column.at<float>(1), column.at<float>(2)));
+        } else {
+            gains[i] = column;
+        }
+    }
+    return gains;
+}
+
+/**
+ * @brief Returns a window of cv::resize(src, full_size, INTER_LINEAR) for a CV_32F map,
+ *        without computing the rest of it.
+ *
+ * Follows cv::resize's coordinate mapping and edge handling (columns clamp to the edge
+ * sample, rows clamp but keep their weights), so a window matches the full resize except
+ * where OpenCV's vectorised rows round the last bit differently.
+ */
+static cv::Mat linear_window_32f(const cv::Mat& src, const cv::Size& full_size, const cv::Rect& window) {
+    CV_Assert(src.type() == CV_32FC1 || src.type() == CV_32FC3);
+    const int cn = src.channels();
+    const double scale_x = 1.0 / (static_cast<double>(full_size.width) / src.cols);
+    const double scale_y = 1.0 / (static_cast<double>(full_size.height) / src.rows);
+
+    std::vector<int> xofs(window.width);
+    std::vector<float> alpha(window.width);
+    std::vector<char> edge(window.width);
+    for (int x = 0; x < window.width; ++x) {
+        float fx = static_cast<float>((window.x + x + 0.5) * scale_x - 0.5);
+        int sx = cvFloor(fx);
+        fx -= static_cast<float>(sx);
+        if (sx < 0) {
+            fx = 0.0f;
+            sx = 0;
+        }
+        edge[x] = sx + 1 >= src.cols;
+        xofs[x] = edge[x] ? src.cols - 1 : sx;
+        alpha[x] = fx;
+    }
+
+    cv::Mat dst(window.size(), src.type());
+    std::vector<float> row0(window.width * cn);
+    std::vector<float> row1(window.width * cn);
+    auto horizontal = [&](int sy, std::vector<float>& out) {
+        const float* s = src.ptr<float>(sy);
+        for (int x = 0; x < window.width; ++x) {
+            const int j = xofs[x] * cn;
+            for (int c = 0; c < cn; ++c) {
+                out[x * cn + c] = edge[x] ? s[j + c] : s[j + c] * (1.0f - alpha[x]) + s[j + cn + c] * alpha[x];
+            }
+        }
+    };
+    for (int y = 0; y < window.height; ++y) {
+        float fy = static_cast<float>((window.y + y + 0.5) * scale_y - 0.5);
+        const int sy = cvFloor(fy);
+        fy -= static_cast<float>(sy);
+        horizontal(std::min(std::max(sy, 0), src.rows - 1), row0);
+        horizontal(std::min(std::max(sy + 1, 0), src.rows - 1), row1);
+        const float b0 = 1.0f - fy;
+        float* d = dst.ptr<float>(y);
+        for (int x = 0; x < window.width * cn; ++x) {
+            d[x] = row0[x] * b0 + row1[x] * fy;
+        }
+    }
+    return dst;
+}
+
+void apply_stitch_gains(cv::Mat& patch, const cv::Mat& gains, const cv::Size& warped_size, const cv::Rect& window) {
+    if (gains.empty()) {
+        return;
+    }
+    CV_Assert(patch.type() == CV_8UC3 && gains.depth() == CV_32F);
+    if (gains.total() == 1) {
+        // One gain, or one per channel as ChannelsCompensator multiplies by a cv::Scalar
+        const float* g = gains.ptr<float>(0);
+        const cv::Vec3f gain = gains.channels() == 3 ? cv::Vec3f(g[0], g[1], g[2]) : cv::Vec3f(g[0], g[0], g[0]);
+        for (int y = 0; y < patch.rows; ++y) {
+            uchar* row = patch.ptr<uchar>(y);
+            for (int x = 0; x < patch.cols * 3; x += 3) {
+                for (int c = 0; c < 3; ++c) {
+                    row[x + c] = cv::saturate_cast<uchar>(row[x + c] * gain[c]);
+                }
+            }
+        }
+        return;
+    }
+    const cv::Mat gain = linear_window_32f(gains, warped_size, window);
+    for (int y = 0; y < patch.rows; ++y) {
+        uchar* row = patch.ptr<uchar>(y);
+        const float* g = gain.ptr<float>(y);
+        for (int x = 0; x < patch.cols; ++x) {
+            for (int c = 0; c < 3; ++c) {
+                row[x * 3 + c] = cv::saturate_cast<uchar>(row[x * 3 + c] * g[x]);
+            }
+        }
+    }
+}
+
+cv::Rect compose_stitch_panorama(const std::vector<cv::Mat>& full_images,
+                                 const std::vector<cv::Mat>& seam_images,
+                                 const std::vector<cv::detail::CameraParams>& cameras,
+                                 double warped_image_scale,
+                                 const StitchScales& scales,
+                                 const StitchOptions& options,
+                                 cv::Mat& output_pano,
+                                 cv::Mat& output_mask,
+                                 const cv::Rect& region,
+                                 StitchTimings* timings) {
+    const int count = static_cast<int>(full_images.size());
+    const StitchSeams seams = find_stitch_seams(seam_images, cameras, warped_image_scale, scales, options, timings);
+
+    // Composite at compositing scale
+    int64 start = cv::getTickCount();
+    const double compose_work_aspect = scales.compose / scales.work;
+    std::vector<cv::Rect> rois(count);
+    std::vector<cv::Point> corners(count);
+    std::vector<cv::Size> sizes(count);
+    for (int i = 0; i < count; ++i) {
+        rois[i] = stitch_compose_roi(full_images[i].size(), cameras[i], warped_image_scale, scales);
+        corners[i] = rois[i].tl();
+        sizes[i] = rois[i].size();
+    }
+    const cv::Rect dst_roi = region.empty() ? cv::detail::resultRoi(corners, sizes) : region;
+
+    // Warp every image in parallel, with its gains and seam mask applied
+    std::vector<cv::Mat> images_warped(count);
+    std::vector<cv::Mat> masks_warped(count);
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+        cv::SphericalWarper warper_creator; // One warper per task
+        cv::Ptr<cv::detail::RotationWarper> warper =
+            warper_creator.create(static_cast<float>(warped_image_scale * compose_work_aspect));
+        for (int i = range.start; i < range.end; ++i) {
+            if ((rois[i] & dst_roi).empty()) {
+                continue;
+            }
+            const cv::Mat K = stitch_scaled_intrinsics(cameras[i], compose_work_aspect);
+            cv::Mat image = full_images[i];
+            if (scales.compose != 1.0) {
+                cv::resize(full_images[i], image, stitch_scaled_size(full_images[i].size(), scales.compose), 0, 0,
+                           cv::INTER_LINEAR_EXACT);
+            }
+            cv::Mat mask_warped;
+            warper->warp(image, K, cameras[i].R, cv::INTER_LINEAR, cv::BORDER_REFLECT, images_warped[i]);
+            cv::Mat mask(image.size(), CV_8U, cv::Scalar::all(255));
+            warper->warp(mask, K, cameras[i].R, cv::INTER_NEAREST, cv::BORDER_CONSTANT, mask_warped);
+
+            seams.compensator->apply(i, corners[i], images_warped[i], mask_warped);
+
+            // Restrict the compositing mask to this image's side of the seam
+            cv::Mat seam_mask;
+            cv::Mat dilated_mask;
+            cv::dilate(seams.masks[i], dilated_mask, cv::Mat());
+            cv::resize(dilated_mask, seam_mask, mask_warped.size(), 0, 0, cv::INTER_LINEAR_EXACT);
+            masks_warped[i] = seam_mask & mask_warped;
+        }
+    });
+    add_stage_time(timings ? &timings->warping : nullptr, start);
+
+    // Blend in one piece, or in vertical strips with one blender each and enough context
+    // around every strip that the strips join like a single blend
+    start = cv::getTickCount();
+    const int strips = options.strip_blending
+                           ? std::max(1, std::min(cv::getNumThreads(), dst_roi.width / (4 * stitch_blend_margin(options))))
+                           : 1;
+    output_pano.create(dst_roi.size(), CV_8UC3);
+    output_mask.create(dst_roi.size(), CV_8U);
+    cv::parallel_for_(cv::Range(0, strips), [&](const cv::Range& range) {
+        for (int s = range.start; s < range.end; ++s) {
+            const int x0 = dst_roi.x + static_cast<int>(static_cast<int64>(dst_roi.width) * s / strips);
+            const int x1 = dst_roi.x + static_cast<int>(static_cast<int64>(dst_roi.width) * (s + 1) / strips);
+            const cv::Rect strip(x0, dst_roi.y, x1 - x0, dst_roi.height);
+            const cv::Rect context = stitch_blend_context(strip, dst_roi, options); // dst_roi for one strip
+
+            cv::Ptr<cv::detail::Blender> blender = create_stitch_blender(options);
+            blender->prepare(context);
+            for (int i = 0; i < count; ++i) {
+                const cv::Rect visible = rois[i] & context;
+                if (visible.empty() || images_warped[i].empty()) {
+                    continue;
+                }
+                // Only the part inside the strip's context is fed to the blender
+                const cv::Rect local = visible - corners[i];
+                cv::Mat image_warped_s;
+                images_warped[i](local).convertTo(image_warped_s, CV_16S);
+                blender->feed(image_warped_s, masks_warped[i](local), visible.tl());
+            }
+            cv::Mat result;
+            cv::Mat result_mask;
+            blender->blend(result, result_mask);
+            const cv::Rect inner = strip - context.tl();
+            const cv::Rect out = strip - dst_roi.tl();
+            cv::Mat pano_part = output_pano(out);
+            cv::Mat mask_part = output_mask(out);
+            result(inner).convertTo(pano_part, CV_8U);
+            result_mask(inner).copyTo(mask_part);
+        }
+    });
+    add_stage_time(timings ? &timings->blending : nullptr, start);
+    return dst_roi;
+}
@@ -0,0 +1,311 @@
+#ifndef AI_SLOP_STITCH_PIPELINE_HPP
+#define AI_SLOP_STITCH_PIPELINE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>       // For cv::Mat, cv::Rect
+#include <opencv2/features2d.hpp> // For cv::Feature2D
+#include <opencv2/stitching.hpp>  // For cv::Stitcher::Status
+#include <opencv2/stitching/detail/camera.hpp>
+#include <opencv2/stitching/detail/blenders.hpp>
+#include <opencv2/stitching/detail/exposure_compensate.hpp>
+#include <opencv2/stitching/detail/matchers.hpp>
+#include <opencv2/stitching/detail/seam_finders.hpp>
+#include "stitching.hpp" // For StitchOptions, StitchTimings
+
+// Stages of the stitching pipeline, shared by stitch_images() and StitchSession.
+//
+// The pipeline is the one cv::Stitcher runs in PANORAMA mode, with the same defaults
+// (ORB features, best-of-2-nearest matching, homography estimate refined by ray bundle
+// adjustment, horizontal wave correction, spherical warping, block gain compensation,
+// graph-cut seams and multi-band blending); the last three are selectable through
+// StitchOptions. It is spelled out stage by stage so that decoding, feature extraction,
+// warping and blending can run concurrently, and so that a session can re-run single
+// stages on a subset of the images.
+
+constexpr float kStitchMatchConfidence = 0.3f; ///< Best-of-2-nearest ratio threshold
+constexpr double kStitchPanoConfidence = 1.0;  ///< Minimum pair confidence to keep an image
+constexpr int kStitchOrbFeatures = 500;        ///< ORB keypoints per image (cv::ORB default)
+
+/**
+ * @brief Scales of the pipeline stages relative to the full-resolution images.
+ *
+ * Like cv::Stitcher, all scales are derived from the first image, and a compositing
+ * scale within 10% of the original resolution is rounded to 1.
+ */
+struct StitchScales {
+    double work = 1.0;    ///< Registration
+    double seam = 1.0;    ///< Seam estimation and exposure compensation
+    double compose = 1.0; ///< Compositing
+};
+
+/**
+ * @brief Computes the stage scales for images of the given size.
+ *
+ * @param image_size Size of the first input image.
+ * @param options Stage resolutions in megapixels (negative: original resolution).
+ */
+StitchScales stitch_scales(const cv::Size& image_size, const StitchOptions& options);
+
+/**
+ * @brief Size of an image resized by a scale factor, as cv::resize computes it.
+ */
+cv::Size stitch_scaled_size(const cv::Size& size, double scale);
+
+/**
+ * @brief Loads an image; with content_hash, also hashes the encoded file for the feature cache.
+ *
+ * @return cv::Mat The decoded image, empty if the file cannot be read or decoded.
+ */
+cv::Mat decode_stitch_image(const std::string& path, uint64_t* content_hash = nullptr);
+
+/**
+ * @brief Feature cache settings string for features detected at the given scales.
+ */
+std::string stitch_feature_settings(const StitchScales& scales);
+
+/**
+ * @brief Detects features on an image at registration scale.
+ *
+ * @param finder Feature detector (not thread-safe; use one per thread).
+ * @param image Full-resolution image.
+ * @param work_scale Registration scale.
+ * @param features Receives the features; img_idx is left unchanged.
+ */
+void compute_stitch_features(const cv::Ptr<cv::Feature2D>& finder, const cv::Mat& image, double work_scale,
+                             cv::detail::ImageFeatures& features);
+
+/**
+ * @brief Decodes the input images and extracts their features.
+ *
+ * The first image is decoded up front because it fixes the stage scales for all
+ * images. The remaining images are decoded in parallel on OpenCV's thread pool, one
+ * task per image, and each image's features are extracted by the same task right
+ * after it is decoded. Results are stored by input index.
+ *
+ * With a feature cache directory in the options, images whose encoded file and
+ * detector settings match a cache entry reuse the stored features; new features are
+ * added to the cache.
+ *
+ * @param image_paths Paths of the input images.
+ * @param options Stage resolutions and the feature cache directory (empty to always detect).
+ * @param full_images Receives the decoded images, in input order.
+ * @param seam_images Receives the images at seam-estimation scale.
+ * @param features Receives the features at registration scale (img_idx = input index).
+ * @param scales Receives the stage scales derived from the first image.
+ * @param content_hashes Receives the hashes of the encoded files; only filled when a
+ *                       feature cache directory is set.
+ * @param image_sizes If given, receives the full-resolution image sizes and the full
+ *                    images are released once their features and seam image exist
+ *                    (full_images is left with empty entries), so that at most one
+ *                    full image per thread is resident. For compositing that decodes
+ *                    the images again.
+ * @throws std::runtime_error if an image cannot be loaded.
+ */
+void load_stitch_images(const std::vector<std::string>& image_paths,
+                        const StitchOptions& options,
+                        std::vector<cv::Mat>& full_images,
+                        std::vector<cv::Mat>& seam_images,
+                        std::vector<cv::detail::ImageFeatures>& features,
+                        StitchScales& scales,
+                        std::vector<uint64_t>& content_hashes,
+                        std::vector<cv::Size>* image_sizes = nullptr);
+
+/**
+ * @brief Creates the pairwise matcher selected by options.indexed_matching.
+ *
+ * Both are best-of-2-nearest matchers with the same ratio test and pair confidence.
+ * The default is cv::detail::BestOf2NearestMatcher, which builds a FLANN index per
+ * image pair; the indexed matcher builds one index per image (LSH for the binary ORB
+ * descriptors) and reuses it for every pair the image takes part in.
+ */
+cv::Ptr<cv::detail::FeaturesMatcher> create_stitch_matcher(const StitchOptions& options);
+
+/**
+ * @brief Selects the image pairs to match from the capture order and the GPS positions.
+ *
+ * Pair (i, j), i < j, is matched when j - i <= options.match_range, or when both images
+ * have a GPS position and were taken within options.gps_radius_m of each other. Without
+ * a range, images with an unknown position are matched against all images.
+ *
+ * @param count Number of images, in input order.
+ * @param options Match range and GPS positions.
+ * @return cv::Mat count x count CV_8U mask for cv::detail::FeaturesMatcher (non-zero
+ *         above the diagonal: match), or an empty matrix to match all pairs.
+ */
+cv::Mat stitch_match_mask(size_t count, const StitchOptions& options);
+
+/**
+ * @brief Matches the image pairs selected by the options, estimates and refines the cameras.
+ *
+ * Images that do not confidently belong to the panorama are dropped from features
+ * (as cv::Stitcher does); indices lists the input indices that were kept, and
+ * pairwise_matches is indexed by kept image (i * kept + j).
+ *
+ * @param features Features of the images, in input order; reduced to the kept images.
+ * @param options Pair selection and matcher (see stitch_match_mask, create_stitch_matcher).
+ * @param pairwise_matches Receives the matches between the kept images.
+ * @param cameras Receives the cameras of the kept images.
+ * @param warped_image_scale Receives the median focal length, the scale of the warped panorama.
+ * @param indices Receives the input indices of the kept images.
+ * @param timings If given, matching and estimation times are added to it.
+ * @return cv::Stitcher::Status OK, or the stage that failed.
+ */
+cv::Stitcher::Status register_stitch_images(std::vector<cv::detail::ImageFeatures>& features,
+                                            const StitchOptions& options,
+                                            std::vector<cv::detail::MatchesInfo>& pairwise_matches,
+                                            std::vector<cv::detail::CameraParams>& cameras,
+                                            double& warped_image_scale,
+                                            std::vector<int>& indices,
+                                            StitchTimings* timings = nullptr);
+
+/**
+ * @brief Returns the intrinsics of a camera as CV_32F, with focal and principal point scaled.
+ */
+cv::Mat stitch_scaled_intrinsics(const cv::detail::CameraParams& camera, double scale);
+
+/**
+ * @brief Bounding box of an image in the composited panorama.
+ *
+ * @param image_size Full-resolution size of the image.
+ * @param camera Camera of the image (registration scale).
+ * @param warped_image_scale Scale of the warped panorama (registration scale).
+ * @param scales Stage scales.
+ */
+cv::Rect stitch_compose_roi(const cv::Size& image_size, const cv::detail::CameraParams& camera,
+                            double warped_image_scale, const StitchScales& scales);
+
+/**
+ * @brief Creates the exposure compensator selected by options.exposure.
+ */
+cv::Ptr<cv::detail::ExposureCompensator> create_stitch_compensator(const StitchOptions& options);
+
+/**
+ * @brief Creates the seam finder selected by options.seam_finder.
+ */
+cv::Ptr<cv::detail::SeamFinder> create_stitch_seam_finder(const StitchOptions& options);
+
+/**
+ * @brief Creates the blender selected by options.blender, with options.blend_bands bands.
+ *
+ * @throws std::invalid_argument if a multi-band blender has no bands.
+ */
+cv::Ptr<cv::detail::Blender> create_stitch_blender(const StitchOptions& options);
+
+/**
+ * @brief Context in compositing pixels that a blender needs around a region for the
+ *        region to come out as in a blend of the whole panorama.
+ */
+int stitch_blend_margin(const StitchOptions& options);
+
+/**
+ * @brief Rectangle to prepare a blender with when only region of the canvas is blended.
+ *
+ * The region grows by stitch_blend_margin() on every side, clipped to the canvas. For
+ * the multi-band blender its top-left corner is also moved to the canvas's 2^bands grid,
+ * so the pyramid levels line up with those of a blend of the whole canvas. Images cut
+ * at the context edge are still reflect-padded there by the blender, so the region can
+ * differ slightly from a blend of the whole canvas; the margin keeps that difference
+ * away from the region's pixels as far as the pyramid kernels reach.
+ *
+ * @param region Part of the canvas whose blended pixels are needed.
+ * @param canvas The whole blended area (panorama ROI).
+ * @param options Blender selection and band count.
+ */
+cv::Rect stitch_blend_context(const cv::Rect& region, const cv::Rect& canvas, const StitchOptions& options);
+
+/**
+ * @brief Exposure gains and seams of a panorama, estimated at seam scale.
+ */
+struct StitchSeams {
+    cv::Ptr<cv::detail::ExposureCompensator> compensator; ///< Fed with the warped seam images
+    std::vector<cv::UMat> masks;                          ///< Warped seam masks, cut along the seams
+};
+
+/**
+ * @brief Warps the seam images, estimates exposure gains and finds the seams.
+ *
+ * The seam images are warped in parallel, one task per image.
+ *
+ * @param seam_images Images at seam-estimation scale.
+ * @param cameras Cameras of the images.
+ * @param warped_image_scale Scale of the warped panorama (registration scale).
+ * @param scales Stage scales.
+ * @param options Exposure compensator and seam finder.
+ * @param timings If given, exposure and seam times are added to it.
+ */
+StitchSeams find_stitch_seams(const std::vector<cv::Mat>& seam_images,
+                              const std::vector<cv::detail::CameraParams>& cameras,
+                              double warped_image_scale,
+                              const StitchScales& scales,
+                              const StitchOptions& options,
+                              StitchTimings* timings = nullptr);
+
+/**
+ * @brief Exposure gains of the images, in a layout that tells the compensators apart.
+ *
+ * One Mat per image: 1x1 CV_32F for one gain, 1x1 CV_32FC3 for per-channel gains, the
+ * CV_32F block grid for block gains, and empty without compensation. The gains of
+ * ExposureCompensator::getMatGains() are not used as they are, because per-channel gains
+ * come back as a 4x1 column that looks like a block grid.
+ *
+ * @param seams Seams whose compensator was fed by find_stitch_seams().
+ * @param options The exposure compensator selected for find_stitch_seams().
+ * @param count Number of images.
+ */
+std::vector<cv::Mat> stitch_exposure_gains(const StitchSeams& seams, const StitchOptions& options, size_t count);
+
+/**
+ * @brief Applies exposure gains to a window of a warped image, as ExposureCompensator::apply()
+ *        does on the whole warped image.
+ *
+ * Block grids are interpolated over the window only, as cv::resize would over the whole
+ * warped image.
+ *
+ * @param patch The window of the warped image (CV_8UC3), modified in place.
+ * @param gains Gains of the image from stitch_exposure_gains(); empty leaves the patch unchanged.
+ * @param warped_size Size of the whole warped image.
+ * @param window Position of the patch in the warped image.
+ */
+void apply_stitch_gains(cv::Mat& patch, const cv::Mat& gains, const cv::Size& warped_size, const cv::Rect& window);
+
+/**
+ * @brief Finds seams and exposure gains at seam scale, then warps and blends the images
+ *        at compositing scale.
+ *
+ * With a region, only that part of the panorama is composited: images are blended
+ * into a canvas covering the region only, and images outside it may be omitted from
+ * the inputs. Exposure gains and seams are then estimated from the given images only.
+ *
+ * Images are warped in parallel, one task per image, and all warped images are held
+ * until blending. With options.strip_blending (the default), blending runs in parallel
+ * over vertical strips of the panorama, each with its own blender prepared on
+ * stitch_blend_context() of the strip; the context makes the strips join exactly like
+ * a single blend. Otherwise a single blender composites the panorama.
+ *
+ * @param full_images Full-resolution images.
+ * @param seam_images The same images at seam-estimation scale.
+ * @param cameras Cameras of the images.
+ * @param warped_image_scale Scale of the warped panorama (registration scale).
+ * @param scales Stage scales.
+ * @param options Exposure compensator, seam finder and blender.
+ * @param output_pano Receives the composited 8-bit panorama.
+ * @param output_mask Receives the 8-bit coverage mask of the panorama.
+ * @param region Part of the panorama to composite, in panorama coordinates; empty
+ *               (default) composites the bounding box of all images.
+ * @param timings If given, exposure, seam, warping and blending times are added to it.
+ * @return cv::Rect The part of the panorama that was composited, in panorama coordinates.
+ */
+cv::Rect compose_stitch_panorama(const std::vector<cv::Mat>& full_images,
+                                 const std::vector<cv::Mat>& seam_images,
+                                 const std::vector<cv::detail::CameraParams>& cameras,
+                                 double warped_image_scale,
+                                 const StitchScales& scales,
+                                 const StitchOptions& options,
+                                 cv::Mat& output_pano,
+                                 cv::Mat& output_mask,
+                                 const cv::Rect& region = cv::Rect(),
+                                 StitchTimings* timings = nullptr);
+
+#endif // AI_SLOP_STITCH_PIPELINE_HPP
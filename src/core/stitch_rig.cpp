@@ -0,0 +1,320 @@
+#include "stitch_rig.hpp"
+#include <opencv2/imgcodecs.hpp> // For cv::imread
+#include <opencv2/imgproc.hpp>   // For cv::remap, cv::convertMaps, cv::resize, cv::dilate
+#include <opencv2/stitching/detail/blenders.hpp> // For cv::detail::createWeightMap
+#include <opencv2/stitching/warpers.hpp>
+#include <algorithm> // For std::fill
+#include <fstream>   // For probing the calibration file
+#include <iostream>  // For status messages
+#include <stdexcept> // For std::invalid_argument, std::runtime_error
+
+static const int kRigVersion = 2; // 2: gains in the stitch_exposure_gains() layout
+static const float kFeatherSharpness = 0.02f; // cv::detail::FeatherBlender default
+static const float kWeightEps = 1e-5f;        // As in cv::detail::FeatherBlender
+
+static void check_rig_frames(const std::vector<cv::Mat>& frames) {
+    for (const cv::Mat& frame : frames) {
+        if (frame.empty() || frame.type() != CV_8UC3) {
+            throw std::invalid_argument("Rig frames must be non-empty 8-bit BGR images.");
+        }
+    }
+}
+
+cv::Stitcher::Status StitchRig::calibrate(const std::vector<cv::Mat>& frames, const StitchOptions& options) {
+    if (frames.size() < 2) {
+        throw std::invalid_argument("Calibrating a stitching rig needs at least two frames.");
+    }
+    if (options.registration_resol == 0 || options.seam_estimation_resol == 0 || options.compositing_resol == 0) {
+        throw std::invalid_argument("Stitching resolutions must be positive megapixels or negative for the original resolution.");
+    }
+    check_rig_frames(frames);
+    cameras_.clear();
+
+    // Features and seam images, one task per frame
+    const int count = static_cast<int>(frames.size());
+    const StitchScales scales = stitch_scales(frames[0].size(), options);
+    std::vector<cv::detail::ImageFeatures> features(count);
+    std::vector<cv::Mat> seam_images(count);
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+        cv::Ptr<cv::Feature2D> finder = cv::ORB::create(kStitchOrbFeatures);
+        for (int i = range.start; i < range.end; ++i) {
+            features[i].img_idx = i;
+            compute_stitch_features(finder, frames[i], scales.work, features[i]);
+            cv::resize(frames[i], seam_images[i], cv::Size(), scales.seam, scales.seam, cv::INTER_LINEAR_EXACT);
+        }
+    }, count);
+
+    std::vector<cv::detail::MatchesInfo> pairwise_matches;
+    std::vector<cv::detail::CameraParams> cameras;
+    std::vector<int> indices;
+    double warped_image_scale = 1.0;
+    const cv::Stitcher::Status status =
+        register_stitch_images(features, options, pairwise_matches, cameras, warped_image_scale, indices);
+    if (status != cv::Stitcher::OK) {
+        return status;
+    }
+    std::vector<cv::Mat> kept_seam;
+    for (int index : indices) {
+        kept_seam.push_back(seam_images[index]);
+    }
+    StitchSeams seams = find_stitch_seams(kept_seam, cameras, warped_image_scale, scales, options);
+    const std::vector<cv::Mat> gains = stitch_exposure_gains(seams, options, indices.size());
+
+    scales_ = scales;
+    warped_image_scale_ = warped_image_scale;
+    frame_sizes_.clear();
+    for (const cv::Mat& frame : frames) {
+        frame_sizes_.push_back(frame.size());
+    }
+
+    // Remap tables and seam masks at compositing scale
+    const double compose_work_aspect = scales.compose / scales.work;
+    cv::SphericalWarper warper_creator;
+    cv::Ptr<cv::detail::RotationWarper> warper =
+        warper_creator.create(static_cast<float>(warped_image_scale * compose_work_aspect));
+    cameras_.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        RigCamera& rig_camera = cameras_[i];
+        rig_camera.frame = indices[i];
+        rig_camera.camera = cameras[i];
+        rig_camera.gains = gains[i];
+
+        const cv::Size compose_size = stitch_scaled_size(frames[indices[i]].size(), scales.compose);
+        cv::Mat xmap;
+        cv::Mat ymap;
+        rig_camera.roi = warper->buildMaps(compose_size, stitch_scaled_intrinsics(cameras[i], compose_work_aspect),
+                                           cameras[i].R, xmap, ymap);
+        cv::convertMaps(xmap, ymap, rig_camera.map1, rig_camera.map2, CV_16SC2);
+
+        // Restrict the warped frame to this camera's side of the seam, as compose_stitch_panorama() does
+        cv::Mat mask_warped;
+        cv::remap(cv::Mat(compose_size, CV_8U, cv::Scalar::all(255)), mask_warped, xmap, ymap, cv::INTER_NEAREST,
+                  cv::BORDER_CONSTANT);
+        cv::Mat dilated_mask;
+        cv::Mat seam_mask;
+        cv::dilate(seams.masks[i], dilated_mask, cv::Mat());
+        cv::resize(dilated_mask, seam_mask, mask_warped.size(), 0, 0, cv::INTER_LINEAR_EXACT);
+        rig_camera.seam_mask = seam_mask & mask_warped;
+    }
+    build_weights();
+    std::cout << "Rig calibrated: " << cameras_.size() << " of " << frames.size() << " cameras, panorama "
+              << panorama_roi_.width << "x" << panorama_roi_.height << "." << std::endl;
+    return cv::Stitcher::OK;
+}
+
+void StitchRig::build_weights() {
+    std::vector<cv::Point> corners;
+    std::vector<cv::Size> sizes;
+    for (const RigCamera& rig_camera : cameras_) {
+        corners.push_back(rig_camera.roi.tl());
+        sizes.push_back(rig_camera.roi.size());
+    }
+    panorama_roi_ = cv::detail::resultRoi(corners, sizes);
+
+    // Feathered seam masks, normalised so that overlapping weights sum to one
+    cv::Mat weight_sum = cv::Mat::zeros(panorama_roi_.size(), CV_32F);
+    for (RigCamera& rig_camera : cameras_) {
+        cv::detail::createWeightMap(rig_camera.seam_mask, kFeatherSharpness, rig_camera.weight);
+        cv::Mat sum = weight_sum(rig_camera.roi - panorama_roi_.tl());
+        sum += rig_camera.weight;
+    }
+    panorama_mask_ = weight_sum > kWeightEps;
+    for (RigCamera& rig_camera : cameras_) {
+        cv::Mat sum;
+        cv::add(weight_sum(rig_camera.roi - panorama_roi_.tl()), cv::Scalar::all(kWeightEps), sum);
+        cv::divide(rig_camera.weight, sum, rig_camera.weight);
+        if (rig_camera.gains.total() == 1) {
+            // One gain, or one per channel (which makes the weight per channel too)
+            const float* g = rig_camera.gains.ptr<float>(0);
+            const int channels = rig_camera.gains.channels();
+            const cv::Mat planes[] = {rig_camera.weight * g[0], rig_camera.weight * g[channels == 3 ? 1 : 0],
+                                      rig_camera.weight * g[channels == 3 ? 2 : 0]};
+            if (channels == 3) {
+                cv::merge(planes, 3, rig_camera.weight);
+            } else {
+                rig_camera.weight = planes[0];
+            }
+        } else if (!rig_camera.gains.empty()) {
+            // A coarse block grid over the warped frame, interpolated like BlocksCompensator does
+            cv::Mat gain;
+            cv::resize(rig_camera.gains, gain, rig_camera.roi.size(), 0, 0, cv::INTER_LINEAR);
+            rig_camera.weight = rig_camera.weight.mul(gain);
+        }
+    }
+}
+
+void StitchRig::compose(const std::vector<cv::Mat>& frames, cv::Mat& output_pano, cv::Mat& output_mask) const {
+    if (!calibrated()) {
+        throw std::invalid_argument("Stitching rig is not calibrated.");
+    }
+    if (frames.size() != frame_sizes_.size()) {
+        throw std::invalid_argument("Rig was calibrated with " + std::to_string(frame_sizes_.size())
+                                    + " frames, received " + std::to_string(frames.size()) + ".");
+    }
+    check_rig_frames(frames);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (frames[i].size() != frame_sizes_[i]) {
+            throw std::invalid_argument("Rig frame " + std::to_string(i) + " does not have the calibration size.");
+        }
+    }
+
+    // Warp every frame with its cached remap tables
+    const int count = static_cast<int>(cameras_.size());
+    std::vector<cv::Mat> warped(count);
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            const RigCamera& rig_camera = cameras_[i];
+            cv::Mat image = frames[rig_camera.frame];
+            if (scales_.compose != 1.0) {
+                cv::resize(frames[rig_camera.frame], image, stitch_scaled_size(image.size(), scales_.compose), 0, 0,
+                           cv::INTER_LINEAR_EXACT);
+            }
+            cv::remap(image, warped[i], rig_camera.map1, rig_camera.map2, cv::INTER_LINEAR, cv::BORDER_REFLECT);
+        }
+    }, count);
+
+    // Weighted sum, row band by row band
+    output_pano.create(panorama_roi_.size(), CV_8UC3);
+    cv::parallel_for_(cv::Range(0, panorama_roi_.height), [&](const cv::Range& range) {
+        std::vector<float> accumulator(static_cast<size_t>(panorama_roi_.width) * 3);
+        for (int y = range.start; y < range.end; ++y) {
+            std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+            const int pano_y = y + panorama_roi_.y;
+            for (int i = 0; i < count; ++i) {
+                const RigCamera& rig_camera = cameras_[i];
+                if (pano_y < rig_camera.roi.y || pano_y >= rig_camera.roi.br().y) {
+                    continue;
+                }
+                const int local_y = pano_y - rig_camera.roi.y;
+                const uchar* src = warped[i].ptr<uchar>(local_y);
+                const float* weight = rig_camera.weight.ptr<float>(local_y);
+                float* acc = accumulator.data() + static_cast<size_t>(rig_camera.roi.x - panorama_roi_.x) * 3;
+                if (rig_camera.weight.channels() == 3) {
+                    for (int x = 0; x < rig_camera.roi.width * 3; ++x) {
+                        acc[x] += weight[x] * src[x];
+                    }
+                } else {
+                    for (int x = 0; x < rig_camera.roi.width; ++x) {
+                        const float w = weight[x];
+                        acc[x * 3] += w * src[x * 3];
+                        acc[x * 3 + 1] += w * src[x * 3 + 1];
+                        acc[x * 3 + 2] += w * src[x * 3 + 2];
+                    }
+                }
+            }
+            uchar* dst = output_pano.ptr<uchar>(y);
+            for (size_t x = 0; x < accumulator.size(); ++x) {
+                dst[x] = cv::saturate_cast<uchar>(accumulator[x]);
+            }
+        }
+    });
+    panorama_mask_.copyTo(output_mask);
+}
+
+void StitchRig::save(const std::string& path) const {
+    if (!calibrated()) {
+        throw std::runtime_error("Cannot save an uncalibrated stitching rig.");
+    }
+    // Remap tables are large: stored as base64 blocks rather than text
+    cv::FileStorage fs(path, cv::FileStorage::WRITE | cv::FileStorage::BASE64);
+    if (!fs.isOpened()) {
+        throw std::runtime_error("Failed to write stitching rig calibration: " + path);
+    }
+    fs << "version" << kRigVersion;
+    fs << "work_scale" << scales_.work << "seam_scale" << scales_.seam << "compose_scale" << scales_.compose;
+    fs << "warped_image_scale" << warped_image_scale_;
+    fs << "frame_sizes" << "[";
+    for (const cv::Size& size : frame_sizes_) {
+        fs << size;
+    }
+    fs << "]";
+    fs << "cameras" << "[";
+    for (const RigCamera& rig_camera : cameras_) {
+        fs << "{" << "frame" << rig_camera.frame;
+        fs << "focal" << rig_camera.camera.focal << "aspect" << rig_camera.camera.aspect;
+        fs << "ppx" << rig_camera.camera.ppx << "ppy" << rig_camera.camera.ppy << "R" << rig_camera.camera.R;
+        fs << "roi_tl" << rig_camera.roi.tl() << "roi_size" << rig_camera.roi.size();
+        fs << "map1" << rig_camera.map1 << "map2" << rig_camera.map2;
+        fs << "seam_mask" << rig_camera.seam_mask << "gains" << rig_camera.gains << "}";
+    }
+    fs << "]";
+}
+
+void StitchRig::load(const std::string& path) {
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if (!fs.isOpened() || static_cast<int>(fs["version"]) != kRigVersion) {
+        throw std::runtime_error("Unsupported or unreadable stitching rig calibration: " + path);
+    }
+    fs["work_scale"] >> scales_.work;
+    fs["seam_scale"] >> scales_.seam;
+    fs["compose_scale"] >> scales_.compose;
+    fs["warped_image_scale"] >> warped_image_scale_;
+    frame_sizes_.clear();
+    for (const cv::FileNode& node : fs["frame_sizes"]) {
+        cv::Size size;
+        node >> size;
+        frame_sizes_.push_back(size);
+    }
+    cameras_.clear();
+    for (const cv::FileNode& node : fs["cameras"]) {
+        RigCamera rig_camera;
+        cv::Point roi_tl;
+        cv::Size roi_size;
+        node["frame"] >> rig_camera.frame;
+        node["focal"] >> rig_camera.camera.focal;
+        node["aspect"] >> rig_camera.camera.aspect;
+        node["ppx"] >> rig_camera.camera.ppx;
+        node["ppy"] >> rig_camera.camera.ppy;
+        node["R"] >> rig_camera.camera.R;
+        node["roi_tl"] >> roi_tl;
+        node["roi_size"] >> roi_size;
+        rig_camera.roi = cv::Rect(roi_tl, roi_size);
+        node["map1"] >> rig_camera.map1;
+        node["map2"] >> rig_camera.map2;
+        node["seam_mask"] >> rig_camera.seam_mask;
+        node["gains"] >> rig_camera.gains;
+        if (rig_camera.frame < 0 || rig_camera.frame >= static_cast<int>(frame_sizes_.size())
+            || rig_camera.map1.size() != roi_size || rig_camera.seam_mask.size() != roi_size) {
+            throw std::runtime_error("Corrupt stitching rig calibration: " + path);
+        }
+        cameras_.push_back(rig_camera);
+    }
+    if (cameras_.empty()) {
+        throw std::runtime_error("Stitching rig calibration has no cameras: " + path);
+    }
+    build_weights();
+    std::cout << "Rig loaded: " << cameras_.size() << " of " << frame_sizes_.size() << " cameras, panorama "
+              << panorama_roi_.width << "x" << panorama_roi_.height << "." << std::endl;
+}
+
+cv::Stitcher::Status stitch_images_with_rig(const std::vector<std::string>& image_paths,
+                                            const std::string& rig_path,
+                                            cv::Mat& output_pano,
+                                            const StitchOptions& options) {
+    std::vector<cv::Mat> frames;
+    for (const std::string& path : image_paths) {
+        frames.push_back(cv::imread(path, cv::IMREAD_COLOR));
+        if (frames.back().empty()) {
+            throw std::runtime_error("Failed to load image for stitching: " + path);
+        }
+    }
+
+    StitchRig rig;
+    if (std::ifstream(rig_path).good()) {
+        rig.load(rig_path);
+    } else {
+        std::cout << "No rig calibration at " << rig_path << ", calibrating from these images..." << std::endl;
+        const cv::Stitcher::Status status = rig.calibrate(frames, options);
+        if (status != cv::Stitcher::OK) {
+            return status;
+        }
+        rig.save(rig_path);
+    }
+
+    const int64 start = cv::getTickCount();
+    cv::Mat pano_mask;
+    rig.compose(frames, output_pano, pano_mask);
+    std::cout << "Rig composite took " << (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency() << " ms."
+              << std::endl;
+    return cv::Stitcher::OK;
+}
@@ -0,0 +1,124 @@
+#ifndef AI_SLOP_STITCH_RIG_HPP
+#define AI_SLOP_STITCH_RIG_HPP
+
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>      // For cv::Mat, cv::Rect
+#include <opencv2/stitching.hpp> // For cv::Stitcher::Status
+#include <opencv2/stitching/detail/camera.hpp>
+#include "stitch_pipeline.hpp"
+#include "stitching.hpp"
+
+/**
+ * @brief Calibrate-once, compose-many stitching for a fixed camera rig.
+ *
+ * calibrate() runs the full pipeline once on a set of frames, one per camera:
+ * registration, exposure gains and seams. It then keeps what compositing needs:
+ * - the camera parameters;
+ * - per camera, the remap tables of the spherical warp at compositing scale, in
+ *   fixed-point form (cv::convertMaps);
+ * - per camera, the seam mask and the exposure gains.
+ *
+ * From these, compose() blends every later set of frames from the same cameras. Each
+ * frame is remapped, and the frames are accumulated with per-pixel weights computed
+ * once: feathered seam masks, normalised, with the exposure gains folded in. Nothing
+ * is detected, matched, adjusted or searched per set, so the cost is a resize, a
+ * remap and a multiply-add per pixel.
+ *
+ * The seam finder and exposure compensator are those selected in the calibration
+ * options. Compared with stitch_images(), seams are always feathered (whatever the
+ * blender option), and exposure gains are those of the calibration frames.
+ */
+class StitchRig {
+public:
+    StitchRig() = default;
+
+    /**
+     * @brief Registers the cameras and precomputes the warp, seams and blend weights.
+     *
+     * @param frames One 8-bit BGR frame per camera, in rig order.
+     * @param options Stage resolutions and pair selection (the feature cache is not used).
+     * @return cv::Stitcher::Status OK, or the registration stage that failed; the rig
+     *         is left uncalibrated on failure.
+     * @throws std::invalid_argument if there are fewer than two frames, a frame is empty
+     *         or not 8-bit BGR, or a resolution is zero.
+     */
+    cv::Stitcher::Status calibrate(const std::vector<cv::Mat>& frames, const StitchOptions& options = StitchOptions());
+
+    /**
+     * @brief Composites a set of frames with the calibrated geometry.
+     *
+     * Frames of cameras that were dropped at calibration (no overlap) are ignored.
+     * The cost grows with the warped pixels (the sum of the camera ROIs at compositing
+     * scale), not with the scene content: about a tenth of a stitch_images() call at the
+     * same resolution on one thread. Lower the compositing resolution to reach video rates.
+     *
+     * @param frames One 8-bit BGR frame per camera, same order and sizes as at calibration.
+     * @param output_pano Receives the 8-bit panorama.
+     * @param output_mask Receives the 8-bit coverage mask of the panorama.
+     * @throws std::invalid_argument if the rig is not calibrated or the frames do not
+     *         match the calibration frames.
+     */
+    void compose(const std::vector<cv::Mat>& frames, cv::Mat& output_pano, cv::Mat& output_mask) const;
+
+    /**
+     * @brief Writes the calibration to a file (cv::FileStorage; ".yml.gz" compresses it).
+     *
+     * @throws std::runtime_error if the rig is not calibrated or the file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Reads a calibration written by save() and rebuilds the blend weights.
+     *
+     * @throws std::runtime_error if the file cannot be read or is not a rig calibration.
+     */
+    void load(const std::string& path);
+
+    bool calibrated() const { return !cameras_.empty(); }
+    size_t frame_count() const { return frame_sizes_.size(); }
+    size_t camera_count() const { return cameras_.size(); } ///< Cameras kept at calibration
+    cv::Size panorama_size() const { return panorama_roi_.size(); }
+
+private:
+    struct RigCamera {
+        int frame = 0;                   // Index of the camera's frame in a set
+        cv::detail::CameraParams camera; // Registration scale
+        cv::Rect roi;                    // Warped frame in panorama coordinates
+        cv::Mat map1;                    // Fixed-point remap table (CV_16SC2)
+        cv::Mat map2;                    // Interpolation table (CV_16UC1)
+        cv::Mat seam_mask;               // Warped pixels on this camera's side of the seams
+        cv::Mat gains;                   // Exposure gains from stitch_exposure_gains(), empty for none
+        cv::Mat weight;                  // Blend weight with the gains folded in (roi size, 1 or 3 channels)
+    };
+
+    void build_weights();
+
+    StitchScales scales_;
+    double warped_image_scale_ = 1.0;
+    std::vector<cv::Size> frame_sizes_; // Full-resolution size of every frame of a set
+    std::vector<RigCamera> cameras_;
+    cv::Rect panorama_roi_;
+    cv::Mat panorama_mask_;
+};
+
+/**
+ * @brief Stitches a set of rig frames, calibrating the rig on first use.
+ *
+ * If rig_path does not exist, the rig is calibrated from these frames and saved there;
+ * otherwise the saved calibration is loaded and only compositing runs.
+ *
+ * @param image_paths One image per camera, in rig order.
+ * @param rig_path Calibration file of the rig.
+ * @param output_pano Receives the panorama.
+ * @param options Stage resolutions and pair selection for a new calibration.
+ * @return cv::Stitcher::Status OK, or the calibration stage that failed.
+ * @throws std::runtime_error if an image cannot be loaded or the calibration cannot be read or written.
+ * @throws std::invalid_argument if the images do not match the saved calibration.
+ */
+cv::Stitcher::Status stitch_images_with_rig(const std::vector<std::string>& image_paths,
+                                            const std::string& rig_path,
+                                            cv::Mat& output_pano,
+                                            const StitchOptions& options = StitchOptions());
+
+#endif // AI_SLOP_STITCH_RIG_HPP
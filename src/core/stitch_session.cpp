@@ -0,0 +1,570 @@
+#include "stitch_session.hpp"
+#include <opencv2/imgcodecs.hpp> // For cv::imread, cv::imwrite
+#include <opencv2/stitching/detail/motion_estimators.hpp>
+#include <opencv2/stitching/warpers.hpp>
+#include <algorithm> // For std::sort, std::min, std::max
+#include <cstdio>    // For std::snprintf
+#include <fstream>   // For probing the session file
+#include <iostream>  // For status messages
+#include <stdexcept> // For std::invalid_argument, std::runtime_error
+#include <utility>   // For std::pair
+
+static const int kSessionVersion = 1;
+static const size_t kRecentNeighbours = 3;  // Latest images tried first: uploads usually continue a sweep
+static const size_t kSpatialNeighbours = 6; // Overlapping images matched besides the recent ones
+static const size_t kAnchorImages = 6;      // Fixed images around the neighbours in the local adjustment
+static const int kBlendMargin = 64;         // Cross-fade band around a recomposited region (compositing pixels)
+
+static std::string hash_to_string(uint64_t hash) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+    return text;
+}
+
+/**
+ * @brief Returns the matches of a pair seen from the other image.
+ */
+static cv::detail::MatchesInfo reversed_matches(const cv::detail::MatchesInfo& info) {
+    cv::detail::MatchesInfo reversed = info;
+    std::swap(reversed.src_img_idx, reversed.dst_img_idx);
+    for (cv::DMatch& match : reversed.matches) {
+        std::swap(match.queryIdx, match.trainIdx);
+    }
+    if (!info.H.empty()) {
+        reversed.H = info.H.inv();
+    }
+    return reversed;
+}
+
+/**
+ * @brief Nearest rotation matrix (CV_64F) to a 3x3 matrix.
+ */
+static cv::Mat nearest_rotation(const cv::Mat& m) {
+    cv::SVD svd(m, cv::SVD::FULL_UV);
+    cv::Mat R = svd.u * svd.vt;
+    if (cv::determinant(R) < 0) {
+        R = -R;
+    }
+    return R;
+}
+
+/**
+ * @brief Cross-fade weight of a coordinate: 1 inside [inner_lo, inner_hi), falling
+ *        linearly to 0 at the outer bounds.
+ */
+static float fade_weight(int v, int outer_lo, int inner_lo, int inner_hi, int outer_hi) {
+    if (v < inner_lo) {
+        return static_cast<float>(v - outer_lo + 1) / static_cast<float>(inner_lo - outer_lo + 1);
+    }
+    if (v >= inner_hi) {
+        return static_cast<float>(outer_hi - v) / static_cast<float>(outer_hi - inner_hi + 1);
+    }
+    return 1.0f;
+}
+
+StitchSession::StitchSession(const std::string& directory, const StitchOptions& options)
+    : directory_(directory), options_(options) {
+    if (directory.empty()) {
+        throw std::invalid_argument("Stitching session directory must not be empty.");
+    }
+    if (options.registration_resol == 0 || options.seam_estimation_resol == 0 || options.compositing_resol == 0) {
+        throw std::invalid_argument("Stitching resolutions must be positive megapixels or negative for the original resolution.");
+    }
+    options_.feature_cache_dir = directory_; // Features are part of the session state
+    if (std::ifstream(directory_ + "/session.yml").good()) {
+        load();
+    }
+}
+
+cv::Stitcher::Status StitchSession::add_images(const std::vector<std::string>& image_paths) {
+    if (images_.empty()) {
+        const cv::Stitcher::Status status = start(image_paths);
+        if (status == cv::Stitcher::OK) {
+            save();
+        }
+        return status;
+    }
+
+    cv::Rect affected;
+    size_t added = 0;
+    for (const std::string& path : image_paths) {
+        added += add_image(path, affected) ? 1 : 0;
+    }
+    if (added > 0) {
+        recomposite(affected);
+        save();
+    }
+    std::cout << "Stitching session: added " << added << " of " << image_paths.size() << " images, "
+              << images_.size() << " images in the panorama." << std::endl;
+    return cv::Stitcher::OK;
+}
+
+cv::Stitcher::Status StitchSession::start(const std::vector<std::string>& image_paths) {
+    if (image_paths.size() < 2) {
+        throw std::invalid_argument("A new stitching session needs at least two images.");
+    }
+
+    std::vector<cv::Mat> full_images;
+    std::vector<cv::Mat> seam_images;
+    std::vector<cv::detail::ImageFeatures> features;
+    std::vector<uint64_t> content_hashes;
+    load_stitch_images(image_paths, options_, full_images, seam_images, features, scales_, content_hashes);
+    feature_cache_.reset(new FeatureCache(directory_, stitch_feature_settings(scales_)));
+
+    std::vector<cv::detail::MatchesInfo> pairwise_matches;
+    std::vector<cv::detail::CameraParams> cameras;
+    std::vector<int> indices;
+    const cv::Stitcher::Status status =
+        register_stitch_images(features, options_, pairwise_matches, cameras, warped_image_scale_, indices);
+    if (status != cv::Stitcher::OK) {
+        return status;
+    }
+
+    std::vector<cv::Mat> kept_full;
+    std::vector<cv::Mat> kept_seam;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        const int index = indices[i];
+        SessionImage image;
+        image.path = image_paths[index];
+        image.content_hash = content_hashes[index];
+        image.size = full_images[index].size();
+        image.camera = cameras[i];
+        images_.push_back(image);
+        kept_full.push_back(full_images[index]);
+        kept_seam.push_back(seam_images[index]);
+    }
+    const size_t count = indices.size();
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t j = i + 1; j < count; ++j) {
+            cv::detail::MatchesInfo info = pairwise_matches[i * count + j];
+            if (info.confidence > kStitchPanoConfidence) {
+                info.src_img_idx = static_cast<int>(i);
+                info.dst_img_idx = static_cast<int>(j);
+                matches_.push_back(info);
+            }
+        }
+    }
+    if (count < image_paths.size()) {
+        std::cout << "Stitching session: " << image_paths.size() - count
+                  << " images do not belong to the panorama and were skipped." << std::endl;
+    }
+
+    panorama_roi_ = compose_stitch_panorama(kept_full, kept_seam, cameras, warped_image_scale_, scales_, options_,
+                                            panorama_, panorama_mask_);
+    return cv::Stitcher::OK;
+}
+
+cv::detail::ImageFeatures StitchSession::features_of(size_t index) const {
+    cv::detail::ImageFeatures features;
+    features.img_idx = static_cast<int>(index);
+    const SessionImage& image = images_[index];
+    if (feature_cache_->load(image.content_hash, features)) {
+        return features;
+    }
+    // Entry removed from the session directory: detect again
+    uint64_t content_hash = 0;
+    const cv::Mat full = decode_stitch_image(image.path, &content_hash);
+    if (full.empty()) {
+        throw std::runtime_error("Failed to load image for stitching: " + image.path);
+    }
+    if (content_hash != image.content_hash) {
+        std::cerr << "Warning: " << image.path << " changed since it was added to the stitching session." << std::endl;
+    }
+    compute_stitch_features(cv::ORB::create(kStitchOrbFeatures), full, scales_.work, features);
+    try {
+        feature_cache_->store(image.content_hash, features);
+    } catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << std::endl; // Caching is best effort
+    }
+    return features;
+}
+
+cv::Rect StitchSession::compose_roi(size_t index) const {
+    return stitch_compose_roi(images_[index].size, images_[index].camera, warped_image_scale_, scales_);
+}
+
+bool StitchSession::add_image(const std::string& path, cv::Rect& affected) {
+    uint64_t content_hash = 0;
+    const cv::Mat full = decode_stitch_image(path, &content_hash);
+    if (full.empty()) {
+        throw std::runtime_error("Failed to load image for stitching: " + path);
+    }
+    for (const SessionImage& image : images_) {
+        if (image.content_hash == content_hash) {
+            std::cout << "  Skipped: " << path << " (already in the session as " << image.path << ")" << std::endl;
+            return false;
+        }
+    }
+
+    const size_t index = images_.size();
+    cv::detail::ImageFeatures features;
+    features.img_idx = static_cast<int>(index);
+    if (!feature_cache_->load(content_hash, features)) {
+        compute_stitch_features(cv::ORB::create(kStitchOrbFeatures), full, scales_.work, features);
+        try {
+            feature_cache_->store(content_hash, features);
+        } catch (const std::exception& e) {
+            std::cerr << "Warning: " << e.what() << std::endl; // Caching is best effort
+        }
+    }
+
+    cv::detail::BestOf2NearestMatcher matcher(false, kStitchMatchConfidence);
+    std::vector<cv::detail::MatchesInfo> confident;
+    std::vector<char> tried(index, 0);
+    auto try_match = [&](size_t other) {
+        tried[other] = 1;
+        cv::detail::MatchesInfo info;
+        matcher(features_of(other), features, info);
+        info.src_img_idx = static_cast<int>(other);
+        info.dst_img_idx = static_cast<int>(index);
+        if (info.confidence > kStitchPanoConfidence) {
+            confident.push_back(info);
+        }
+    };
+
+    for (size_t k = 0; k < std::min(kRecentNeighbours, index); ++k) {
+        try_match(index - 1 - k);
+    }
+    if (confident.empty()) {
+        for (size_t k = 0; k < index; ++k) {
+            if (!tried[k]) {
+                try_match(k);
+            }
+        }
+    }
+    if (confident.empty()) {
+        std::cout << "  Skipped: " << path << " (does not overlap the panorama)" << std::endl;
+        return false;
+    }
+
+    // Initial camera from the best match, as HomographyBasedEstimator chains cameras:
+    // H maps the neighbour to the new image, so R_new = R_nb * K_nb^-1 * H^-1 * K_new.
+    // The matcher estimates H on keypoints centred on the image, so the intrinsics in
+    // this product have their principal point at the origin (as in the estimator,
+    // which only adds ppx/ppy after chaining).
+    const cv::detail::MatchesInfo& best = *std::max_element(
+        confident.begin(), confident.end(),
+        [](const cv::detail::MatchesInfo& a, const cv::detail::MatchesInfo& b) { return a.confidence < b.confidence; });
+    const cv::detail::CameraParams& reference = images_[best.src_img_idx].camera;
+    SessionImage image;
+    image.path = path;
+    image.content_hash = content_hash;
+    image.size = full.size();
+    image.camera.focal = reference.focal; // Same camera as the rest of the upload
+    image.camera.aspect = reference.aspect;
+    image.camera.ppx = features.img_size.width * 0.5;
+    image.camera.ppy = features.img_size.height * 0.5;
+    cv::Mat reference_R;
+    reference.R.convertTo(reference_R, CV_64F);
+    auto centred_K = [](const cv::detail::CameraParams& camera) {
+        cv::Mat K = cv::Mat::eye(3, 3, CV_64F);
+        K.at<double>(0, 0) = camera.focal;
+        K.at<double>(1, 1) = camera.focal * camera.aspect;
+        return K;
+    };
+    const cv::Mat R = reference_R * centred_K(reference).inv() * best.H.inv() * centred_K(image.camera);
+    nearest_rotation(R).convertTo(image.camera.R, CV_32F);
+
+    // Match the images whose footprint overlaps the estimated one
+    cv::SphericalWarper warper_creator;
+    cv::Ptr<cv::detail::RotationWarper> warper = warper_creator.create(static_cast<float>(warped_image_scale_));
+    const cv::Rect footprint = warper->warpRoi(features.img_size, stitch_scaled_intrinsics(image.camera, 1.0),
+                                               image.camera.R);
+    std::vector<std::pair<int, size_t>> overlaps; // (overlap area, image)
+    for (size_t k = 0; k < index; ++k) {
+        if (tried[k]) {
+            continue;
+        }
+        const cv::Rect roi = warper->warpRoi(stitch_scaled_size(images_[k].size, scales_.work),
+                                             stitch_scaled_intrinsics(images_[k].camera, 1.0), images_[k].camera.R);
+        const int area = (roi & footprint).area();
+        if (area > 0) {
+            overlaps.emplace_back(area, k);
+        }
+    }
+    std::sort(overlaps.begin(), overlaps.end(), [](const std::pair<int, size_t>& a, const std::pair<int, size_t>& b) {
+        return a.first > b.first;
+    });
+    for (size_t k = 0; k < std::min(kSpatialNeighbours, overlaps.size()); ++k) {
+        try_match(overlaps[k].second);
+    }
+    matcher.collectGarbage();
+
+    std::vector<size_t> neighbours;
+    for (const cv::detail::MatchesInfo& info : confident) {
+        neighbours.push_back(static_cast<size_t>(info.src_img_idx));
+        affected |= compose_roi(static_cast<size_t>(info.src_img_idx)); // Where the neighbour was
+        matches_.push_back(info);
+    }
+    images_.push_back(image);
+
+    const std::vector<size_t> updated = refine_locally(index, neighbours, features);
+    for (size_t k : updated) {
+        affected |= compose_roi(k);
+    }
+    std::cout << "  Added: " << path << " (" << features.keypoints.size() << " features, "
+              << neighbours.size() << " neighbours)" << std::endl;
+    return true;
+}
+
+std::vector<size_t> StitchSession::refine_locally(size_t index, const std::vector<size_t>& neighbours,
+                                                  const cv::detail::ImageFeatures& new_features) {
+    // Anchors: images matched to the neighbours, which hold the rest of the panorama in place
+    std::vector<int> position(images_.size(), -1);
+    for (size_t k : neighbours) {
+        position[k] = 0;
+    }
+    position[index] = 0;
+    std::vector<std::pair<double, size_t>> candidates; // (confidence, image)
+    for (const cv::detail::MatchesInfo& info : matches_) {
+        const size_t src = static_cast<size_t>(info.src_img_idx);
+        const size_t dst = static_cast<size_t>(info.dst_img_idx);
+        if (position[src] >= 0 && position[dst] < 0) {
+            candidates.emplace_back(info.confidence, dst);
+        } else if (position[dst] >= 0 && position[src] < 0) {
+            candidates.emplace_back(info.confidence, src);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b) { return a.first > b.first; });
+    std::vector<size_t> anchors;
+    for (const auto& candidate : candidates) {
+        if (anchors.size() < kAnchorImages && position[candidate.second] < 0) {
+            position[candidate.second] = 0;
+            anchors.push_back(candidate.second);
+        }
+    }
+
+    // Local problem: anchors, then neighbours, then the new image
+    std::vector<size_t> subset = anchors;
+    subset.insert(subset.end(), neighbours.begin(), neighbours.end());
+    subset.push_back(index);
+    const size_t count = subset.size();
+    std::vector<cv::detail::ImageFeatures> features(count);
+    std::vector<cv::detail::CameraParams> cameras(count);
+    for (size_t i = 0; i < count; ++i) {
+        position[subset[i]] = static_cast<int>(i);
+        features[i] = subset[i] == index ? new_features : features_of(subset[i]);
+        features[i].img_idx = static_cast<int>(i);
+        cameras[i] = images_[subset[i]].camera;
+    }
+    std::vector<cv::detail::MatchesInfo> pairwise_matches(count * count);
+    for (const cv::detail::MatchesInfo& info : matches_) {
+        const int a = position[info.src_img_idx];
+        const int b = position[info.dst_img_idx];
+        if (a < 0 || b < 0) {
+            continue;
+        }
+        cv::detail::MatchesInfo forward = info;
+        forward.src_img_idx = a;
+        forward.dst_img_idx = b;
+        pairwise_matches[a * count + b] = forward;
+        pairwise_matches[b * count + a] = reversed_matches(forward);
+    }
+
+    cv::detail::BundleAdjusterRay adjuster;
+    adjuster.setConfThresh(kStitchPanoConfidence);
+    adjuster.setRefinementMask(cv::Mat::ones(3, 3, CV_8U));
+    if (!adjuster(features, pairwise_matches, cameras)) {
+        std::cerr << "Warning: local bundle adjustment failed; keeping the initial camera estimate for "
+                  << images_[index].path << std::endl;
+        return {index};
+    }
+
+    // The adjustment fixes the cameras up to a common rotation: align the result with
+    // the cameras that stay where they are (the anchors, or the neighbours without anchors)
+    const size_t reference_count = anchors.empty() ? neighbours.size() : anchors.size();
+    cv::Mat correlation = cv::Mat::zeros(3, 3, CV_64F);
+    for (size_t i = 0; i < reference_count; ++i) {
+        cv::Mat before;
+        cv::Mat after;
+        images_[subset[i]].camera.R.convertTo(before, CV_64F);
+        cameras[i].R.convertTo(after, CV_64F);
+        correlation += before * after.t();
+    }
+    const cv::Mat alignment = nearest_rotation(correlation);
+
+    std::vector<size_t> updated;
+    for (size_t i = anchors.size(); i < count; ++i) {
+        cv::Mat R;
+        cameras[i].R.convertTo(R, CV_64F);
+        cv::Mat aligned = alignment * R;
+        aligned.convertTo(cameras[i].R, CV_32F);
+        images_[subset[i]].camera = cameras[i];
+        updated.push_back(subset[i]);
+    }
+    return updated;
+}
+
+void StitchSession::recomposite(const cv::Rect& affected) {
+    // Grow the canvas to the new bounds
+    const cv::Rect bounds = panorama_roi_ | affected;
+    if (!(bounds == panorama_roi_)) {
+        cv::Mat pano(bounds.size(), CV_8UC3, cv::Scalar::all(0));
+        cv::Mat mask(bounds.size(), CV_8U, cv::Scalar::all(0));
+        const cv::Rect old_area(panorama_roi_.tl() - bounds.tl(), panorama_roi_.size());
+        panorama_.copyTo(pano(old_area));
+        panorama_mask_.copyTo(mask(old_area));
+        panorama_ = pano;
+        panorama_mask_ = mask;
+        panorama_roi_ = bounds;
+    }
+
+    // Composite the affected area plus a band around it, from every image covering it
+    const cv::Rect region = cv::Rect(affected.x - kBlendMargin, affected.y - kBlendMargin,
+                                     affected.width + 2 * kBlendMargin, affected.height + 2 * kBlendMargin)
+                            & bounds;
+    std::vector<size_t> covering;
+    for (size_t k = 0; k < images_.size(); ++k) {
+        if (!(compose_roi(k) & region).empty()) {
+            covering.push_back(k);
+        }
+    }
+    const int count = static_cast<int>(covering.size());
+    std::vector<cv::Mat> full_images(count);
+    std::vector<cv::Mat> seam_images(count);
+    std::vector<cv::detail::CameraParams> cameras(count);
+    std::vector<char> failed(count, 0);
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            full_images[i] = decode_stitch_image(images_[covering[i]].path);
+            if (full_images[i].empty()) {
+                failed[i] = 1;
+                continue;
+            }
+            cv::resize(full_images[i], seam_images[i], cv::Size(), scales_.seam, scales_.seam, cv::INTER_LINEAR_EXACT);
+        }
+    }, count);
+    for (int i = 0; i < count; ++i) {
+        if (failed[i]) {
+            throw std::runtime_error("Failed to load image for stitching: " + images_[covering[i]].path);
+        }
+        cameras[i] = images_[covering[i]].camera;
+    }
+    std::cout << "Stitching session: recompositing " << region.width << "x" << region.height << " of "
+              << bounds.width << "x" << bounds.height << " from " << count << " images." << std::endl;
+
+    cv::Mat pano;
+    cv::Mat mask;
+    compose_stitch_panorama(full_images, seam_images, cameras, warped_image_scale_, scales_, options_, pano, mask,
+                            region);
+
+    // Inside the affected area the new composite replaces the panorama; in the band
+    // around it, it is cross-faded into the stored pixels to hide exposure steps
+    for (int y = 0; y < region.height; ++y) {
+        const int py = region.y + y;
+        const float wy = fade_weight(py, region.y, affected.y, affected.br().y, region.br().y);
+        const cv::Vec3b* src = pano.ptr<cv::Vec3b>(y);
+        const uchar* src_mask = mask.ptr<uchar>(y);
+        cv::Vec3b* dst = panorama_.ptr<cv::Vec3b>(py - bounds.y) + (region.x - bounds.x);
+        uchar* dst_mask = panorama_mask_.ptr<uchar>(py - bounds.y) + (region.x - bounds.x);
+        for (int x = 0; x < region.width; ++x) {
+            const int px = region.x + x;
+            const float w = std::min(wy, fade_weight(px, region.x, affected.x, affected.br().x, region.br().x));
+            if (!dst_mask[x] || w >= 1.0f) {
+                dst[x] = src_mask[x] ? src[x] : cv::Vec3b(0, 0, 0);
+                dst_mask[x] = src_mask[x];
+            } else if (src_mask[x]) {
+                for (int c = 0; c < 3; ++c) {
+                    dst[x][c] = cv::saturate_cast<uchar>(w * src[x][c] + (1.0f - w) * dst[x][c]);
+                }
+            }
+        }
+    }
+}
+
+void StitchSession::save() const {
+    const std::string temp_path = directory_ + "/session.tmp.yml";
+    {
+        cv::FileStorage fs(temp_path, cv::FileStorage::WRITE);
+        if (!fs.isOpened()) {
+            throw std::runtime_error("Failed to write stitching session: " + temp_path);
+        }
+        fs << "version" << kSessionVersion;
+        fs << "registration_resol" << options_.registration_resol;
+        fs << "seam_estimation_resol" << options_.seam_estimation_resol;
+        fs << "compositing_resol" << options_.compositing_resol;
+        fs << "work_scale" << scales_.work << "seam_scale" << scales_.seam << "compose_scale" << scales_.compose;
+        fs << "warped_image_scale" << warped_image_scale_;
+        fs << "panorama_tl" << panorama_roi_.tl() << "panorama_size" << panorama_roi_.size();
+
+        fs << "images" << "[";
+        for (const SessionImage& image : images_) {
+            fs << "{" << "path" << image.path << "hash" << hash_to_string(image.content_hash) << "size" << image.size;
+            fs << "focal" << image.camera.focal << "aspect" << image.camera.aspect;
+            fs << "ppx" << image.camera.ppx << "ppy" << image.camera.ppy << "R" << image.camera.R << "}";
+        }
+        fs << "]";
+
+        fs << "matches" << "[";
+        for (const cv::detail::MatchesInfo& info : matches_) {
+            fs << "{" << "src" << info.src_img_idx << "dst" << info.dst_img_idx;
+            fs << "confidence" << info.confidence << "num_inliers" << info.num_inliers << "H" << info.H;
+            fs << "pairs" << info.matches << "inliers" << info.inliers_mask << "}";
+        }
+        fs << "]";
+    }
+    if (!cv::imwrite(directory_ + "/panorama.png", panorama_)
+        || !cv::imwrite(directory_ + "/panorama_mask.png", panorama_mask_)) {
+        throw std::runtime_error("Failed to write stitching session panorama in: " + directory_);
+    }
+    // The state file goes last, so it never describes a panorama that was not written
+    const std::string path = directory_ + "/session.yml";
+    std::remove(path.c_str()); // rename() does not replace existing files everywhere
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Failed to write stitching session: " + path);
+    }
+}
+
+void StitchSession::load() {
+    const std::string path = directory_ + "/session.yml";
+    cv::FileStorage fs(path, cv::FileStorage::READ);
+    if (!fs.isOpened() || static_cast<int>(fs["version"]) != kSessionVersion) {
+        throw std::runtime_error("Unsupported or unreadable stitching session: " + path);
+    }
+    fs["registration_resol"] >> options_.registration_resol;
+    fs["seam_estimation_resol"] >> options_.seam_estimation_resol;
+    fs["compositing_resol"] >> options_.compositing_resol;
+    fs["work_scale"] >> scales_.work;
+    fs["seam_scale"] >> scales_.seam;
+    fs["compose_scale"] >> scales_.compose;
+    fs["warped_image_scale"] >> warped_image_scale_;
+    cv::Point panorama_tl;
+    cv::Size panorama_size;
+    fs["panorama_tl"] >> panorama_tl;
+    fs["panorama_size"] >> panorama_size;
+    panorama_roi_ = cv::Rect(panorama_tl, panorama_size);
+
+    for (const cv::FileNode& node : fs["images"]) {
+        SessionImage image;
+        node["path"] >> image.path;
+        image.content_hash = std::stoull(node["hash"].string(), nullptr, 16);
+        node["size"] >> image.size;
+        node["focal"] >> image.camera.focal;
+        node["aspect"] >> image.camera.aspect;
+        node["ppx"] >> image.camera.ppx;
+        node["ppy"] >> image.camera.ppy;
+        node["R"] >> image.camera.R;
+        images_.push_back(image);
+    }
+    for (const cv::FileNode& node : fs["matches"]) {
+        cv::detail::MatchesInfo info;
+        node["src"] >> info.src_img_idx;
+        node["dst"] >> info.dst_img_idx;
+        node["confidence"] >> info.confidence;
+        node["num_inliers"] >> info.num_inliers;
+        node["H"] >> info.H;
+        node["pairs"] >> info.matches;
+        node["inliers"] >> info.inliers_mask;
+        matches_.push_back(info);
+    }
+    feature_cache_.reset(new FeatureCache(directory_, stitch_feature_settings(scales_)));
+
+    panorama_ = cv::imread(directory_ + "/panorama.png", cv::IMREAD_COLOR);
+    panorama_mask_ = cv::imread(directory_ + "/panorama_mask.png", cv::IMREAD_GRAYSCALE);
+    if (panorama_.empty() || panorama_mask_.empty() || panorama_.size() != panorama_roi_.size()) {
+        throw std::runtime_error("Stitching session panorama is missing or does not match: " + directory_);
+    }
+    std::cout << "Stitching session: " << images_.size() << " images, " << matches_.size() << " matched pairs."
+              << std::endl;
+}
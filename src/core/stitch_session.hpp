@@ -0,0 +1,108 @@
+#ifndef AI_SLOP_STITCH_SESSION_HPP
+#define AI_SLOP_STITCH_SESSION_HPP
+
+#include <cstdint>
+#include <memory> // For std::unique_ptr
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>      // For cv::Mat, cv::Rect
+#include <opencv2/stitching.hpp> // For cv::Stitcher::Status
+#include <opencv2/stitching/detail/camera.hpp>
+#include <opencv2/stitching/detail/matchers.hpp>
+#include "feature_cache.hpp"
+#include "stitch_pipeline.hpp"
+#include "stitching.hpp"
+
+/**
+ * @brief A panorama that grows one upload at a time.
+ *
+ * The session lives in a directory holding its state: the camera of every image,
+ * the confident pairwise matches (session.yml), the features of every image
+ * (FeatureCache entries) and the composited panorama with its coverage mask
+ * (panorama.png, panorama_mask.png).
+ *
+ * The first add_images() call registers its images like stitch_images() does. Later
+ * images are added incrementally, without touching the rest of the panorama:
+ * - the new image is matched against the most recently added images, then against
+ *   the images whose footprint overlaps its estimated footprint; all images are only
+ *   tried when none of those match;
+ * - its camera is initialised from the best match and refined by a bundle adjustment
+ *   over the new image, its matched neighbours, and the images matched to those
+ *   neighbours, which hold the rest of the panorama in place;
+ * - only the part of the panorama covered by the new image and the moved neighbours
+ *   is composited again, and cross-faded into the stored panorama.
+ *
+ * The cost of an addition therefore depends on the number of neighbours, not on the
+ * size of the panorama. Incremental additions are not wave corrected, and exposure
+ * gains and seams are estimated from the recomposited images only, so the result
+ * can differ slightly from a full stitch_images() run over the same images.
+ */
+class StitchSession {
+public:
+    /**
+     * @brief Opens the session stored in a directory, or starts a new one.
+     *
+     * @param directory Existing directory holding (or receiving) the session state.
+     * @param options Stage resolutions of a new session. An existing session keeps the
+     *                resolutions it was created with; the feature cache directory is
+     *                ignored because features are stored in the session directory.
+     * @throws std::invalid_argument if the directory is empty or a resolution is zero.
+     * @throws std::runtime_error if an existing session cannot be read.
+     */
+    explicit StitchSession(const std::string& directory, const StitchOptions& options = StitchOptions());
+
+    /**
+     * @brief Adds images to the panorama and saves the session.
+     *
+     * Images already in the session (same file content) and images that do not
+     * overlap the panorama are skipped with a message.
+     *
+     * @param image_paths Paths of the new images; a new session needs at least two.
+     * @return cv::Stitcher::Status OK, or the stage of the initial registration that failed.
+     * @throws std::invalid_argument if a new session gets fewer than two images.
+     * @throws std::runtime_error if an image cannot be loaded or the session cannot be saved.
+     */
+    cv::Stitcher::Status add_images(const std::vector<std::string>& image_paths);
+
+    /**
+     * @brief Writes the session state to its directory.
+     *
+     * @throws std::runtime_error if a file cannot be written.
+     */
+    void save() const;
+
+    size_t image_count() const { return images_.size(); }
+    const cv::Mat& panorama() const { return panorama_; }
+    const cv::Mat& panorama_mask() const { return panorama_mask_; }
+
+private:
+    struct SessionImage {
+        std::string path;
+        uint64_t content_hash = 0;
+        cv::Size size; // Full resolution
+        cv::detail::CameraParams camera;
+    };
+
+    cv::Stitcher::Status start(const std::vector<std::string>& image_paths);
+    bool add_image(const std::string& path, cv::Rect& affected);
+    std::vector<size_t> refine_locally(size_t index, const std::vector<size_t>& neighbours,
+                                       const cv::detail::ImageFeatures& new_features);
+    cv::detail::ImageFeatures features_of(size_t index) const;
+    cv::Rect compose_roi(size_t index) const;
+    void recomposite(const cv::Rect& affected);
+    void load();
+
+    std::string directory_;
+    StitchOptions options_;
+    StitchScales scales_;
+    double warped_image_scale_ = 1.0;
+    std::vector<SessionImage> images_;
+    std::vector<cv::detail::MatchesInfo> matches_; // Confident pairs only, src_img_idx < dst_img_idx
+    std::unique_ptr<FeatureCache> feature_cache_;
+
+    cv::Mat panorama_;
+    cv::Mat panorama_mask_;
+    cv::Rect panorama_roi_; // Bounds of panorama_ in warped coordinates
+};
+
+#endif // AI_SLOP_STITCH_SESSION_HPP
@@ -0,0 +1,430 @@
+#include "stitching.hpp"
+#include "stitch_pipeline.hpp"
+#include <opencv2/core/utils/filesystem.hpp> // For cv::utils::fs::createDirectories
+#include <opencv2/imgcodecs.hpp>             // For cv::imread, cv::imwrite
+#include <opencv2/imgproc.hpp>               // For cv::remap, cv::resize, cv::dilate
+#include <opencv2/stitching/detail/blenders.hpp>
+#include <opencv2/stitching/detail/warpers.hpp> // For cv::detail::SphericalProjector
+#include <algorithm>     // For std::min, std::max
+#include <fstream>       // For the .dzi descriptor
+#include <iostream>      // For status messages
+#include <list>          // For the LRU order of the source cache
+#include <stdexcept>     // For std::runtime_error, std::invalid_argument
+#include <unordered_map>
+
+static const int kBlockTiles = 8;   // Tiles per block edge composited at once
+
+/**
+ * @brief A source image at compositing scale with its seam mask at warped size.
+ */
+struct CachedSource {
+    cv::Mat image;
+    cv::Mat seam_mask; // The dilated seam mask resized as compose_stitch_panorama() resizes it
+};
+
+/**
+ * @brief Least-recently-used cache of the source images at compositing scale.
+ *
+ * Images needed by the current block are pinned while it is composited, so a block
+ * whose sources alone exceed the budget still completes (the budget is then exceeded
+ * for that block only). Each entry also holds the seam mask at warped size, which is
+ * counted against the budget: cropping it from a full cv::resize keeps the seams
+ * bit-identical to the in-memory composite.
+ */
+class SourceCache {
+public:
+    SourceCache(const std::vector<std::string>& paths, const std::vector<cv::Size>& compose_sizes,
+                const std::vector<cv::Mat>& seam_masks, const std::vector<cv::Rect>& rois,
+                double compose_scale, size_t budget_bytes)
+        : paths_(paths), compose_sizes_(compose_sizes), seam_masks_(seam_masks), rois_(rois),
+          compose_scale_(compose_scale), budget_bytes_(budget_bytes) {}
+
+    /**
+     * @brief Returns the given images, decoding the missing ones in parallel.
+     *
+     * @throws std::runtime_error if an image cannot be loaded.
+     */
+    std::vector<CachedSource> acquire(const std::vector<int>& indices);
+
+    size_t peak_bytes() const { return peak_bytes_; }
+    size_t decodes() const { return decodes_; }
+
+private:
+    size_t bytes_of(int index) const {
+        return static_cast<size_t>(compose_sizes_[index].area()) * 3 + static_cast<size_t>(rois_[index].area());
+    }
+
+    const std::vector<std::string>& paths_;
+    const std::vector<cv::Size>& compose_sizes_;
+    const std::vector<cv::Mat>& seam_masks_;
+    const std::vector<cv::Rect>& rois_;
+    double compose_scale_;
+    size_t budget_bytes_;
+    size_t bytes_ = 0;
+    size_t peak_bytes_ = 0;
+    size_t decodes_ = 0;
+    std::list<int> recent_; // Most recently used first
+    std::unordered_map<int, std::pair<CachedSource, std::list<int>::iterator>> entries_;
+};
+
+std::vector<CachedSource> SourceCache::acquire(const std::vector<int>& indices) {
+    std::vector<char> pinned(paths_.size(), 0);
+    std::vector<int> missing;
+    size_t incoming = 0;
+    for (int index : indices) {
+        pinned[index] = 1;
+        auto entry = entries_.find(index);
+        if (entry == entries_.end()) {
+            missing.push_back(index);
+            incoming += bytes_of(index);
+        } else {
+            recent_.splice(recent_.begin(), recent_, entry->second.second);
+        }
+    }
+
+    // Make room before decoding, least recently used first
+    auto it = recent_.end();
+    while (bytes_ + incoming > budget_bytes_ && it != recent_.begin()) {
+        --it;
+        if (!pinned[*it]) {
+            bytes_ -= bytes_of(*it);
+            entries_.erase(*it);
+            it = recent_.erase(it);
+        }
+    }
+
+    const int count = static_cast<int>(missing.size());
+    std::vector<CachedSource> decoded(count);
+    std::vector<char> failed(count, 0); // Exceptions are not thrown across the thread pool
+    cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            const cv::Mat full = decode_stitch_image(paths_[missing[i]]);
+            if (full.empty()) {
+                failed[i] = 1;
+                continue;
+            }
+            if (compose_scale_ != 1.0) {
+                cv::resize(full, decoded[i].image, compose_sizes_[missing[i]], 0, 0, cv::INTER_LINEAR_EXACT);
+            } else {
+                decoded[i].image = full;
+            }
+            cv::resize(seam_masks_[missing[i]], decoded[i].seam_mask, rois_[missing[i]].size(), 0, 0,
+                       cv::INTER_LINEAR_EXACT);
+        }
+    }, count);
+    for (int i = 0; i < count; ++i) {
+        if (failed[i]) {
+            throw std::runtime_error("Failed to load image for stitching: " + paths_[missing[i]]);
+        }
+        recent_.push_front(missing[i]);
+        entries_[missing[i]] = std::make_pair(decoded[i], recent_.begin());
+        bytes_ += bytes_of(missing[i]);
+    }
+    decodes_ += missing.size();
+    peak_bytes_ = std::max(peak_bytes_, bytes_);
+
+    std::vector<CachedSource> images;
+    for (int index : indices) {
+        images.push_back(entries_[index].first);
+    }
+    return images;
+}
+
+/**
+ * @brief Compositing geometry and photometry of the registered images.
+ */
+struct TiledComposite {
+    std::vector<cv::Rect> rois;       // Bounding boxes in the panorama
+    std::vector<cv::Mat> intrinsics;  // At compositing scale
+    std::vector<cv::Mat> rotations;
+    std::vector<cv::Mat> gains;       // Exposure gains from stitch_exposure_gains()
+    std::vector<cv::Mat> seam_masks;  // Dilated seam masks at seam scale
+    float warp_scale = 1.0f;
+    StitchOptions blending;           // Blender selection
+};
+
+/**
+ * @brief Warps an image onto a window of the panorama only.
+ *
+ * Produces the same pixels as the matching window of RotationWarper::warp(), which maps
+ * every panorama pixel back into the source image.
+ */
+static void warp_window(const cv::Mat& image, const cv::Mat& K, const cv::Mat& R, float scale,
+                        const cv::Rect& window, cv::Mat& patch, cv::Mat& patch_mask) {
+    cv::detail::SphericalProjector projector;
+    projector.scale = scale;
+    projector.setCameraParams(K, R);
+
+    cv::Mat xmap(window.size(), CV_32F);
+    cv::Mat ymap(window.size(), CV_32F);
+    patch_mask.create(window.size(), CV_8U);
+    cv::parallel_for_(cv::Range(0, window.height), [&](const cv::Range& rows) {
+        cv::detail::SphericalProjector local = projector;
+        for (int v = rows.start; v < rows.end; ++v) {
+            float* xs = xmap.ptr<float>(v);
+            float* ys = ymap.ptr<float>(v);
+            uchar* valid = patch_mask.ptr<uchar>(v);
+            for (int u = 0; u < window.width; ++u) {
+                local.mapBackward(static_cast<float>(window.x + u), static_cast<float>(window.y + v), xs[u], ys[u]);
+                const int x = cvRound(xs[u]);
+                const int y = cvRound(ys[u]);
+                valid[u] = (x >= 0 && x < image.cols && y >= 0 && y < image.rows) ? 255 : 0;
+            }
+        }
+    });
+    cv::remap(image, patch, xmap, ymap, cv::INTER_LINEAR, cv::BORDER_REFLECT);
+}
+
+/**
+ * @brief Composites one block of the panorama from the images overlapping it.
+ *
+ * The blender covers the block plus a margin, aligned to the panorama's pyramid grid
+ * (stitch_blend_context), so it sees the same neighbourhood and pyramid grid as a full
+ * composite and neighbouring blocks agree along their shared borders.
+ */
+static void composite_block(const TiledComposite& composite, SourceCache& cache, const cv::Rect& block,
+                            const cv::Rect& pano_roi, cv::Mat& pixels, cv::Mat& mask) {
+    const cv::Rect region = stitch_blend_context(block, pano_roi, composite.blending);
+    std::vector<int> overlapping;
+    for (size_t i = 0; i < composite.rois.size(); ++i) {
+        if (!(composite.rois[i] & region).empty()) {
+            overlapping.push_back(static_cast<int>(i));
+        }
+    }
+    if (overlapping.empty()) {
+        pixels = cv::Mat::zeros(block.size(), CV_8UC3);
+        mask = cv::Mat::zeros(block.size(), CV_8U);
+        return;
+    }
+
+    const std::vector<CachedSource> sources = cache.acquire(overlapping);
+    cv::Ptr<cv::detail::Blender> blender = create_stitch_blender(composite.blending);
+    blender->prepare(region);
+    for (size_t k = 0; k < overlapping.size(); ++k) {
+        const int i = overlapping[k];
+        const cv::Rect window = composite.rois[i] & region;
+        const cv::Rect local = window - composite.rois[i].tl();
+        cv::Mat patch;
+        cv::Mat patch_mask;
+        warp_window(sources[k].image, composite.intrinsics[i], composite.rotations[i], composite.warp_scale, window,
+                    patch, patch_mask);
+        apply_stitch_gains(patch, composite.gains[i], composite.rois[i].size(), local);
+        // Restrict the compositing mask to this image's side of the seam
+        patch_mask = sources[k].seam_mask(local) & patch_mask;
+
+        cv::Mat patch_s;
+        patch.convertTo(patch_s, CV_16S);
+        blender->feed(patch_s, patch_mask, window.tl());
+    }
+
+    cv::Mat result;
+    cv::Mat result_mask;
+    blender->blend(result, result_mask);
+    const cv::Rect inner = block - region.tl();
+    result(inner).convertTo(pixels, CV_8U);
+    result_mask(inner).copyTo(mask);
+}
+
+static std::string tile_path(const std::string& files_dir, int level, int col, int row, const std::string& format) {
+    return files_dir + "/" + std::to_string(level) + "/" + std::to_string(col) + "_" + std::to_string(row) + "."
+           + format;
+}
+
+/**
+ * @brief Writes one tile; PNG tiles carry the coverage mask as alpha.
+ */
+static void write_tile(const std::string& path, const cv::Mat& pixels, const cv::Mat& mask, bool alpha) {
+    cv::Mat tile = pixels;
+    if (alpha) {
+        std::vector<cv::Mat> channels;
+        cv::split(pixels, channels);
+        channels.push_back(mask);
+        cv::merge(channels, tile);
+    }
+    if (!cv::imwrite(path, tile)) {
+        throw std::runtime_error("Failed to write panorama tile: " + path);
+    }
+}
+
+/**
+ * @brief Builds one pyramid level by halving the tiles of the level above, four at a time.
+ *
+ * @param level_size Size of the level to build; the level above is twice as large.
+ */
+static void build_pyramid_level(const std::string& files_dir, int level, const cv::Size& level_size,
+                                const cv::Size& child_size, const StitchTileOptions& tile_options) {
+    const int tile = tile_options.tile_size;
+    const bool alpha = tile_options.format == "png";
+    const int cols = (level_size.width + tile - 1) / tile;
+    const int rows = (level_size.height + tile - 1) / tile;
+    std::vector<char> failed(static_cast<size_t>(cols) * rows, 0);
+    cv::parallel_for_(cv::Range(0, cols * rows), [&](const cv::Range& range) {
+        for (int t = range.start; t < range.end; ++t) {
+            const int col = t % cols;
+            const int row = t / cols;
+            // Area of the four children, clipped to the level above
+            const int x0 = 2 * col * tile;
+            const int y0 = 2 * row * tile;
+            const cv::Size area(std::min(2 * tile, child_size.width - x0), std::min(2 * tile, child_size.height - y0));
+            cv::Mat canvas = cv::Mat::zeros(area, alpha ? CV_8UC4 : CV_8UC3);
+            for (int dy = 0; dy < 2; ++dy) {
+                for (int dx = 0; dx < 2; ++dx) {
+                    if (dx * tile >= area.width || dy * tile >= area.height) {
+                        continue;
+                    }
+                    const cv::Mat child = cv::imread(tile_path(files_dir, level + 1, 2 * col + dx, 2 * row + dy,
+                                                               tile_options.format),
+                                                     cv::IMREAD_UNCHANGED);
+                    if (child.empty() || child.type() != canvas.type()) {
+                        failed[t] = 1;
+                        continue;
+                    }
+                    child.copyTo(canvas(cv::Rect(dx * tile, dy * tile, child.cols, child.rows)));
+                }
+            }
+            cv::Mat halved;
+            cv::resize(canvas, halved, cv::Size((area.width + 1) / 2, (area.height + 1) / 2), 0, 0, cv::INTER_AREA);
+            if (!cv::imwrite(tile_path(files_dir, level, col, row, tile_options.format), halved)) {
+                failed[t] = 1;
+            }
+        }
+    });
+    for (char f : failed) {
+        if (f) {
+            throw std::runtime_error("Failed to build pyramid level " + std::to_string(level) + " in " + files_dir);
+        }
+    }
+}
+
+cv::Stitcher::Status stitch_images_tiled(const std::vector<std::string>& image_paths,
+                                         const std::string& dzi_path,
+                                         const StitchOptions& options,
+                                         const StitchTileOptions& tile_options) {
+    if (image_paths.size() < 2) {
+        throw std::runtime_error("Stitching requires at least two input images.");
+    }
+    if (options.registration_resol == 0 || options.seam_estimation_resol == 0 || options.compositing_resol == 0) {
+        throw std::invalid_argument("Stitching resolutions must be positive megapixels or negative for the original resolution.");
+    }
+    if (tile_options.tile_size <= 0) {
+        throw std::invalid_argument("Tile size must be positive.");
+    }
+    if (tile_options.format != "png" && tile_options.format != "jpg") {
+        throw std::invalid_argument("Tile format must be png or jpg.");
+    }
+
+    std::cout << "Loading images and extracting features for stitching..." << std::endl;
+    std::vector<cv::Mat> full_images; // Left empty: sources are decoded again per block
+    std::vector<cv::Mat> seam_images;
+    std::vector<cv::detail::ImageFeatures> features;
+    std::vector<uint64_t> content_hashes;
+    std::vector<cv::Size> image_sizes;
+    StitchScales scales;
+    load_stitch_images(image_paths, options, full_images, seam_images, features, scales, content_hashes, &image_sizes);
+
+    std::cout << "Attempting to stitch images..." << std::endl;
+    std::vector<cv::detail::MatchesInfo> pairwise_matches;
+    std::vector<cv::detail::CameraParams> cameras;
+    std::vector<int> indices;
+    double warped_image_scale = 1.0;
+    cv::Stitcher::Status status = register_stitch_images(features, options, pairwise_matches, cameras, warped_image_scale, indices);
+    if (status != cv::Stitcher::OK) {
+        return status;
+    }
+    std::vector<std::string> paths;
+    std::vector<cv::Size> compose_sizes;
+    std::vector<cv::Mat> kept_seam;
+    for (int index : indices) {
+        paths.push_back(image_paths[index]);
+        compose_sizes.push_back(stitch_scaled_size(image_sizes[index], scales.compose));
+        kept_seam.push_back(seam_images[index]);
+    }
+    seam_images.clear();
+
+    // Seams and exposure gains are global, estimated once at seam scale
+    StitchSeams seams = find_stitch_seams(kept_seam, cameras, warped_image_scale, scales, options);
+    TiledComposite composite;
+    composite.gains = stitch_exposure_gains(seams, options, indices.size());
+    const double compose_work_aspect = scales.compose / scales.work;
+    composite.warp_scale = static_cast<float>(warped_image_scale * compose_work_aspect);
+    composite.blending = options;
+    cv::Rect pano_roi;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        composite.rois.push_back(stitch_compose_roi(image_sizes[indices[i]], cameras[i], warped_image_scale, scales));
+        composite.intrinsics.push_back(stitch_scaled_intrinsics(cameras[i], compose_work_aspect));
+        composite.rotations.push_back(cameras[i].R);
+        cv::Mat dilated;
+        cv::dilate(seams.masks[i], dilated, cv::Mat());
+        composite.seam_masks.push_back(dilated);
+        pano_roi = i == 0 ? composite.rois[i] : (pano_roi | composite.rois[i]);
+    }
+    seams.masks.clear();
+
+    // DeepZoom layout: level max_level is the full panorama, each level below halves it
+    const std::string base = dzi_path.size() > 4 && dzi_path.compare(dzi_path.size() - 4, 4, ".dzi") == 0
+                                 ? dzi_path.substr(0, dzi_path.size() - 4)
+                                 : dzi_path;
+    const std::string files_dir = base + "_files";
+    int max_level = 0;
+    while ((1 << max_level) < std::max(pano_roi.width, pano_roi.height)) {
+        ++max_level;
+    }
+    for (int level = 0; level <= max_level; ++level) {
+        const std::string level_dir = files_dir + "/" + std::to_string(level);
+        if (!cv::utils::fs::createDirectories(level_dir)) {
+            throw std::runtime_error("Failed to create tile directory: " + level_dir);
+        }
+    }
+
+    const int tile = tile_options.tile_size;
+    const int block_size = kBlockTiles * tile;
+    const int blocks_x = (pano_roi.width + block_size - 1) / block_size;
+    const int blocks_y = (pano_roi.height + block_size - 1) / block_size;
+    const bool columns_first = pano_roi.width >= pano_roi.height; // Wide panoramas: sweep down each column
+    const bool alpha = tile_options.format == "png";
+    std::cout << "Compositing " << pano_roi.width << "x" << pano_roi.height << " panorama in " << blocks_x * blocks_y
+              << " blocks of " << block_size << " px..." << std::endl;
+
+    SourceCache cache(paths, compose_sizes, composite.seam_masks, composite.rois, scales.compose, tile_options.memory_budget_mb * 1024 * 1024);
+    for (int b = 0; b < blocks_x * blocks_y; ++b) {
+        const int bx = columns_first ? b / blocks_y : b % blocks_x;
+        const int by = columns_first ? b % blocks_y : b / blocks_x;
+        const cv::Rect block(pano_roi.x + bx * block_size, pano_roi.y + by * block_size,
+                             std::min(block_size, pano_roi.width - bx * block_size),
+                             std::min(block_size, pano_roi.height - by * block_size));
+        cv::Mat pixels;
+        cv::Mat mask;
+        composite_block(composite, cache, block, pano_roi, pixels, mask);
+
+        for (int ty = 0; ty * tile < block.height; ++ty) {
+            for (int tx = 0; tx * tile < block.width; ++tx) {
+                const cv::Rect cell(tx * tile, ty * tile, std::min(tile, block.width - tx * tile),
+                                    std::min(tile, block.height - ty * tile));
+                write_tile(tile_path(files_dir, max_level, bx * kBlockTiles + tx, by * kBlockTiles + ty,
+                                     tile_options.format),
+                           pixels(cell), mask(cell), alpha);
+            }
+        }
+    }
+
+    cv::Size child_size = pano_roi.size();
+    for (int level = max_level - 1; level >= 0; --level) {
+        const cv::Size level_size((child_size.width + 1) / 2, (child_size.height + 1) / 2);
+        build_pyramid_level(files_dir, level, level_size, child_size, tile_options);
+        child_size = level_size;
+    }
+
+    // The descriptor goes last: its presence marks a complete pyramid
+    std::ofstream dzi(dzi_path);
+    dzi << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" TileSize=\"" << tile
+        << "\" Overlap=\"0\" Format=\"" << tile_options.format << "\">\n"
+        << "  <Size Width=\"" << pano_roi.width << "\" Height=\"" << pano_roi.height << "\"/>\n"
+        << "</Image>\n";
+    if (!dzi) {
+        throw std::runtime_error("Failed to write DeepZoom descriptor: " + dzi_path);
+    }
+    std::cout << "Wrote " << max_level + 1 << " pyramid levels to " << files_dir << " (" << cache.decodes()
+              << " source decodes, peak source cache " << cache.peak_bytes() / (1024 * 1024) << " MB)." << std::endl;
+    return cv::Stitcher::OK;
+}
@@ -1,39 +1,210 @@
 #include "stitching.hpp"
-#include <opencv2/imgcodecs.hpp> // For cv::imread
-#include <stdexcept>            // For std::runtime_error
+#include "stitch_pipeline.hpp"
+#include <stdexcept>            // For std::runtime_error, std::invalid_argument
 #include <iostream>             // For status messages
+#include <fstream>              // For reading GPS positions
+#include <sstream>              // For parsing GPS positions
+#include <limits>               // For std::numeric_limits
+#include <algorithm>            // For std::replace
+#include <cmath>                // For std::isnan
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>              // For GetProcessMemoryInfo
+#else
+#include <sys/resource.h>       // For getrusage
+#endif
 
-cv::Stitcher::Status stitch_images(const std::vector<std::string>& image_paths, cv::Mat& output_pano) {
-    if (image_paths.size() < 2) {
-        throw std::runtime_error("Stitching requires at least two input images.");
+double peak_memory_mb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
     }
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0); // Bytes on macOS
+#else
+    return usage.ru_maxrss / 1024.0;            // Kilobytes on Linux and the BSDs
+#endif
+#endif
+}
+
+StitchOptions stitch_options_for_preset(const std::string& preset) {
+    StitchOptions options; // Balanced: the cv::Stitcher PANORAMA defaults
+    if (preset == "fast") {
+        options.registration_resol = 0.3;
+        options.seam_estimation_resol = 0.05;
+        options.compositing_resol = 1.0;
+        options.seam_finder = StitchSeamFinder::Voronoi;
+        options.exposure = StitchExposure::Gain;
+        options.blender = StitchBlender::Feather;
+    } else if (preset == "quality") {
+        options.registration_resol = 1.0;
+        options.seam_estimation_resol = 0.2;
+        options.compositing_resol = kStitchOriginalResolution;
+        options.blend_bands = 7;
+    } else if (preset != "balanced") {
+        throw std::invalid_argument("Unknown stitching preset: " + preset + " (expected fast, balanced or quality)");
+    }
+    return options;
+}
+
+/**
+ * @brief File name part of a path.
+ */
+static std::string file_name_of(const std::string& path) {
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
 
-    std::vector<cv::Mat> input_images;
-    input_images.reserve(image_paths.size()); // Reserve space for efficiency
+std::vector<cv::Point2d> read_stitch_gps_positions(const std::string& gps_path,
+                                                   const std::vector<std::string>& image_paths) {
+    std::ifstream in(gps_path);
+    if (!in.is_open()) {
+        throw std::runtime_error("Failed to open GPS positions file: " + gps_path);
+    }
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<cv::Point2d> positions(image_paths.size(), cv::Point2d(nan, nan));
 
-    std::cout << "Loading images for stitching..." << std::endl;
-    for (const std::string& path : image_paths) {
-        cv::Mat img = cv::imread(path, cv::IMREAD_COLOR);
-        if (img.empty()) {
-            // You might want to skip the problematic image or throw an error
-            // Throwing an error is safer to indicate a definite problem.
-            throw std::runtime_error("Failed to load image for stitching: " + path);
+    std::string line;
+    size_t located = 0;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream fields(line);
+        std::string path;
+        cv::Point2d position;
+        if (!(fields >> path >> position.x >> position.y)) {
+            continue; // Header or incomplete line
+        }
+        for (size_t i = 0; i < image_paths.size(); ++i) {
+            if (image_paths[i] == path || file_name_of(image_paths[i]) == file_name_of(path)) {
+                located += std::isnan(positions[i].x) ? 1 : 0;
+                positions[i] = position;
+            }
         }
-        input_images.push_back(img);
-        std::cout << "  Loaded: " << path << std::endl;
+    }
+    std::cout << "GPS positions: " << located << " of " << image_paths.size() << " images located." << std::endl;
+    return positions;
+}
+
+cv::Stitcher::Status stitch_images(const std::vector<std::string>& image_paths, cv::Mat& output_pano,
+                                   const StitchOptions& options, StitchTimings* timings) {
+    if (image_paths.size() < 2) {
+        throw std::runtime_error("Stitching requires at least two input images.");
+    }
+    if (options.registration_resol == 0 || options.seam_estimation_resol == 0 || options.compositing_resol == 0) {
+        throw std::invalid_argument("Stitching resolutions must be positive megapixels or negative for the original resolution.");
+    }
+
+    std::cout << "Loading images and extracting features for stitching..." << std::endl;
+    std::vector<cv::Mat> full_images;
+    std::vector<cv::Mat> seam_images;
+    std::vector<cv::detail::ImageFeatures> features;
+    std::vector<uint64_t> content_hashes;
+    StitchScales scales;
+    const int64 start = cv::getTickCount();
+    load_stitch_images(image_paths, options, full_images, seam_images, features, scales, content_hashes);
+    if (timings) {
+        timings->features += (cv::getTickCount() - start) / cv::getTickFrequency();
     }
 
     std::cout << "Attempting to stitch images..." << std::endl;
+    std::vector<cv::detail::MatchesInfo> pairwise_matches;
+    std::vector<cv::detail::CameraParams> cameras;
+    std::vector<int> indices;
+    double warped_image_scale = 1.0;
+    cv::Stitcher::Status status =
+        register_stitch_images(features, options, pairwise_matches, cameras, warped_image_scale, indices, timings);
+    if (status != cv::Stitcher::OK) {
+        return status;
+    }
+    // Drop the images that do not belong to the panorama
+    std::vector<cv::Mat> kept_full;
+    std::vector<cv::Mat> kept_seam;
+    for (int index : indices) {
+        kept_full.push_back(full_images[index]);
+        kept_seam.push_back(seam_images[index]);
+    }
+
+    cv::Mat pano_mask;
+    compose_stitch_panorama(kept_full, kept_seam, cameras, warped_image_scale, scales, options, output_pano, pano_mask,
+                            cv::Rect(), timings);
+    return cv::Stitcher::OK; // Return the status code
+}
+
+std::vector<StitchMatchBenchmark> benchmark_stitch_matching(const std::vector<std::string>& image_paths,
+                                                            const StitchOptions& options) {
+    if (image_paths.size() < 2) {
+        throw std::runtime_error("Stitching requires at least two input images.");
+    }
+    if (options.registration_resol == 0 || options.seam_estimation_resol == 0 || options.compositing_resol == 0) {
+        throw std::invalid_argument("Stitching resolutions must be positive megapixels or negative for the original resolution.");
+    }
 
-    // Create a Stitcher instance
-    // Use default mode (PANORAMA) or specify SCANS for potentially different behavior
-    cv::Ptr<cv::Stitcher> stitcher = cv::Stitcher::create(cv::Stitcher::PANORAMA);
-    // Potential alternative: cv::Stitcher::create(cv::Stitcher::SCANS);
+    std::cout << "Loading images and extracting features for the matching benchmark..." << std::endl;
+    std::vector<cv::Mat> full_images;
+    std::vector<cv::Mat> seam_images;
+    std::vector<cv::detail::ImageFeatures> features;
+    std::vector<uint64_t> content_hashes;
+    std::vector<cv::Size> image_sizes; // Full images are not needed for matching
+    StitchScales scales;
+    load_stitch_images(image_paths, options, full_images, seam_images, features, scales, content_hashes, &image_sizes);
 
-    // Attempt to stitch the images
-    cv::Stitcher::Status status = stitcher->stitch(input_images, output_pano);
+    StitchOptions all_options = options;
+    all_options.match_range = 0;
+    all_options.gps_positions.clear();
+    all_options.indexed_matching = false;
+    StitchOptions range_options = options;
+    if (range_options.match_range <= 0 && range_options.gps_positions.empty()) {
+        range_options.match_range = 5;
+    }
+    range_options.indexed_matching = false;
+    StitchOptions indexed_options = range_options;
+    indexed_options.indexed_matching = true;
 
-    return status; // Return the status code
+    // Matches the first count images with the given options; returns seconds and the pair count
+    auto time_matching = [&](int count, const StitchOptions& match_options, size_t& pairs) {
+        const std::vector<cv::detail::ImageFeatures> subset(features.begin(), features.begin() + count);
+        const cv::Mat mask = stitch_match_mask(subset.size(), match_options);
+        pairs = mask.empty() ? static_cast<size_t>(count) * (count - 1) / 2 : static_cast<size_t>(cv::countNonZero(mask));
+        cv::Ptr<cv::detail::FeaturesMatcher> matcher = create_stitch_matcher(match_options);
+        std::vector<cv::detail::MatchesInfo> pairwise_matches;
+        const int64 start = cv::getTickCount();
+        (*matcher)(subset, pairwise_matches, mask.empty() ? cv::UMat() : mask.getUMat(cv::ACCESS_READ));
+        return (cv::getTickCount() - start) / cv::getTickFrequency();
+    };
+
+    const int total = static_cast<int>(features.size());
+    std::vector<int> counts;
+    for (int count : {10, 20, 50, 100, 200, 500}) {
+        if (count < total) {
+            counts.push_back(count);
+        }
+    }
+    counts.push_back(total);
+
+    std::vector<StitchMatchBenchmark> results;
+    for (int count : counts) {
+        StitchMatchBenchmark result;
+        result.images = count;
+        size_t indexed_pairs = 0;
+        result.all_seconds = time_matching(count, all_options, result.all_pairs);
+        result.range_seconds = time_matching(count, range_options, result.range_pairs);
+        result.indexed_seconds = time_matching(count, indexed_options, indexed_pairs);
+        results.push_back(result);
+    }
+    return results;
 }
 
 std::string stitcher_status_to_string(cv::Stitcher::Status status) {
@@ -49,4 +220,4 @@ std::string stitcher_status_to_string(cv::Stitcher::Status status) {
         default:
             return "Error: Unknown stitching error";
     }
-} 
\ No newline at end of file
+}
@@ -6,19 +6,219 @@
 #include <opencv2/core.hpp> // For cv::Mat
 #include <opencv2/stitching.hpp> // For cv::Stitcher
 
+/**
+ * @brief Resolution value meaning "use the original image resolution".
+ */
+constexpr double kStitchOriginalResolution = -1.0;
+
+/**
+ * @brief Seam finder run at seam-estimation scale.
+ */
+enum class StitchSeamFinder {
+    None,    ///< No seams: overlaps are blended over their whole extent
+    Voronoi, ///< Seams halfway between image centres (cheapest)
+    Dp,      ///< Dynamic-programming seams along colour differences
+    GraphCut ///< Graph-cut seams along colour differences (cv::Stitcher default, slowest)
+};
+
+/**
+ * @brief Exposure compensator estimated at seam-estimation scale.
+ */
+enum class StitchExposure {
+    None,     ///< No compensation
+    Gain,     ///< One gain per image
+    Blocks,   ///< Gains per 32x32 block (cv::Stitcher default)
+    Channels  ///< One gain per image and colour channel
+};
+
+/**
+ * @brief Blender of the warped images.
+ */
+enum class StitchBlender {
+    Feather,  ///< Weighted average near the seams (cheapest)
+    MultiBand ///< Laplacian pyramid blending (cv::Stitcher default)
+};
+
+/**
+ * @brief Settings of the stitching pipeline.
+ *
+ * Resolutions are in megapixels, as in cv::Stitcher (registrationResol,
+ * seamEstimationResol, compositingResol); kStitchOriginalResolution keeps the input
+ * resolution. The defaults are cv::Stitcher's PANORAMA defaults.
+ *
+ * By default every image pair is matched, which grows quadratically with the number
+ * of images. For ordered captures (sweeps, drone passes) match_range and the GPS
+ * positions limit matching to the pairs that can overlap; see stitch_match_mask().
+ * An incremental StitchSession uses them for its first images only.
+ */
+struct StitchOptions {
+    double registration_resol = 0.6;                           ///< Feature detection and matching
+    double seam_estimation_resol = 0.1;                        ///< Seam finding and exposure compensation
+    double compositing_resol = kStitchOriginalResolution;      ///< Warping and blending of the output
+    std::string feature_cache_dir;                             ///< Feature cache directory (empty: no cache)
+    int match_range = 0;                                       ///< Match each image with the next N inputs only (0: all pairs)
+    std::vector<cv::Point2d> gps_positions;                    ///< (latitude, longitude) per input in degrees; NaN if unknown
+    double gps_radius_m = 0;                                   ///< Also match inputs taken this close (needs gps_positions)
+    bool indexed_matching = false;                             ///< One FLANN/LSH index per image instead of one per pair
+    StitchSeamFinder seam_finder = StitchSeamFinder::GraphCut; ///< Seam estimation
+    StitchExposure exposure = StitchExposure::Blocks;          ///< Exposure compensation
+    StitchBlender blender = StitchBlender::MultiBand;          ///< Blending
+    int blend_bands = 5;                                       ///< Pyramid levels of the multi-band blender
+    bool strip_blending = true;                                ///< Blend vertical strips in parallel, one blender each
+};
+
+/**
+ * @brief Wall-clock seconds spent in each stage of a stitch.
+ */
+struct StitchTimings {
+    double features = 0;     ///< Decoding and feature extraction
+    double matching = 0;     ///< Pairwise matching
+    double estimation = 0;   ///< Camera estimation, bundle adjustment and wave correction
+    double exposure = 0;     ///< Warping at seam scale and exposure compensation
+    double seams = 0;        ///< Seam finding
+    double warping = 0;      ///< Warping at compositing scale, gains and seam masks applied
+    double blending = 0;     ///< Blending
+};
+
+/**
+ * @brief Peak resident memory of the process so far, in megabytes.
+ *
+ * Read from getrusage (ru_maxrss) on POSIX systems and GetProcessMemoryInfo
+ * (PeakWorkingSetSize) on Windows. The value covers the whole process, so compare
+ * presets or modes in separate runs.
+ *
+ * @return double Peak resident set size in MB, or 0 if the platform does not report it.
+ */
+double peak_memory_mb();
+
+/**
+ * @brief Returns the options of a speed preset.
+ *
+ * - fast: 0.3 MP registration, 0.05 MP seams, 1 MP composite; Voronoi seams, one
+ *   gain per image and feather blending (previews)
+ * - balanced: the cv::Stitcher defaults (0.6 MP, 0.1 MP, original resolution; graph-cut
+ *   seams, block gains, 5-band blending)
+ * - quality: 1 MP registration, 0.2 MP seams, original resolution; graph-cut seams,
+ *   block gains, 7-band blending
+ *
+ * @param preset "fast", "balanced" or "quality".
+ * @throws std::invalid_argument for an unknown preset name.
+ */
+StitchOptions stitch_options_for_preset(const std::string& preset);
+
+/**
+ * @brief Reads the GPS positions of the input images from a text file.
+ *
+ * Each line holds an image path followed by its latitude and longitude in degrees,
+ * separated by commas or whitespace (as exported by e.g. exiftool -csv -n -GPSLatitude
+ * -GPSLongitude); empty lines, lines starting with '#' and lines without coordinates
+ * (such as a CSV header) are skipped. Lines are matched to the inputs by full path,
+ * then by file name.
+ *
+ * @param gps_path Path of the positions file.
+ * @param image_paths Paths of the input images.
+ * @return std::vector<cv::Point2d> (latitude, longitude) per input; NaN for inputs not listed.
+ * @throws std::runtime_error if the file cannot be read.
+ */
+std::vector<cv::Point2d> read_stitch_gps_positions(const std::string& gps_path,
+                                                   const std::vector<std::string>& image_paths);
+
 /**
  * @brief Attempts to stitch multiple input images into a panorama.
  *
- * This function takes a list of image file paths, loads them, and uses
- * OpenCV's Stitcher class to create a panorama.
+ * This function takes a list of image file paths, loads them, and runs the same
+ * pipeline as OpenCV's Stitcher class (PANORAMA mode) to create a panorama.
+ * Images are decoded in parallel on OpenCV's thread pool (bounded by
+ * cv::setNumThreads), and each image's features are extracted as soon as it is
+ * decoded. Results keep the input order.
  *
  * @param image_paths A vector of strings containing the paths to the input images.
  * @param output_pano Reference to a cv::Mat where the resulting panorama will be stored.
+ * @param options Stage resolutions, compositing stages and the feature cache directory
+ *                (see StitchOptions). With a feature cache (an existing directory, see
+ *                FeatureCache), re-stitching unchanged images skips feature detection.
+ * @param timings If given, receives the time spent in each stage.
  * @return cv::Stitcher::Status The status code indicating the success or failure of the stitching process.
  *         (cv::Stitcher::OK indicates success).
  * @throws std::runtime_error if fewer than two image paths are provided or if images cannot be loaded.
+ * @throws std::invalid_argument if a resolution is zero.
+ */
+cv::Stitcher::Status stitch_images(const std::vector<std::string>& image_paths, cv::Mat& output_pano,
+                                   const StitchOptions& options = StitchOptions(),
+                                   StitchTimings* timings = nullptr);
+
+/**
+ * @brief Pair-matching time for one image count.
+ */
+struct StitchMatchBenchmark {
+    int images = 0;              ///< Number of images matched (the first inputs)
+    size_t all_pairs = 0;        ///< Pairs matched without a range
+    size_t range_pairs = 0;      ///< Pairs selected by the range and GPS positions
+    double all_seconds = 0;      ///< All pairs, index per pair
+    double range_seconds = 0;    ///< Selected pairs, index per pair
+    double indexed_seconds = 0;  ///< Selected pairs, index per image
+};
+
+/**
+ * @brief Times pair matching for growing prefixes of the inputs (10, 20, 50, 100, 200, 500 images).
+ *
+ * Features are extracted once (through the feature cache, if set). Each prefix is then
+ * matched three ways: all pairs, the pairs selected by the options' range and GPS
+ * positions (a range of 5 if neither is set), and those pairs with one index per image.
+ * Counts above the number of inputs are skipped, and the input count itself is timed
+ * when it is not one of the steps.
+ *
+ * @param image_paths Paths to the input images; at least two.
+ * @param options Stage resolutions, feature cache and pair selection.
+ * @return std::vector<StitchMatchBenchmark> One entry per image count, in increasing order.
+ * @throws std::runtime_error if fewer than two image paths are provided or if images cannot be loaded.
+ */
+std::vector<StitchMatchBenchmark> benchmark_stitch_matching(const std::vector<std::string>& image_paths,
+                                                            const StitchOptions& options = StitchOptions());
+
+/**
+ * @brief Layout of a tiled (out-of-core) panorama output.
+ */
+struct StitchTileOptions {
+    int tile_size = 256;             ///< Edge of the DeepZoom tiles in pixels
+    std::string format = "png";      ///< Tile format: png (with transparency) or jpg
+    size_t memory_budget_mb = 2048;  ///< Budget for decoded source images (and their seam masks) kept between blocks
+};
+
+/**
+ * @brief Stitches images into a DeepZoom tile pyramid without holding the panorama in memory.
+ *
+ * Registration, seams and exposure gains are computed as in stitch_images(), but full
+ * images are not kept after feature extraction. The panorama is then composited block
+ * by block (8x8 tiles plus a blending margin). Only the source images overlapping the
+ * current block are decoded, each is warped only over the block, and finished tiles go
+ * straight to disk. Decoded sources are kept in a least-recently-used cache bounded by
+ * the memory budget. Blocks are visited along the shorter panorama axis first, so
+ * neighbouring blocks reuse the same sources. Lower pyramid levels are built from the
+ * tiles already written, four tiles at a time.
+ *
+ * Seam masks and gains are resampled exactly as the in-memory composite resamples them,
+ * so the full-resolution level matches stitch_images() pixel for pixel. Block gains are
+ * the one exception: OpenCV's vectorised resize may round the gain map's last bit
+ * differently, which moves one or two pixels in 10^5 by up to two levels.
+ *
+ * The output is a .dzi descriptor plus a directory with the same name and a "_files"
+ * suffix. That directory holds one subdirectory per level with col_row tiles
+ * (overlap 0), as read by OpenSeadragon and other DeepZoom viewers.
+ *
+ * @param image_paths Paths to the input image files. Must contain at least two paths.
+ * @param dzi_path Path of the .dzi descriptor to write.
+ * @param options Stage resolutions and the feature cache directory (see StitchOptions).
+ * @param tile_options Tile size, tile format and memory budget.
+ * @return cv::Stitcher::Status OK, or the registration stage that failed.
+ * @throws std::runtime_error if fewer than two image paths are provided, an image cannot
+ *         be loaded or the output cannot be written.
+ * @throws std::invalid_argument if a resolution is zero or the tile options are invalid.
  */
-cv::Stitcher::Status stitch_images(const std::vector<std::string>& image_paths, cv::Mat& output_pano);
+cv::Stitcher::Status stitch_images_tiled(const std::vector<std::string>& image_paths,
+                                         const std::string& dzi_path,
+                                         const StitchOptions& options = StitchOptions(),
+                                         const StitchTileOptions& tile_options = StitchTileOptions());
 
 
 /**
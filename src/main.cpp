@@ -16,6 +16,8 @@
 #include "core/brightness.hpp"
 #include "core/canny.hpp"
 #include "core/stitching.hpp"
+#include "core/stitch_session.hpp"
+#include "core/stitch_rig.hpp"
 
 // Include advanced function headers
 #include "advanced/video_processing.hpp"
@@ -23,6 +25,47 @@
 #include "advanced/object_detection.hpp"
 #include "advanced/inpainting.hpp"
 
+/**
+ * @brief Builds the stitching options from the preset, then the explicit overrides.
+ *
+ * @param args Parsed command-line arguments of a stitch or video-stitch operation.
+ * @return StitchOptions The options to pass to the stitching functions.
+ */
+static StitchOptions stitch_options_from_arguments(const ParsedArguments& args) {
+    StitchOptions stitch_options = stitch_options_for_preset(args.stitch_preset.value_or("balanced"));
+    stitch_options.registration_resol = args.registration_resol.value_or(stitch_options.registration_resol);
+    stitch_options.seam_estimation_resol = args.seam_resol.value_or(stitch_options.seam_estimation_resol);
+    stitch_options.compositing_resol = args.compositing_resol.value_or(stitch_options.compositing_resol);
+    stitch_options.feature_cache_dir = args.feature_cache_dir.value_or("");
+    stitch_options.match_range = args.stitch_match_range;
+    stitch_options.indexed_matching = args.stitch_indexed_matching;
+    if (args.stitch_gps_file.has_value()) {
+        stitch_options.gps_positions = read_stitch_gps_positions(args.stitch_gps_file.value(), args.input_files);
+        stitch_options.gps_radius_m = args.stitch_gps_radius_m;
+    }
+    // Compositing stages (names validated by the parser)
+    if (args.seam_finder.has_value()) {
+        const std::string& name = args.seam_finder.value();
+        stitch_options.seam_finder = name == "none" ? StitchSeamFinder::None
+                                     : name == "voronoi" ? StitchSeamFinder::Voronoi
+                                     : name == "dp" ? StitchSeamFinder::Dp
+                                     : StitchSeamFinder::GraphCut;
+    }
+    if (args.exposure.has_value()) {
+        const std::string& name = args.exposure.value();
+        stitch_options.exposure = name == "none" ? StitchExposure::None
+                                  : name == "gain" ? StitchExposure::Gain
+                                  : name == "channels" ? StitchExposure::Channels
+                                  : StitchExposure::Blocks;
+    }
+    if (args.blender.has_value()) {
+        stitch_options.blender = args.blender.value() == "feather" ? StitchBlender::Feather : StitchBlender::MultiBand;
+    }
+    stitch_options.blend_bands = args.blend_bands.value_or(stitch_options.blend_bands);
+    stitch_options.strip_blending = args.strip_blending;
+    return stitch_options;
+}
+
 /**
  * @brief Main entry point for the AI_SLOP application.
  *
@@ -53,9 +96,19 @@ int main(int argc, char** argv) {
         if (args.kernel_size.has_value()) {
             std::cout << "Kernel Size: " << args.kernel_size.value() << std::endl;
         }
+        if (args.iterations.has_value()) {
+            std::cout << "Iterations: " << args.iterations.value() << std::endl;
+        }
+        if (args.morph_shape.has_value()) {
+            std::cout << "Element Shape: " << args.morph_shape.value() << std::endl;
+        }
         if (args.resize_factor.has_value()) {
             std::cout << "Resize Factor: " << args.resize_factor.value() << std::endl;
         }
+        if (args.resize_width.has_value() && args.resize_height.has_value()) {
+            std::cout << "Target Size: " << args.resize_width.value() << "x" << args.resize_height.value()
+                      << " (" << args.resize_mode.value_or("exact") << ")" << std::endl;
+        }
         if (args.brightness_value.has_value()) {
             std::cout << "Brightness Value: " << args.brightness_value.value() << std::endl;
         }
@@ -65,6 +118,9 @@ int main(int argc, char** argv) {
         if (args.canny_threshold2.has_value()) {
             std::cout << "Canny Threshold 2: " << args.canny_threshold2.value() << std::endl;
         }
+        if (args.canny_auto.has_value()) {
+            std::cout << "Canny Thresholds: automatic (" << args.canny_auto.value() << ")" << std::endl;
+        }
         std::cout << "------------------------" << std::endl;
 
 
@@ -73,14 +129,27 @@ int main(int argc, char** argv) {
         // std::vector<cv::Mat> input_images_stitch; // No longer needed as stitch loads internally
 
         if (args.operation == "stitch") {
-            // Stitching loads images internally from paths
-             if (args.input_files.size() < 2) {
+            // Stitching loads images internally from paths; a session may grow by one image
+             if (args.input_files.size() < (args.stitch_session.has_value() ? 1u : 2u)) {
                  // This check is also in cli_parser, but good to be robust
                  throw std::runtime_error("Stitching operation requires at least two input image paths provided via -i.");
              }
              std::cout << "Stitching operation selected. Image loading will occur in the stitch function." << std::endl;
         }
-        else if (args.operation == "video-gray") {
+        else if (args.operation == "resize" && args.resize_stream) {
+            // Streaming resize decodes the input strip by strip; nothing is loaded here
+            std::cout << "Streaming resize selected. Input: " << args.input_files[0] << std::endl;
+        }
+        else if (args.operation == "resize" && args.input_files.size() > 1) {
+            // Batch resize loads each image internally and writes into the output directory
+            std::cout << "Batch resize selected (" << args.input_files.size() << " images). Output directory: "
+                      << args.output_file << std::endl;
+        }
+        else if (args.operation == "video-stitch") {
+            // One video per camera, decoded internally
+            std::cout << "Video stitching selected (" << args.input_files.size() << " videos)." << std::endl;
+        }
+        else if (args.operation == "video-gray" || args.operation == "video-resize") {
             // Video processing also loads internally from path
             if (args.input_files.size() != 1) { // Validation already in parser, but defensive check
                  throw std::runtime_error("Video operations require exactly one input video path provided via -i.");
@@ -119,8 +188,14 @@ int main(int argc, char** argv) {
             std::cout << "Input image loaded: " << args.input_files[0] << std::endl;
         }
         else if (args.input_files.size() == 1) {
-            // Load single image for other non-stitch, non-video operations
-            input_image = cv::imread(args.input_files[0], cv::IMREAD_COLOR);
+            // Load single image for other non-stitch, non-video operations.
+            // Morphology keeps grayscale files single-channel so that masks can use the
+            // bit-packed binary engine; EXIF orientation is still applied (unlike IMREAD_UNCHANGED).
+            const bool is_morphology = args.operation == "dilate" || args.operation == "erode"
+                || args.operation == "open" || args.operation == "close" || args.operation == "gradient"
+                || args.operation == "tophat" || args.operation == "blackhat";
+            input_image = cv::imread(args.input_files[0],
+                                     is_morphology ? cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH : cv::IMREAD_COLOR);
             if (input_image.empty()) {
                 throw std::runtime_error("Failed to load input image: " + args.input_files[0]);
             }
@@ -151,13 +226,22 @@ int main(int argc, char** argv) {
         cv::Mat output_image;
         bool operation_handled = false;
 
+        // Map the structuring element name to the OpenCV shape code (parser validated it)
+        int morph_shape = cv::MORPH_RECT;
+        if (args.morph_shape.value_or("rect") == "cross") {
+            morph_shape = cv::MORPH_CROSS;
+        } else if (args.morph_shape.value_or("rect") == "ellipse") {
+            morph_shape = cv::MORPH_ELLIPSE;
+        }
+
         if (args.operation == "dilate") {
             if (!args.kernel_size.has_value()) {
                 // This should be caught by the parser, but double-check
                 throw std::runtime_error("Kernel size is required for dilation.");
             }
             std::cout << "Performing dilation..." << std::endl;
-            output_image = dilate_image(input_image, args.kernel_size.value());
+            output_image = dilate_image(input_image, args.kernel_size.value(), args.iterations.value_or(1),
+                                        morph_shape);
             operation_handled = true;
         }
         else if (args.operation == "erode") {
@@ -165,7 +249,54 @@ int main(int argc, char** argv) {
                 throw std::runtime_error("Kernel size is required for erosion.");
             }
             std::cout << "Performing erosion..." << std::endl;
-            output_image = erode_image(input_image, args.kernel_size.value());
+            output_image = erode_image(input_image, args.kernel_size.value(), args.iterations.value_or(1),
+                                       morph_shape);
+            operation_handled = true;
+        }
+        else if (args.operation == "open" || args.operation == "close" || args.operation == "gradient"
+                 || args.operation == "tophat" || args.operation == "blackhat") {
+            if (!args.kernel_size.has_value()) {
+                throw std::runtime_error("Kernel size is required for compound morphology operations.");
+            }
+            // Map the operation name to the OpenCV morphology code
+            int morph_op = cv::MORPH_OPEN;
+            if (args.operation == "close") {
+                morph_op = cv::MORPH_CLOSE;
+            } else if (args.operation == "gradient") {
+                morph_op = cv::MORPH_GRADIENT;
+            } else if (args.operation == "tophat") {
+                morph_op = cv::MORPH_TOPHAT;
+            } else if (args.operation == "blackhat") {
+                morph_op = cv::MORPH_BLACKHAT;
+            }
+            std::cout << "Performing " << args.operation << " (fused morphology)..." << std::endl;
+            output_image = morph_compound_image(input_image, morph_op, args.kernel_size.value(),
+                                                args.iterations.value_or(1), morph_shape);
+            operation_handled = true;
+        }
+        else if (args.operation == "resize" && args.resize_stream) {
+            std::cout << "Performing streaming resize..." << std::endl;
+            if (args.resize_width.has_value() && args.resize_height.has_value()) {
+                resize_image_streaming(args.input_files[0], args.output_file,
+                                       args.resize_width.value(), args.resize_height.value());
+            } else if (args.resize_factor.has_value()) {
+                resize_image_streaming(args.input_files[0], args.output_file, args.resize_factor.value());
+            } else {
+                throw std::runtime_error("Resize factor (-f or --factor) or target size is required for resize operation.");
+            }
+            std::cout << "Streaming resize completed: " << args.output_file << std::endl;
+            // The output is written strip by strip, operation_handled remains false.
+        }
+        else if (args.operation == "resize" && args.resize_width.has_value() && args.resize_height.has_value()) {
+            ResizeMode mode = ResizeMode::Exact;
+            if (args.resize_mode.value_or("exact") == "fit") {
+                mode = ResizeMode::Fit;
+            } else if (args.resize_mode.value_or("exact") == "fill") {
+                mode = ResizeMode::Fill;
+            }
+            std::cout << "Performing resize to target size..." << std::endl;
+            output_image = resize_image(input_image, args.resize_width.value(), args.resize_height.value(),
+                                        cv::INTER_LINEAR, mode);
             operation_handled = true;
         }
         else if (args.operation == "resize") {
@@ -173,9 +304,16 @@ int main(int argc, char** argv) {
                 // This should be caught by the parser, but double-check
                 throw std::runtime_error("Resize factor (-f or --factor) is required for resize operation.");
             }
-            std::cout << "Performing resize..." << std::endl;
-            output_image = resize_image(input_image, args.resize_factor.value()); // Using default interpolation (linear)
-            operation_handled = true;
+            if (args.input_files.size() > 1) {
+                std::cout << "Performing batch resize..." << std::endl;
+                size_t written = resize_image_batch(args.input_files, args.output_file, args.resize_factor.value());
+                std::cout << "Batch resize completed: " << written << " images written." << std::endl;
+                // Saving is handled inside resize_image_batch, operation_handled remains false.
+            } else {
+                std::cout << "Performing resize..." << std::endl;
+                output_image = resize_image(input_image, args.resize_factor.value()); // Using default interpolation (linear)
+                operation_handled = true;
+            }
         }
         else if (args.operation == "brightness") {
             if (!args.brightness_value.has_value()) {
@@ -186,13 +324,89 @@ int main(int argc, char** argv) {
             output_image = adjust_brightness(input_image, args.brightness_value.value());
             operation_handled = true;
         }
+        else if (args.operation == "adjust") {
+            // Compose every requested point operation into one lookup table
+            PointOpPipeline pipeline;
+            if (args.brightness_value.value_or(0) != 0) {
+                pipeline.brightness(args.brightness_value.value());
+            }
+            if (args.contrast_gain.has_value()) {
+                pipeline.contrast(args.contrast_gain.value());
+            }
+            if (args.levels.has_value()) {
+                const std::vector<double>& lv = args.levels.value();
+                if (lv.size() == 4) {
+                    pipeline.levels(lv[0], lv[1], lv[2], lv[3]);
+                } else {
+                    pipeline.levels(lv[0], lv[1]);
+                }
+            }
+            if (args.gamma_value.has_value()) {
+                pipeline.gamma(args.gamma_value.value());
+            }
+            if (args.invert) {
+                pipeline.invert();
+            }
+            if (args.threshold_value.has_value()) {
+                pipeline.threshold(args.threshold_value.value());
+            }
+            std::cout << "Performing fused point operations..." << std::endl;
+            output_image = pipeline.apply(input_image);
+            operation_handled = true;
+        }
         else if (args.operation == "stitch") {
             std::cout << "Performing stitching..." << std::endl;
-            cv::Stitcher::Status status = stitch_images(args.input_files, output_image); // output_image is the pano
+            const StitchOptions stitch_options = stitch_options_from_arguments(args);
+            const int64 stitch_start = cv::getTickCount();
+            cv::Stitcher::Status status = cv::Stitcher::OK;
+            const std::string& out = args.output_file;
+            const bool tiled_output = out.size() > 4 && out.compare(out.size() - 4, 4, ".dzi") == 0;
+            if (args.stitch_match_benchmark) {
+                // Matching only: nothing is composited or written
+                std::cout << "Benchmarking pair matching (all pairs / selected pairs / selected pairs, index per image)..." << std::endl;
+                const std::vector<StitchMatchBenchmark> benches = benchmark_stitch_matching(args.input_files, stitch_options);
+                // Markdown table, ready to paste; ms per pair shows the quadratic versus linear growth
+                std::cout << "| images | all pairs | all s | ms/pair | selected pairs | selected s | indexed s |\n"
+                          << "|---|---|---|---|---|---|---|" << std::endl;
+                for (const StitchMatchBenchmark& bench : benches) {
+                    std::cout << "| " << bench.images << " | " << bench.all_pairs << " | " << bench.all_seconds << " | "
+                              << (bench.all_pairs > 0 ? bench.all_seconds * 1000.0 / bench.all_pairs : 0.0) << " | "
+                              << bench.range_pairs << " | " << bench.range_seconds << " | " << bench.indexed_seconds
+                              << " |" << std::endl;
+                }
+            } else if (tiled_output) {
+                // Out-of-core: tiles are written as they are composited
+                StitchTileOptions tile_options;
+                tile_options.tile_size = args.stitch_tile_size;
+                tile_options.format = args.stitch_tile_format;
+                tile_options.memory_budget_mb = static_cast<size_t>(args.stitch_memory_budget_mb);
+                status = stitch_images_tiled(args.input_files, out, stitch_options, tile_options);
+            } else if (args.stitch_rig.has_value()) {
+                // Fixed rig: registration runs once, later sets are only composited
+                status = stitch_images_with_rig(args.input_files, args.stitch_rig.value(), output_image, stitch_options);
+            } else if (args.stitch_session.has_value()) {
+                // Incremental: only the new inputs are registered and composited
+                StitchSession session(args.stitch_session.value(), stitch_options);
+                status = session.add_images(args.input_files);
+                output_image = session.panorama();
+            } else {
+                StitchTimings timings;
+                status = stitch_images(args.input_files, output_image, stitch_options, &timings); // output_image is the pano
+                std::cout << "Stage times (s): features " << timings.features << ", matching " << timings.matching
+                          << ", estimation " << timings.estimation << ", exposure " << timings.exposure
+                          << ", seams " << timings.seams << ", warping " << timings.warping
+                          << ", blending " << timings.blending << std::endl;
+            }
+            std::cout << "Stitching took " << (cv::getTickCount() - stitch_start) / cv::getTickFrequency() << " s "
+                      << "(registration " << stitch_options.registration_resol << " MP, seams "
+                      << stitch_options.seam_estimation_resol << " MP, compositing "
+                      << stitch_options.compositing_resol << " MP), peak memory " << peak_memory_mb() << " MB."
+                      << std::endl;
 
             if (status == cv::Stitcher::OK) {
                 std::cout << "Stitching completed successfully." << std::endl;
-                operation_handled = true; // Set to true ONLY on success
+                // Set to true ONLY on success; a DeepZoom output is already on disk, a benchmark has none
+                operation_handled = !tiled_output && !args.stitch_match_benchmark;
             } else {
                 std::string status_msg = stitcher_status_to_string(status);
                 // Throw an error or just report? Let's throw for now.
@@ -206,10 +420,60 @@ int main(int argc, char** argv) {
             }
             std::cout << "Performing Canny edge detection..." << std::endl;
             // Using default aperture size (3) and L1 gradient
-            output_image = detect_edges_canny(input_image, 
-                                              args.canny_threshold1.value(), 
-                                              args.canny_threshold2.value());
-            operation_handled = true;
+            if (args.canny_sweep.has_value()) {
+                const auto& pairs = args.canny_sweep.value();
+                std::cout << "Running Canny sweep over " << pairs.size() << " threshold pairs..." << std::endl;
+                detect_edges_canny_sweep(input_image, pairs, [&](size_t i, const cv::Mat& edges) {
+                    const std::string path = canny_sweep_output_path(args.output_file, pairs[i].first, pairs[i].second);
+                    if (!cv::imwrite(path, edges)) {
+                        throw std::runtime_error("Failed to save output image to: " + path);
+                    }
+                    std::cout << "  t1=" << pairs[i].first << ", t2=" << pairs[i].second << " -> " << path << std::endl;
+                }, false, args.canny_blur.value_or(0));
+                // Each pair is saved as it is produced, operation_handled remains false.
+            } else if (args.edge_format.value_or("png") != "png") {
+                const EdgeListFormat format = args.edge_format.value() == "contours" ? EdgeListFormat::Contours
+                                                                                      : EdgeListFormat::Points;
+                const uint64_t written = write_canny_edge_list(input_image,
+                                                               args.output_file,
+                                                               args.canny_threshold1.value(),
+                                                               args.canny_threshold2.value(),
+                                                               format,
+                                                               args.edge_subpixel,
+                                                               false,
+                                                               args.canny_blur.value_or(0));
+                std::cout << "Edge list written (" << written << " " << args.edge_format.value() << "): "
+                          << args.output_file << std::endl;
+                // The edge list is written directly, operation_handled remains false.
+            } else if (args.canny_auto.has_value()) {
+                const CannyThresholdMethod method = args.canny_auto.value() == "otsu"
+                                                        ? CannyThresholdMethod::Otsu
+                                                        : CannyThresholdMethod::Median;
+                const CannyAutoThresholds thresholds = detect_edges_canny_auto(input_image,
+                                                                               output_image,
+                                                                               method,
+                                                                               false,
+                                                                               args.canny_blur.value_or(0),
+                                                                               args.canny_tiled);
+                std::cout << "Canny thresholds (" << args.canny_auto.value() << "): low=" << thresholds.low
+                          << ", high=" << thresholds.high << std::endl;
+                operation_handled = true;
+            } else if (args.canny_tiled) {
+                detect_edges_canny_tiled(input_image,
+                                         output_image,
+                                         args.canny_threshold1.value(),
+                                         args.canny_threshold2.value(),
+                                         false,
+                                         args.canny_blur.value_or(0));
+                operation_handled = true;
+            } else {
+                output_image = detect_edges_canny(input_image, 
+                                                  args.canny_threshold1.value(), 
+                                                  args.canny_threshold2.value(),
+                                                  3, false,
+                                                  args.canny_blur.value_or(0));
+                operation_handled = true;
+            }
         }
         else if (args.operation == "video-gray") {
             std::cout << "Processing video to grayscale..." << std::endl;
@@ -223,6 +487,30 @@ int main(int argc, char** argv) {
                  throw std::runtime_error("Video processing failed for an unknown reason.");
             }
         }
+        else if (args.operation == "video-resize") {
+            if (!args.resize_factor.has_value()) {
+                throw std::runtime_error("Resize factor (-f or --factor) is required for video-resize operation.");
+            }
+            std::cout << "Resizing video..." << std::endl;
+            bool success = process_video_resize(args.input_files[0], args.output_file, args.resize_factor.value());
+            if (success) {
+                 std::cout << "Video resize completed successfully." << std::endl;
+                 // Saving is handled internally, operation_handled remains false.
+            } else {
+                 throw std::runtime_error("Video resize failed for an unknown reason.");
+            }
+        }
+        else if (args.operation == "video-stitch") {
+            std::cout << "Stitching videos..." << std::endl;
+            bool success = process_video_stitch(args.input_files, args.output_file, args.stitch_calibration_frames,
+                                                stitch_options_from_arguments(args), args.stitch_rig.value_or(""));
+            if (success) {
+                 std::cout << "Video stitching completed successfully." << std::endl;
+                 // Saving is handled internally, operation_handled remains false.
+            } else {
+                 throw std::runtime_error("Video stitching failed: the rig could not be calibrated.");
+            }
+        }
         else if (args.operation == "detect-faces") {
             if (!args.cascade_file.has_value() || args.cascade_file.value().empty()) {
                 throw std::runtime_error("Cascade file path (-c or --cascade) is required for face detection.");
@@ -291,6 +579,27 @@ int main(int argc, char** argv) {
             throw std::runtime_error("Unknown or unimplemented operation: " + args.operation);
         }
 
+        // Optional resize benchmark against the size just produced
+        if (args.operation == "resize" && args.resize_benchmark.has_value() && !output_image.empty()) {
+            std::cout << "Benchmarking bilinear resize (" << args.resize_benchmark.value() << " runs)..." << std::endl;
+            ResizeBenchmark bench = benchmark_resize(input_image, output_image.size(), args.resize_benchmark.value());
+            std::cout << "  Fixed-point kernel: " << bench.kernel_mpix_per_sec << " MP/s" << std::endl;
+            std::cout << "  cv::resize:         " << bench.opencv_mpix_per_sec << " MP/s" << std::endl;
+        }
+
+        // Optional rectangular morphology benchmark over the range of kernel sizes
+        if (args.morphology_benchmark.has_value()) {
+            const std::vector<int> kernel_sizes = {3, 5, 9, 15, 21, 31, 51, 75, 101, 151, 201};
+            std::cout << "Benchmarking rectangular " << args.operation << " (" << args.morphology_benchmark.value()
+                      << " runs per size)..." << std::endl;
+            for (const MorphologyBenchmark& bench :
+                 benchmark_morphology(input_image, kernel_sizes, args.morphology_benchmark.value(),
+                                      args.operation == "dilate")) {
+                std::cout << "  k = " << bench.kernel_size << ": engine " << bench.engine_ms << " ms / OpenCV "
+                          << bench.opencv_ms << " ms" << std::endl;
+            }
+        }
+
         // --- Image Saving ---
         // This block now only runs for operations that produce a single output_image Mat
         // Video processing handles its own saving internally.
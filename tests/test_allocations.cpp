@@ -0,0 +1,165 @@
+// Steady-state allocation test for the workspace / out-parameter overloads.
+//
+// Every 8-bit path that the headers document as allocation-free is run several times
+// with the same workspace and destination. Allocations are counted by replacing the
+// global operator new and by installing a counting cv::MatAllocator (which also sees
+// Mat buffers when OpenCV is a DLL whose operator new is not replaced). The first
+// call may allocate; any allocation after it fails the test.
+//
+// OpenCV runs single-threaded here: with more than one thread its thread pool
+// allocates a job record per parallel_for_ dispatch, the one documented exception.
+
+#include "brightness.hpp"
+#include "morphology.hpp"
+#include "resize.hpp"
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+
+static std::atomic<long> g_allocations(0);
+
+static void* counted_malloc(std::size_t size) {
+    ++g_allocations;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new(std::size_t size) {
+    void* p = counted_malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    void* p = counted_malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return counted_malloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return counted_malloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+/**
+ * @brief Default Mat allocator that counts new buffers and delegates to OpenCV's own.
+ */
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override {
+        if (!data) {
+            ++g_allocations;
+        }
+        return base_->allocate(dims, sizes, type, data, step, flags, usage_flags);
+    }
+
+    bool allocate(cv::UMatData* data, cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override {
+        return base_->allocate(data, flags, usage_flags);
+    }
+
+    void deallocate(cv::UMatData* data) const override {
+        base_->deallocate(data);
+    }
+
+private:
+    cv::MatAllocator* base_ = cv::Mat::getStdAllocator();
+};
+
+/**
+ * @brief Runs one frame operation repeatedly and reports the allocations after the first run.
+ *
+ * @return bool True if the second and later runs did not allocate.
+ */
+static bool check_steady_state(const char* name, const std::function<void()>& frame) {
+    const int runs = 4;
+    frame(); // Warm-up: sizes the workspace and destination
+    const long before = g_allocations.load();
+    for (int i = 1; i < runs; ++i) {
+        frame();
+    }
+    const long allocations = g_allocations.load() - before;
+    std::cout << (allocations == 0 ? "[ ok ] " : "[FAIL] ") << name << ": " << allocations
+              << " allocation(s) in " << runs - 1 << " steady-state calls" << std::endl;
+    return allocations == 0;
+}
+
+int main() {
+    static CountingMatAllocator allocator;
+    cv::Mat::setDefaultAllocator(&allocator);
+    cv::setNumThreads(1);
+
+    // Odd sizes so the bands, stripes and packed words do not divide evenly
+    cv::Mat gray(479, 641, CV_8UC1), color(479, 641, CV_8UC3), bgra(479, 641, CV_8UC4);
+    cv::randu(gray, 0, 256);
+    cv::randu(color, 0, 256);
+    cv::randu(bgra, 0, 256);
+    cv::Mat mask;
+    cv::threshold(gray, mask, 127, 255, cv::THRESH_BINARY);
+    cv::Mat scratch = color.clone();
+
+    ResizeWorkspace resize_workspace;
+    MorphologyWorkspace morphology_workspace;
+    ResizePlan nearest_plan(bgra.size(), cv::Size(400, 300), cv::INTER_NEAREST, bgra.type());
+    PointOpPipeline pipeline;
+    pipeline.brightness(12).gamma(1.4).contrast(1.2, 128.0, 2);
+    cv::Mat out;
+
+    bool ok = true;
+    ok &= check_steady_state("resize 8UC3 x0.75 (bilinear)", [&] {
+        resize_image(color, out, resize_workspace, 0.75);
+    });
+    ok &= check_steady_state("resize 8UC1 x1.6 (bilinear)", [&] {
+        resize_image(gray, out, resize_workspace, 1.6);
+    });
+    ok &= check_steady_state("resize 8UC3 to 300x300 fill (bilinear)", [&] {
+        resize_image(color, out, resize_workspace, 300, 300, cv::INTER_LINEAR, ResizeMode::Fill);
+    });
+    ok &= check_steady_state("ResizePlan 8UC4 nearest", [&] {
+        nearest_plan.apply(bgra, out);
+    });
+    ok &= check_steady_state("dilate 8UC3 rect 15", [&] {
+        dilate_image(color, out, morphology_workspace, 15);
+    });
+    ok &= check_steady_state("erode 8UC1 ellipse 9 (banded)", [&] {
+        erode_image(gray, out, morphology_workspace, 9, 1, cv::MORPH_ELLIPSE);
+    });
+    ok &= check_steady_state("dilate 8UC3 cross 5 x2 in place", [&] {
+        dilate_image(scratch, scratch, morphology_workspace, 5, 2, cv::MORPH_CROSS);
+    });
+    ok &= check_steady_state("erode binary mask ellipse 7", [&] {
+        erode_image(mask, out, morphology_workspace, 7, 1, cv::MORPH_ELLIPSE);
+    });
+    ok &= check_steady_state("opening 8UC1 ellipse 7", [&] {
+        morph_compound_image(gray, out, morphology_workspace, cv::MORPH_OPEN, 7, 1, cv::MORPH_ELLIPSE);
+    });
+    ok &= check_steady_state("gradient 8UC3 rect 5", [&] {
+        morph_compound_image(color, out, morphology_workspace, cv::MORPH_GRADIENT, 5);
+    });
+    ok &= check_steady_state("closing binary mask rect 9", [&] {
+        morph_compound_image(mask, out, morphology_workspace, cv::MORPH_CLOSE, 9);
+    });
+    ok &= check_steady_state("adjust_brightness 8UC3", [&] {
+        adjust_brightness(color, out, 40);
+    });
+    ok &= check_steady_state("adjust_brightness 8UC3 in place", [&] {
+        adjust_brightness(scratch, scratch, -30);
+    });
+    ok &= check_steady_state("PointOpPipeline 8UC3 per-channel tables", [&] {
+        pipeline.apply(color, out);
+    });
+
+    cv::Mat::setDefaultAllocator(nullptr);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
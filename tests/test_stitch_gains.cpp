@@ -0,0 +1,97 @@
+// Exposure gains of the tiled and rig compositing paths.
+//
+// Two overlapping synthetic images, the second with a colour cast, are fed to each
+// exposure compensator. stitch_exposure_gains() must return the layout of the selected
+// compensator, and apply_stitch_gains() on a window of the warped image must give the
+// same pixels as ExposureCompensator::apply() on the whole image. Block gain maps are
+// allowed one level, for the last bit of OpenCV's vectorised resize.
+
+#include "stitch_pipeline.hpp"
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+static bool report(bool ok, const std::string& name, const std::string& detail) {
+    std::cout << (ok ? "[ ok ] " : "[FAIL] ") << name << (detail.empty() ? "" : ": " + detail) << std::endl;
+    return ok;
+}
+
+/**
+ * @brief Estimates gains for the two images and checks their layout and windowed application.
+ *
+ * @return bool True if every check passed.
+ */
+static bool check_exposure(const char* name, StitchExposure exposure, const cv::Mat& left, const cv::Mat& right,
+                           int tolerance) {
+    StitchOptions options;
+    options.exposure = exposure;
+    const std::vector<cv::Point> corners = {cv::Point(0, 0), cv::Point(left.cols / 2, 0)};
+    const std::vector<cv::UMat> images = {left.getUMat(cv::ACCESS_READ), right.getUMat(cv::ACCESS_READ)};
+    const cv::Mat full_mask(right.size(), CV_8U, cv::Scalar(255));
+    const std::vector<cv::UMat> masks = {full_mask.getUMat(cv::ACCESS_READ), full_mask.getUMat(cv::ACCESS_READ)};
+    StitchSeams seams;
+    seams.compensator = create_stitch_compensator(options);
+    seams.compensator->feed(corners, images, masks);
+    const std::vector<cv::Mat> gains = stitch_exposure_gains(seams, options, 2);
+
+    bool ok = true;
+    const cv::Mat& gain = gains[1];
+    switch (exposure) {
+        case StitchExposure::None:
+            ok &= report(gain.empty(), std::string(name) + " layout", "no gains");
+            break;
+        case StitchExposure::Gain:
+            ok &= report(gain.size() == cv::Size(1, 1) && gain.type() == CV_32FC1, std::string(name) + " layout",
+                         "1x1 CV_32FC1");
+            break;
+        case StitchExposure::Channels: {
+            // getMatGains() returns cv::Mat(cv::Scalar), a 4x1 column; its first three rows are B, G, R
+            std::vector<cv::Mat> column;
+            seams.compensator->getMatGains(column);
+            bool per_channel = gain.size() == cv::Size(1, 1) && gain.type() == CV_32FC3;
+            for (int c = 0; c < 3 && per_channel; ++c) {
+                per_channel = gain.at<cv::Vec3f>(0, 0)[c] == static_cast<float>(column[1].at<double>(c));
+            }
+            ok &= report(per_channel, std::string(name) + " layout", "1x1 CV_32FC3, one gain per channel");
+            break;
+        }
+        case StitchExposure::Blocks:
+            ok &= report(gain.total() > 1 && gain.type() == CV_32FC1, std::string(name) + " layout",
+                         "CV_32FC1 block grid");
+            break;
+    }
+
+    cv::Mat reference = right.clone();
+    seams.compensator->apply(1, corners[1], reference, full_mask);
+    const cv::Rect windows[] = {cv::Rect(cv::Point(), right.size()),
+                                cv::Rect(right.cols / 2, right.rows / 2, right.cols / 2, right.rows / 2),
+                                cv::Rect(17, right.rows - 1, right.cols - 31, 1)};
+    for (const cv::Rect& window : windows) {
+        cv::Mat patch = right(window).clone();
+        apply_stitch_gains(patch, gain, right.size(), window);
+        const double diff = cv::norm(patch, reference(window), cv::NORM_INF);
+        ok &= report(diff <= tolerance, std::string(name) + " window " + std::to_string(window.width) + "x"
+                     + std::to_string(window.height) + "+" + std::to_string(window.x) + "+" + std::to_string(window.y),
+                     "max difference " + std::to_string(static_cast<int>(diff)));
+    }
+    return ok;
+}
+
+int main() {
+    // A smooth texture so that the overlap is informative, and a cast on the right image
+    cv::Mat texture(241, 451, CV_8UC3);
+    cv::randu(texture, 40, 200);
+    cv::GaussianBlur(texture, texture, cv::Size(0, 0), 3.0);
+    const cv::Mat left = texture(cv::Rect(0, 0, 301, 241)).clone();
+    cv::Mat right;
+    cv::multiply(texture(cv::Rect(150, 0, 301, 241)), cv::Scalar(0.75, 1.0, 1.3), right);
+
+    bool ok = true;
+    ok &= check_exposure("none", StitchExposure::None, left, right, 0);
+    ok &= check_exposure("gain", StitchExposure::Gain, left, right, 0);
+    ok &= check_exposure("channels", StitchExposure::Channels, left, right, 0);
+    ok &= check_exposure("blocks", StitchExposure::Blocks, left, right, 1);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}